@@ -0,0 +1,130 @@
+#include <beauty/client.hpp>
+#include <beauty/server.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <future>
+#include <string>
+
+namespace {
+//------------------------------------------------------------------------------
+// A server on the loopback, for the benchmarks of this file
+//------------------------------------------------------------------------------
+struct loopback {
+    loopback()
+    {
+        server.add_route("/hello").get([](const beauty::request&, beauty::response& res) {
+            res.set(beauty::content_type::text_plain);
+            res.body() = "Hello";
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port()) + "/hello";
+    }
+
+    ~loopback() {
+        server.stop();
+    }
+
+    beauty::server server;
+    std::string url;
+};
+}
+
+//------------------------------------------------------------------------------
+// A keep-alive connection with Beast: the server side only
+//------------------------------------------------------------------------------
+void
+server_round_trip(benchmark::State& state)
+{
+    loopback lo;
+
+    asio::io_context ioc;
+    beast::tcp_stream stream(ioc);
+    stream.connect({asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(lo.server.port())});
+
+    beast::http::request<beast::http::empty_body> req{beast::http::verb::get, "/hello", 11};
+    req.set(beast::http::field::host, "127.0.0.1");
+    beast::flat_buffer buffer;
+
+    for (auto _ : state) {
+        beast::http::write(stream, req);
+        beast::http::response<beast::http::string_body> res;
+        beast::http::read(stream, buffer, res);
+        benchmark::DoNotOptimize(res);
+    }
+}
+BENCHMARK(server_round_trip)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// The synchronous client on its pooled connection, both sides of the library
+//------------------------------------------------------------------------------
+void
+client_round_trip(benchmark::State& state)
+{
+    loopback lo;
+    beauty::client client;
+
+    for (auto _ : state) {
+        auto [ec, response] = client.get(lo.url);
+        if (ec) {
+            state.SkipWithError(ec.message().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(response);
+    }
+}
+BENCHMARK(client_round_trip)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// The callback request, waited for by the benchmark thread
+//------------------------------------------------------------------------------
+void
+client_callback_round_trip(benchmark::State& state)
+{
+    loopback lo;
+    beauty::client client;
+
+    for (auto _ : state) {
+        std::promise<beauty::client::client_response> promise;
+        client.get(lo.url, [&promise](boost::system::error_code ec, beauty::response&& response) {
+            promise.set_value({ec, std::move(response)});
+        });
+
+        auto [ec, response] = promise.get_future().get();
+        if (ec) {
+            state.SkipWithError(ec.message().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(response);
+    }
+}
+BENCHMARK(client_callback_round_trip)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// The same with a completion token: the handler kept in the request, posted
+// to the event loop of the benchmark thread
+//------------------------------------------------------------------------------
+void
+client_token_round_trip(benchmark::State& state)
+{
+    loopback lo;
+    beauty::client client;
+    asio::io_context ioc;
+
+    for (auto _ : state) {
+        boost::system::error_code ec;
+        client.async_get(lo.url, asio::bind_executor(ioc,
+                [&ec](boost::system::error_code e, beauty::response response) {
+                    ec = e;
+                    benchmark::DoNotOptimize(response);
+                }));
+
+        ioc.restart();
+        ioc.run();
+        if (ec) {
+            state.SkipWithError(ec.message().c_str());
+            break;
+        }
+    }
+}
+BENCHMARK(client_token_round_trip)->UseRealTime();
@@ -0,0 +1,109 @@
+#include <beauty/route.hpp>
+#include <beauty/router.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+//------------------------------------------------------------------------------
+// Api like routes: /api/v1/resource_<i>/:id and /api/v1/resource_<i>/:id/items/:item
+//------------------------------------------------------------------------------
+beauty::router
+make_router(int route_count)
+{
+    beauty::router router;
+    for (int i = 0; i < route_count; ++i) {
+        std::string path = "/api/v1/resource_" + std::to_string(i / 2) + "/:id";
+        if (i % 2) {
+            path += "/items/:item";
+        }
+        router.add_route(beast::http::verb::get,
+                beauty::route(path, [](const beauty::request&, beauty::response&) {}));
+    }
+    return router;
+}
+
+std::vector<std::string>
+make_targets(int route_count)
+{
+    std::vector<std::string> targets;
+    for (int i = 0; i < route_count; i += std::max(1, route_count / 64)) {
+        std::string target = "/api/v1/resource_" + std::to_string(i / 2) + "/42";
+        if (i % 2) {
+            target += "/items/7";
+        }
+        targets.push_back(std::move(target));
+    }
+    return targets;
+}
+}
+
+//------------------------------------------------------------------------------
+void
+router_match(benchmark::State& state)
+{
+    auto router = make_router(state.range(0));
+    auto targets = make_targets(state.range(0));
+
+    beauty::request req;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        req.target(targets[i++ % targets.size()]);
+        benchmark::DoNotOptimize(router.match(beast::http::verb::get, req));
+    }
+}
+BENCHMARK(router_match)->Arg(10)->Arg(1000)->Arg(10000);
+
+//------------------------------------------------------------------------------
+// Previous implementation, the baseline: first matching route in the sorted routes
+//------------------------------------------------------------------------------
+void
+router_linear_scan(benchmark::State& state)
+{
+    auto router = make_router(state.range(0));
+    auto targets = make_targets(state.range(0));
+    const auto& routes = router.find(beast::http::verb::get)->second;
+
+    beauty::request req;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        req.target(targets[i++ % targets.size()]);
+        for (const auto& r : routes) {
+            if (r.match(req)) {
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(req);
+    }
+}
+BENCHMARK(router_linear_scan)->Arg(10)->Arg(1000)->Arg(10000);
+
+//------------------------------------------------------------------------------
+void
+router_no_match(benchmark::State& state)
+{
+    auto router = make_router(state.range(0));
+
+    beauty::request req;
+    req.target("/api/v2/unknown/42");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(router.match(beast::http::verb::get, req));
+    }
+}
+BENCHMARK(router_no_match)->Arg(10)->Arg(1000);
+
+//------------------------------------------------------------------------------
+void
+route_match(benchmark::State& state)
+{
+    beauty::route route("/api/v1/users/:id/items/:item");
+
+    beauty::request req;
+    req.target("/api/v1/users/42/items/7?sort=asc&limit=10");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(route.match(req));
+    }
+}
+BENCHMARK(route_match);
@@ -0,0 +1,43 @@
+# Optional codecs of the response compression, as the imported targets
+# brotli::brotlienc and zstd::libzstd. Used to build beauty, and by the
+# installed BeautyConfig.cmake to give them to the users of a static beauty.
+
+# brotli
+if (NOT TARGET brotli::brotlienc)
+    find_package(brotli CONFIG QUIET)
+endif()
+if (NOT TARGET brotli::brotlienc)
+    find_path(BROTLI_INCLUDE_DIR brotli/encode.h)
+    find_library(BROTLIENC_LIBRARY brotlienc)
+    if (BROTLI_INCLUDE_DIR AND BROTLIENC_LIBRARY)
+        add_library(brotli::brotlienc UNKNOWN IMPORTED)
+        set_target_properties(brotli::brotlienc
+            PROPERTIES
+                IMPORTED_LOCATION "${BROTLIENC_LIBRARY}"
+                INTERFACE_INCLUDE_DIRECTORIES "${BROTLI_INCLUDE_DIR}"
+        )
+    endif()
+endif()
+
+# zstd, the package target names depend on its version and on the library type
+if (NOT TARGET zstd::libzstd)
+    find_package(zstd CONFIG QUIET)
+    foreach(zstd_target zstd::libzstd_shared zstd::libzstd_static)
+        if (NOT TARGET zstd::libzstd AND TARGET ${zstd_target})
+            add_library(zstd::libzstd INTERFACE IMPORTED)
+            target_link_libraries(zstd::libzstd INTERFACE ${zstd_target})
+        endif()
+    endforeach()
+endif()
+if (NOT TARGET zstd::libzstd)
+    find_path(ZSTD_INCLUDE_DIR zstd.h)
+    find_library(ZSTD_LIBRARY zstd)
+    if (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+        add_library(zstd::libzstd UNKNOWN IMPORTED)
+        set_target_properties(zstd::libzstd
+            PROPERTIES
+                IMPORTED_LOCATION "${ZSTD_LIBRARY}"
+                INTERFACE_INCLUDE_DIRECTORIES "${ZSTD_INCLUDE_DIR}"
+        )
+    endif()
+endif()
@@ -19,17 +19,26 @@ class BeautyConan(ConanFile):
     options         = {
         "fPIC": [True, False],
         "shared": [True, False],
-        "openssl": [True, False]
+        "openssl": [True, False],
+        "coroutines": [True, False],
+        "compression": [True, False],
+        "benchmarks": [True, False]
     }
     default_options = {
         "fPIC": True,
         "shared": False,
-        "openssl": True
+        "openssl": True,
+        "coroutines": False,
+        "compression": False,
+        "benchmarks": False
     }
     options_description = {
         "fPIC": "Enable Position Independent Code",
         "shared": "Build shared library",
-        "openssl": "Enable OpenSSL support"
+        "openssl": "Enable OpenSSL support",
+        "coroutines": "Enable C++20 coroutine route handlers",
+        "compression": "Enable response compression (zlib, brotli, zstd)",
+        "benchmarks": "Build the microbenchmarks (Google Benchmark)"
     }
 
     @property
@@ -53,6 +62,8 @@ class BeautyConan(ConanFile):
         copy(self, "*", dst=os.path.join(self.export_sources_folder, "src"), src=os.path.join(self.recipe_folder, "src"))
         copy(self, "*", dst=os.path.join(self.export_sources_folder, "tests"), src=os.path.join(self.recipe_folder, "tests"))
         copy(self, "*", dst=os.path.join(self.export_sources_folder, "examples"), src=os.path.join(self.recipe_folder, "examples"))
+        copy(self, "*", dst=os.path.join(self.export_sources_folder, "benchmarks"), src=os.path.join(self.recipe_folder, "benchmarks"))
+        copy(self, "*", dst=os.path.join(self.export_sources_folder, "cmake"), src=os.path.join(self.recipe_folder, "cmake"))
         copy(self, "CMakeLists.txt", dst=self.export_sources_folder, src=self.recipe_folder)
         #copy(self, "LICENSE", dst=self.export_folder, src=self.recipe_folder)
 
@@ -64,15 +75,24 @@ class BeautyConan(ConanFile):
         if self.options.openssl:
             # dependency of asio in boost, exposed in boost/asio/ssl/detail/openssl_types.hpp
             self.requires("openssl/[>=1.1 <4]", transitive_headers=True, transitive_libs=True)
+        if self.options.compression:
+            self.requires("zlib/[>=1.2.11 <2]")
+            self.requires("brotli/1.1.0")
+            self.requires("zstd/[>=1.5 <1.6]")
+        if self.options.benchmarks:
+            self.requires("benchmark/1.8.3")
 
     def validate(self):
         if self.settings.compiler.cppstd:
-            check_min_cppstd(self, "17")
+            check_min_cppstd(self, "20" if self.options.coroutines else "17")
 
     def generate(self):
         tc = CMakeToolchain(self)
         tc.variables["BEAUTY_ENABLE_OPENSSL"] = self.options.openssl
+        tc.variables["BEAUTY_ENABLE_COROUTINES"] = self.options.coroutines
+        tc.variables["BEAUTY_ENABLE_COMPRESSION"] = self.options.compression
         tc.variables["BEAUTY_BUILD_EXAMPLES"] = self._build_examples
+        tc.variables["BEAUTY_BUILD_BENCHMARKS"] = self.options.benchmarks
         tc.variables["BUILD_TESTING"] = self._build_tests
         tc.generate()
         deps = CMakeDeps(self)
@@ -129,4 +149,6 @@ class BeautyConan(ConanFile):
             elif self.settings.os == "Windows":
                 self.cpp_info.system_libs = ["crypt32"]
             if self.options.openssl:
-                self.cpp_info.defines = ["BEAUTY_ENABLE_OPENSSL"]
+                self.cpp_info.defines.append("BEAUTY_ENABLE_OPENSSL")
+            if self.options.coroutines:
+                self.cpp_info.defines.append("BEAUTY_ENABLE_COROUTINES")
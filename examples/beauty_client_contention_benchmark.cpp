@@ -0,0 +1,108 @@
+#include <beauty/beauty.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+struct result {
+    double requests_per_second = 0;
+    double submit_ns = 0;   // Time spent in the client call, by request
+    std::size_t errors = 0;
+};
+
+//------------------------------------------------------------------------------
+// Threads sending asynchronous GET requests to one host, on one connection,
+// each one with a window of requests in flight
+//------------------------------------------------------------------------------
+result
+run(const std::string& url, int threads, int requests, int window)
+{
+    beauty::client_settings settings;
+    settings.max_connections_per_host = 1;  // All the threads on the same session
+    beauty::client client(settings);
+
+    // The connection opened first
+    client.get(url);
+
+    std::atomic<std::size_t> errors{0};
+    std::atomic<std::int64_t> submit_ns{0};
+
+    auto start = clock_type::now();
+
+    std::vector<std::thread> senders;
+    for (int t = 0; t < threads; ++t) {
+        senders.emplace_back([&] {
+            std::mutex mtx;
+            std::condition_variable cv;
+            int in_flight = 0;
+
+            std::int64_t local_ns = 0;
+            for (int i = 0; i < requests; ++i) {
+                {
+                    std::unique_lock lock{mtx};
+                    cv.wait(lock, [&] { return in_flight < window; });
+                    ++in_flight;
+                }
+
+                auto before = clock_type::now();
+                client.get(url, [&](boost::system::error_code ec, beauty::response&&) {
+                    if (ec) {
+                        ++errors;
+                    }
+                    std::lock_guard lock{mtx};
+                    --in_flight;
+                    cv.notify_one();
+                });
+                local_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - before).count();
+            }
+
+            std::unique_lock lock{mtx};
+            cv.wait(lock, [&] { return in_flight == 0; });
+            submit_ns += local_ns;
+        });
+    }
+    for (auto& s : senders) {
+        s.join();
+    }
+
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+    const double total = double(threads) * requests;
+
+    return {total / elapsed.count(), submit_ns / total, errors};
+}
+}
+
+//------------------------------------------------------------------------------
+// Contention of the threads submitting requests to the same client session
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int requests = (argc > 1 ? std::stoi(argv[1]) : 20000);
+    int window = (argc > 2 ? std::stoi(argv[2]) : 32);
+
+    beauty::server server;
+    server.add_route("/hello").get([](const auto& req, auto& res) {
+        res.set(beauty::content_type::text_plain);
+        res.body() = "Hello";
+    });
+    server.concurrency(4).listen(0, "127.0.0.1");
+
+    auto url = "http://127.0.0.1:" + std::to_string(server.port()) + "/hello";
+
+    std::cout << "threads\treq/s\t\tsubmit (ns/req)\terrors" << std::endl;
+    for (int threads : {1, 4, 16}) {
+        auto r = run(url, threads, requests / threads, window);
+        std::cout << threads << "\t" << (long)r.requests_per_second << "\t\t"
+                  << (long)r.submit_ns << "\t\t" << r.errors << std::endl;
+    }
+
+    server.stop();
+}
@@ -0,0 +1,424 @@
+#include <beauty/beauty.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------------
+// Command line
+//------------------------------------------------------------------------------
+struct options {
+    std::string url;
+    bool open_loop = false;             // Requests sent at the rate, whatever the ones in flight
+    double rate = 0;                    // Requests by second, as fast as possible if 0 (closed loop)
+    std::size_t connections = 8;
+    std::size_t depth = 1;              // Requests in flight by connection (closed loop)
+    std::chrono::milliseconds duration{10000};
+    std::chrono::milliseconds timeout{0};
+    int threads = 1;                    // Of the application event loop
+    bool http2 = false;
+    std::size_t body_size = 0;          // Of the POST and PUT requests
+    std::vector<std::pair<beast::http::verb, unsigned>> mix{{beast::http::verb::get, 1}};
+};
+
+void
+usage(const char* name)
+{
+    std::cerr <<
+        "Usage: " << name << " [options] <url>\n"
+        "    --mode=closed|open     closed: each request sent once the previous one is done,\n"
+        "                           open: sent at the rate whatever the requests in flight\n"
+        "    --rate=N               requests by second, required in open mode\n"
+        "                           (closed mode: paced by request in flight, as fast as possible if 0)\n"
+        "    --connections=N        connections to the host (8)\n"
+        "    --depth=N              requests in flight by connection, closed mode (1)\n"
+        "    --duration=S           seconds (10)\n"
+        "    --timeout=MS           of each request, none if 0 (0)\n"
+        "    --threads=N            of the client event loop (1)\n"
+        "    --http2                HTTP/2 with prior knowledge, the depth as streams\n"
+        "    --mix=VERB:W,...       request mix by weight (GET:1), as GET:90,POST:10\n"
+        "    --body=N               body size of the POST and PUT requests (0)\n"
+        "Example:\n"
+        "    " << name << " --mode=open --rate=20000 --connections=16 --duration=30 http://127.0.0.1:8085/\n";
+}
+
+bool
+parse_mix(const std::string& value, options& opts)
+{
+    opts.mix.clear();
+    std::size_t start = 0;
+    while (start < value.size()) {
+        auto end = value.find(',', start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        auto item = value.substr(start, end - start);
+        auto colon = item.find(':');
+
+        auto verb = beast::http::string_to_verb(item.substr(0, colon));
+        unsigned weight = (colon == std::string::npos ? 1 : std::stoul(item.substr(colon + 1)));
+        if (verb == beast::http::verb::unknown || !weight) {
+            return false;
+        }
+        opts.mix.emplace_back(verb, weight);
+        start = end + 1;
+    }
+    return !opts.mix.empty();
+}
+
+bool
+parse(int argc, char* argv[], options& opts)
+{
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                opts.url = arg;
+                continue;
+            }
+
+            auto equal = arg.find('=');
+            auto name = arg.substr(2, equal == std::string::npos ? std::string::npos : equal - 2);
+            auto value = (equal == std::string::npos ? std::string() : arg.substr(equal + 1));
+
+            if (name == "mode" && (value == "open" || value == "closed")) opts.open_loop = (value == "open");
+            else if (name == "rate") opts.rate = std::stod(value);
+            else if (name == "connections") opts.connections = std::stoul(value);
+            else if (name == "depth") opts.depth = std::stoul(value);
+            else if (name == "duration") opts.duration = std::chrono::milliseconds((long)(std::stod(value) * 1000));
+            else if (name == "timeout") opts.timeout = std::chrono::milliseconds(std::stol(value));
+            else if (name == "threads") opts.threads = std::stoi(value);
+            else if (name == "http2") opts.http2 = true;
+            else if (name == "mix") { if (!parse_mix(value, opts)) return false; }
+            else if (name == "body") opts.body_size = std::stoul(value);
+            else return false;
+        }
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+
+    return !opts.url.empty() && opts.connections && opts.depth && opts.threads > 0
+        && opts.duration.count() > 0 && (!opts.open_loop || opts.rate > 0);
+}
+
+//------------------------------------------------------------------------------
+// Latencies in microseconds, by buckets of less than 1.6% (64 by power of two)
+//------------------------------------------------------------------------------
+class histogram
+{
+public:
+    void record(std::uint64_t value)
+    {
+        _counts[index(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const
+    {
+        std::uint64_t total = 0;
+        for (const auto& c : _counts) total += c.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // The highest value of the bucket holding the percentile
+    std::uint64_t percentile(double p) const
+    {
+        const auto total = count();
+        if (!total) {
+            return 0;
+        }
+
+        auto rank = std::max<std::uint64_t>(1, (std::uint64_t)std::ceil(p / 100.0 * total));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += _counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return highest(i);
+            }
+        }
+        return highest(BUCKETS - 1);
+    }
+
+private:
+    static constexpr unsigned SUB_BITS = 6;
+    static constexpr std::uint64_t SUB = 1 << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS) * SUB + SUB;
+
+    static std::size_t index(std::uint64_t value)
+    {
+        if (value < 2 * SUB) {
+            return value;
+        }
+        unsigned msb = 63;
+        while (!(value >> msb)) --msb;
+        const unsigned shift = msb - SUB_BITS;
+        return shift * SUB + (value >> shift);
+    }
+
+    static std::uint64_t highest(std::size_t i)
+    {
+        if (i < 2 * SUB) {
+            return i;
+        }
+        const unsigned shift = i / SUB - 1;
+        const std::uint64_t mantissa = i - shift * SUB;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::atomic<std::uint64_t> _counts[BUCKETS] = {};
+};
+
+//------------------------------------------------------------------------------
+// The workload: in closed loop, connections x depth requests in flight, each
+// one sent again once done, paced if a rate is given; in open loop, requests
+// sent at the rate. The latency of a paced request is taken from the time it
+// should have been sent, not when it was: a stalled server is not hidden by
+// the requests not sent meanwhile (coordinated omission).
+//------------------------------------------------------------------------------
+class load
+{
+public:
+    explicit load(const options& opts) :
+        _opts(opts),
+        _client(settings(opts)),
+        _body(opts.body_size, 'x')
+    {
+        for (const auto& [verb, weight] : _opts.mix) {
+            _weights += weight;
+        }
+    }
+
+    void run()
+    {
+        // The first connection opened, and the host looked up, before the measure
+        _client.get_before(std::chrono::seconds(5), _opts.url);
+
+        _start = clock_type::now();
+        _end = _start + _opts.duration;
+
+        if (_opts.open_loop) {
+            send_open_loop();
+        } else {
+            const std::size_t workers = _opts.connections * _opts.depth;
+            {
+                std::lock_guard guard{_mtx};
+                _workers = workers;
+            }
+            for (std::size_t i = 0; i < workers; ++i) {
+                auto w = std::make_shared<worker>(beauty::application::Instance().ioc());
+                w->intended = _start + interval() * i / workers; // Spread over the first interval
+                next(w);
+            }
+        }
+
+        // The requests still in flight
+        std::unique_lock lock{_mtx};
+        _done.wait(lock, [this] { return _in_flight == 0 && _workers == 0; });
+        _elapsed = clock_type::now() - _start;
+    }
+
+    void report(std::ostream& out) const
+    {
+        const auto completed = _latencies.count();
+        const double seconds = std::chrono::duration<double>(_elapsed).count();
+        const bool paced = (_opts.rate > 0);
+
+        out << (_opts.open_loop ? "Open" : "Closed") << " loop, " << _opts.connections << " connections";
+        if (!_opts.open_loop) out << ", depth " << _opts.depth;
+        if (paced) out << ", " << _opts.rate << " req/s";
+        out << ", " << (_opts.http2 ? "HTTP/2" : "HTTP/1.1") << " @ " << _opts.url << "\n";
+
+        out << "  requests     " << completed << " in " << std::fixed << std::setprecision(2) << seconds << "s"
+            << " (2xx " << _status[2] << ", 3xx " << _status[3] << ", 4xx " << _status[4]
+            << ", 5xx " << _status[5] << ", errors " << _errors << ")\n";
+        out << "  throughput   " << std::setprecision(1) << completed / seconds << " req/s, "
+            << std::setprecision(2) << _bytes / seconds / (1024 * 1024) << " MiB/s\n";
+
+        out << "  latency (us" << (paced ? ", from the intended send time" : ", uncorrected without a rate") << ")\n";
+        for (double p : {50.0, 90.0, 99.0, 99.9, 99.99, 100.0}) {
+            out << "    " << std::setw(7) << std::setprecision(p < 99.9 ? 0 : 2) << p << "%  "
+                << _latencies.percentile(p) << "\n";
+        }
+
+        for (const auto& [message, count] : _error_messages) {
+            out << "  error: " << message << " (" << count << ")\n";
+        }
+    }
+
+private:
+    struct worker {
+        explicit worker(asio::io_context& ioc) : timer(ioc) {}
+        asio::steady_timer      timer;
+        clock_type::time_point  intended;
+    };
+
+    static beauty::client_settings settings(const options& opts)
+    {
+        beauty::client_settings settings;
+        settings.http2 = opts.http2;
+        settings.max_connections_per_host = opts.connections;
+        settings.min_connections_per_host = opts.connections;
+        // The requests above the connections wait in the pool, counted in the latency
+        settings.max_pending_requests_per_host = std::numeric_limits<std::size_t>::max();
+        settings.pending_timeout = std::max<clock_type::duration>(opts.duration, std::chrono::seconds(30));
+        return settings;
+    }
+
+    clock_type::duration interval() const
+    {
+        if (_opts.rate <= 0) {
+            return {};
+        }
+        const std::size_t senders = (_opts.open_loop ? 1 : _opts.connections * _opts.depth);
+        return std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(senders / _opts.rate));
+    }
+
+    // The requests at the rate, from this thread
+    void send_open_loop()
+    {
+        const auto step = interval();
+        for (std::uint64_t i = 0; ; ++i) {
+            auto intended = _start + step * i;
+            if (intended >= _end) {
+                break;
+            }
+            std::this_thread::sleep_until(intended); // Late: sent at once, the latency counts from intended
+            send(intended, [] {});
+        }
+    }
+
+    // The next request of a closed loop worker, once the previous one is done
+    void next(const std::shared_ptr<worker>& w)
+    {
+        const auto now = clock_type::now();
+        if (_opts.rate <= 0) {
+            w->intended = now;
+        }
+        if (w->intended >= _end) {
+            std::lock_guard guard{_mtx};
+            --_workers;
+            return _done.notify_all();
+        }
+        if (w->intended <= now) {
+            return send_worker(w);
+        }
+
+        w->timer.expires_at(w->intended);
+        w->timer.async_wait([this, w](boost::system::error_code) { send_worker(w); });
+    }
+
+    void send_worker(const std::shared_ptr<worker>& w)
+    {
+        send(w->intended, [this, w] {
+            w->intended += interval();
+            next(w);
+        });
+    }
+
+    template<typename Then>
+    void send(clock_type::time_point intended, Then&& then)
+    {
+        beauty::request req;
+        req.method(pick());
+        if (req.method() == beast::http::verb::post || req.method() == beast::http::verb::put) {
+            req.body() = _body;
+        }
+
+        {
+            std::lock_guard guard{_mtx};
+            ++_in_flight;
+        }
+
+        _client.send_request(std::move(req), _opts.timeout, _opts.url,
+            [this, intended, then = std::forward<Then>(then)](boost::system::error_code ec, beauty::response&& response) {
+                const auto now = clock_type::now();
+                _latencies.record(std::chrono::duration_cast<std::chrono::microseconds>(now - intended).count());
+
+                if (ec) {
+                    ++_errors;
+                    std::lock_guard guard{_mtx};
+                    ++_error_messages[ec.message()];
+                } else {
+                    ++_status[std::min(response.result_int() / 100, 5u)];
+                    _bytes += response.body().size();
+                }
+
+                then();
+
+                std::lock_guard guard{_mtx};
+                --_in_flight;
+                _done.notify_all();
+            });
+    }
+
+    // The verbs in turn, by weight
+    beast::http::verb pick()
+    {
+        auto n = _sequence.fetch_add(1, std::memory_order_relaxed) % _weights;
+        for (const auto& [verb, weight] : _opts.mix) {
+            if (n < weight) {
+                return verb;
+            }
+            n -= weight;
+        }
+        return _opts.mix.front().first;
+    }
+
+private:
+    const options&          _opts;
+    beauty::client          _client;
+    std::string             _body;
+    std::uint64_t           _weights = 0;
+    std::atomic<std::uint64_t> _sequence{0};
+
+    clock_type::time_point  _start;
+    clock_type::time_point  _end;
+    clock_type::duration    _elapsed{};
+
+    histogram               _latencies;
+    std::atomic<std::uint64_t> _status[6] = {};
+    std::atomic<std::uint64_t> _errors{0};
+    std::atomic<std::uint64_t> _bytes{0};
+
+    mutable std::mutex      _mtx;
+    std::condition_variable _done;
+    std::size_t             _in_flight = 0;
+    std::size_t             _workers = 0;   // Closed loop, still sending
+    std::map<std::string, std::uint64_t> _error_messages;
+};
+}
+
+//------------------------------------------------------------------------------
+// Load generator on beauty::client: throughput and latency percentiles
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    options opts;
+    if (!parse(argc, argv, opts)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    beauty::application::Instance().start(opts.threads);
+
+    load l(opts);
+    l.run();
+    l.report(std::cout);
+
+    beauty::application::Instance().stop();
+}
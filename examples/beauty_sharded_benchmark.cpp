@@ -0,0 +1,95 @@
+#include <beauty/beauty.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace http = beast::http;
+
+namespace {
+//------------------------------------------------------------------------------
+// Keep-alive connections sending GET requests as fast as possible
+//------------------------------------------------------------------------------
+double
+requests_per_second(unsigned short port, int connections, std::chrono::milliseconds duration)
+{
+    std::atomic<bool> running{true};
+    std::atomic<std::size_t> count{0};
+
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            try {
+                asio::io_context ioc;
+                beast::tcp_stream stream(ioc);
+                stream.connect({asio::ip::make_address("127.0.0.1"), port});
+
+                http::request<http::empty_body> req{http::verb::get, "/hello", 11};
+                req.set(http::field::host, "127.0.0.1");
+
+                beast::flat_buffer buffer;
+                std::size_t local_count = 0;
+                while (running) {
+                    http::write(stream, req);
+                    http::response<http::string_body> res;
+                    http::read(stream, buffer, res);
+                    ++local_count;
+                }
+                count += local_count;
+            }
+            catch(const std::exception& ex) {
+                std::cerr << "client error: " << ex.what() << std::endl;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& c : clients) {
+        c.join();
+    }
+
+    return count * 1000.0 / duration.count();
+}
+
+//------------------------------------------------------------------------------
+double
+run(bool sharded, int threads, int connections, std::chrono::milliseconds duration)
+{
+    beauty::application app;
+    app.set_sharded(sharded);
+
+    beauty::server server(app);
+    server.add_route("/hello").get([](const auto& req, auto& res) {
+        res.set(beauty::content_type::text_plain);
+        res.body() = "Hello";
+    });
+
+    server.concurrency(threads).listen(0, "127.0.0.1");
+
+    auto result = requests_per_second(server.port(), connections, duration);
+
+    server.stop();
+    return result;
+}
+}
+
+//------------------------------------------------------------------------------
+// Throughput of a shared io_context with strands and of a sharded application
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    auto duration = std::chrono::milliseconds(argc > 1 ? std::stoi(argv[1]) : 2000);
+    int connections = (argc > 2 ? std::stoi(argv[2]) : 64);
+
+    std::cout << "threads\tshared (req/s)\tsharded (req/s)" << std::endl;
+
+    for (int threads : {1, 4, 16}) {
+        auto shared = run(false, threads, connections, duration);
+        auto sharded = run(true, threads, connections, duration);
+
+        std::cout << threads << "\t" << (long)shared << "\t\t" << (long)sharded << std::endl;
+    }
+}
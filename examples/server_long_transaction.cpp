@@ -7,11 +7,15 @@ int main()
 
     server.concurrency(5);
 
-    server.get("/slow-response", [](const auto& req, auto& res) {
-        std::cout <<"Sleep for 7 sec.." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(7));
-    })
-    .get("/fast-response", [](const auto& req, auto& res) {
+    // The slow handler runs on the compute pool, not on the I/O threads
+    server.add_route("/slow-response")
+        .policy(beauty::execution_policy::offload)
+        .get([](const auto& req, auto& res) {
+            std::cout <<"Sleep for 7 sec.." << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(7));
+        });
+
+    server.get("/fast-response", [](const auto& req, auto& res) {
         std::cout <<"Sleep for 2 sec.." << std::endl;
         std::this_thread::sleep_for(std::chrono::seconds(2));
     });
@@ -2,26 +2,32 @@
 
 #include <beauty/application.hpp>
 #include <beauty/router.hpp>
+#include <beauty/server_settings.hpp>
 #include <beauty/endpoint.hpp>
 #include <beauty/export.hpp>
 
 #include <boost/asio.hpp>
 
 #include <memory>
+#include <vector>
 
 namespace asio = boost::asio;
 
 namespace beauty {
 
 //---------------------------------------------------------------------------
-// Accepts incoming connections and launches the sessions
+// Accepts incoming connections and launches the sessions.
+// With a sharded application (already started), there is one listening
+// socket per shard bound with SO_REUSEPORT, or a single one dispatching
+// the connections on the shards in turn if SO_REUSEPORT is not available.
 //---------------------------------------------------------------------------
 class BEAUTY_EXPORT acceptor : public std::enable_shared_from_this<acceptor>
 {
 public:
     acceptor(application& app,
         beauty::endpoint& endpoint,
-        const beauty::router& router);
+        const beauty::router& router,
+        const beauty::server_settings& settings = {});
 
     ~acceptor();
 
@@ -29,14 +35,18 @@ public:
     void run();
     void stop();
 
-    void do_accept();
-    void on_accept(boost::system::error_code ec);
+    void do_accept(std::size_t index);
+    void on_accept(std::size_t index, boost::system::error_code ec, asio::ip::tcp::socket&& socket);
+
+private:
+    bool open(asio::ip::tcp::acceptor& acceptor, beauty::endpoint& endpoint, bool sharded);
 
 private:
     application&                _app;
-    asio::ip::tcp::acceptor     _acceptor;
-    asio::ip::tcp::socket       _socket;
+    std::vector<std::unique_ptr<asio::ip::tcp::acceptor>> _acceptors;
+    std::size_t                 _next_shard{0};
     const beauty::router&       _router;
+    beauty::server_settings     _settings;
 };
 
 }
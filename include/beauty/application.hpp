@@ -9,10 +9,14 @@
 #include <boost/asio/ssl.hpp>
 #endif
 
+#include <memory>
 #include <vector>
 #include <thread>
 #include <optional>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 namespace asio = boost::asio;
 
@@ -52,8 +56,21 @@ public:
     // Wait for the application to be stopped, blocking
     void wait() const;
 
+    // Wait for done(), blocking, false if the application is stopped first.
+    // done() is checked again after each notify(), making the update.
+    bool wait_until(const std::function<bool()>& done);
+    void notify(const std::function<void()>& update);
+
     void post(std::function<void()>);
 
+    // Run a blocking or heavy work on the compute pool, created on first use,
+    // separated from the I/O threads
+    void offload(std::function<void()>);
+
+    // Size of the compute pool, hardware concurrency by default.
+    // Only has effect before the first offload.
+    void set_compute_threads(int count) { _compute_threads = count; }
+
     asio::io_context& ioc() { return is_ioc_owner() ? _ioc: *_ioc_external; }
     bool is_ioc_owner() const noexcept { return !_ioc_external; }
 
@@ -72,6 +89,16 @@ public:
     // Only has effect before start() is called.
     void set_thread_name_prefix(const std::string& prefix) { _thread_name_prefix = prefix; }
 
+    // One io_context per thread started by start(), the accepted connections
+    // stay on one thread for their whole life, without strand.
+    // Only has effect before start() is called, and on an owned io_context.
+    void set_sharded(bool sharded) { _sharded = sharded; }
+    bool is_sharded() const { return _sharded && is_ioc_owner(); }
+
+    // The first shard is ioc(), the only one if not sharded
+    std::size_t shard_count() const { return 1 + _shards.size(); }
+    asio::io_context& shard(std::size_t index) { return index == 0 ? ioc() : _shards[index - 1]->ioc; }
+
     static application& Instance();
 #if BEAUTY_ENABLE_OPENSSL
     static application& Instance(certificates&& c);
@@ -92,10 +119,24 @@ private:
 
     std::vector<std::thread>    _threads;
 
+    struct shard_context {
+        asio::io_context ioc{1};
+        asio::executor_work_guard<asio::io_context::executor_type> work{ioc.get_executor()};
+    };
+    bool _sharded{false};
+    std::vector<std::unique_ptr<shard_context>> _shards;
+
+    int _compute_threads{0};
+    std::mutex _compute_mtx;
+    std::unique_ptr<asio::thread_pool> _compute_pool;
+
     enum class State { waiting, started, stopped };
     std::atomic<State> _state{State::waiting}; // Three State allows a good ioc.restart
     std::atomic<int>   _active_threads{0}; // std::barrier in C++20
 
+    std::mutex              _wait_mtx;
+    std::condition_variable _wait_cv;
+
     std::string _thread_name_prefix = "beauty:wkr_";
 };
 
@@ -18,6 +18,7 @@ public:
     explicit attributes(const std::string& str, char sep = '&');
 
     void insert(std::string key, std::string value);
+    void clear() noexcept { _attributes.clear(); }
 
     attribute_storage::const_iterator find(const std::string& key) const {
         return _attributes.find(key);
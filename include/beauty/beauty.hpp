@@ -3,6 +3,7 @@
 #include <beauty/acceptor.hpp>
 #include <beauty/application.hpp>
 #include <beauty/client.hpp>
+#include <beauty/coroutine.hpp>
 #include <beauty/route.hpp>
 #include <beauty/request.hpp>
 #include <beauty/response.hpp>
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <beauty/export.hpp>
+
+#include <boost/asio.hpp>
+
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace asio = boost::asio;
+
+namespace beauty
+{
+class application;
+class request;
+
+// --------------------------------------------------------------------------
+// Accumulates a streamed request body in the request body, then in a
+// temporary file once the threshold is exceeded. The file is written on
+// the compute pool of the application, never on the I/O threads, and
+// removed with the spool.
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT body_spool : public std::enable_shared_from_this<body_spool>
+{
+public:
+    using flush_cb = std::function<void(std::exception_ptr)>;
+
+    body_spool(beauty::application& app, asio::any_io_executor executor, std::size_t threshold) :
+            _app(app), _executor(std::move(executor)), _threshold(threshold) {}
+    ~body_spool();
+
+    body_spool(const body_spool&) = delete;
+    body_spool& operator=(const body_spool&) = delete;
+
+    // Copied, the data to write in the file is queued. Throws the error of
+    // a previous write, if any
+    void append(beauty::request& req, const char* data, std::size_t size);
+
+    // Bytes not written yet in the file
+    std::size_t queued() const noexcept { return _queued.size() + _writing.size(); }
+
+    // The callback is called on the executor once the queued data is
+    // written, with the write error if any
+    void async_flush(flush_cb cb);
+
+    // Once flushed, close the temporary file, if any, and set it as the
+    // request body file
+    void finish(beauty::request& req);
+
+    const std::string& path() const noexcept { return _path; }
+
+private:
+    void do_write();
+    void on_write(std::exception_ptr error);
+    void write(const char* data, std::size_t size);
+
+private:
+    beauty::application&    _app;
+    asio::any_io_executor   _executor;
+    std::size_t             _threshold;
+    std::string             _path;
+    std::FILE*              _file{nullptr};     // Only used by the compute pool
+
+    std::string             _queued;
+    std::string             _writing;           // Given to the compute pool
+    bool                    _busy{false};
+    std::exception_ptr      _error;
+    flush_cb                _on_flush;
+};
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <beauty/certificate.hpp>
+#include <beauty/client_settings.hpp>
+#include <beauty/completion_handler.hpp>
 #include <beauty/request.hpp>
 #include <beauty/response.hpp>
 #include <beauty/version.hpp>
@@ -16,6 +18,7 @@
 
 #include <iostream>
 #include <functional>
+#include <vector>
 
 namespace asio = boost::asio;
 namespace beast = boost::beast;
@@ -25,10 +28,15 @@ namespace beauty
 // Ugly forward declaration to be removed...
 template<bool SSL>
 class session_client;
+template<bool SSL>
+class client_pool;
+class request_policy;
 
 using session_client_http = session_client<false>;
+using client_pool_http = client_pool<false>;
 #if BEAUTY_ENABLE_OPENSSL
 using session_client_https = session_client<true>;
+using client_pool_https = client_pool<true>;
 #endif
 
 // --------------------------------------------------------------------------
@@ -38,12 +46,50 @@ public:
     using client_cb = std::function<void(boost::system::error_code, beauty::response&&)>;
     using client_response = std::pair<boost::system::error_code, beauty::response>;
 
+#if BEAUTY_ENABLE_COROUTINES
+    using default_completion_token = asio::use_awaitable_t<>;
+#else
+    using default_completion_token = asio::use_future_t<>;
+#endif
+
+    // A request of a batch, a GET by default
+    struct request_spec {
+        std::string     url;
+        beauty::request request = {};
+    };
+    // The responses of a batch, in the requests order
+    using batch_cb = std::function<void(std::vector<client_response>&&)>;
+
+    // Streamed response body, delivered by chunks instead of the response body
+    using resume_cb = std::function<void()>;
+    using response_header_cb = std::function<void(const beauty::response& header)>;
+    using response_chunk_cb = std::function<void(const char* data, std::size_t size, resume_cb&& resume)>;
+
+    struct response_handler {
+        // Called once with the response header, before the body
+        response_header_cb  on_header = [](const auto&) {};
+        // Called for each body chunk. The next one is given once resume() is
+        // called, from the callback or later: meanwhile the connection is not
+        // read (backpressure), and the data stays valid.
+        response_chunk_cb   on_chunk;
+        // Called at the end of the body, or on error, with the response header only
+        client_cb           on_complete;
+    };
+
 public:
     client() = default;
+    explicit client(client_settings settings) : _settings(std::move(settings)) {}
 #if BEAUTY_ENABLE_OPENSSL
-    explicit client(certificates&& c);
+    explicit client(certificates&& c, client_settings settings = {});
 #endif
 
+    const client_settings& settings() const noexcept { return _settings; }
+
+    // Connections of the asynchronous requests, all the hosts together
+    client_pool_stats pool_stats() const;
+    // Hedged and retried requests, see client_settings
+    client_request_stats request_stats() const;
+
     // ---
     // GET
     // ---
@@ -177,13 +223,133 @@ public:
         put_before(std::chrono::milliseconds((int)(seconds * 1000)), url, std::move(body), std::move(cb));
     }
 
-    // Low level send request
-    static client_response
+    // ---------------
+    // Streamed bodies
+    // ---------------
+    void get_stream_before(const beauty::duration& d, const std::string& url, response_handler&& handler);
+
+    void get_stream(const std::string& url, response_handler&& handler)
+    {
+        get_stream_before(std::chrono::milliseconds(0), url, std::move(handler));
+    }
+
+    // The response body written in a file, not kept in memory
+    void get_file_before(const beauty::duration& d, const std::string& url, const std::string& path, client_cb&& cb);
+
+    void get_file(const std::string& url, const std::string& path, client_cb&& cb)
+    {
+        get_file_before(std::chrono::milliseconds(0), url, path, std::move(cb));
+    }
+
+    // -----------------
+    // Scatter - gather
+    // -----------------
+    // The requests are sent at once, on as many connections as the pool allows,
+    // within the deadline (none if 0). The callback is called once all of them
+    // are completed or, if successes is not 0, once this number of them have a
+    // 2xx response: the others are given as operation_aborted.
+    void send_all(std::vector<request_spec>&& requests, const beauty::duration& deadline,
+            batch_cb&& cb, std::size_t successes = 0);
+
+    // Low level send request. The synchronous one waits for the asynchronous
+    // request, sent by the event loop of the application on the pooled connections:
+    // thread safe, and the connections are reused from one call to the other.
+    // Any request starts application::Instance() on one thread if not started,
+    // the synchronous one from that event loop (a handler, a callback) has an
+    // event loop and a connection of its own instead. It is operation_aborted
+    // if the application is stopped before the response.
+    client_response
     send_request(beauty::request&& req, const beauty::duration& d, const std::string& url);
 
     void
     send_request(beauty::request&& req, const beauty::duration& d, const std::string& url, client_cb&& cb);
 
+    void
+    send_request(beauty::request&& req, const beauty::duration& d, const std::string& url, response_handler&& handler);
+
+    // -----------------
+    // Completion tokens
+    // -----------------
+    // The asynchronous requests for any Asio completion token: co_await
+    // client.async_get(url) in a coroutine (the default with the coroutines),
+    // a std::future, asio::redirect_error to get the error code instead of an
+    // exception... The handler is called on its associated executor, the one
+    // of the coroutine.
+    // The handler is kept in the request as is, without allocation (see
+    // completion_handler), and called in place when the connections run on
+    // its executor already (see the client_*_round_trip benchmarks).
+    template<typename CompletionToken = default_completion_token>
+    auto async_send_request(beauty::request&& req, const beauty::duration& d, const std::string& url,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return asio::async_initiate<CompletionToken, void(boost::system::error_code, beauty::response)>(
+                [this](auto handler, beauty::request req, beauty::duration d, std::string url) {
+                    send_request(std::move(req), d, url,
+                            token_handler<decltype(handler)>(std::move(handler)), nullptr);
+                },
+                token, std::move(req), d, url);
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_get_before(const beauty::duration& d, const std::string& url,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_send_request(make_request(beast::http::verb::get), d, url,
+                std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_get(const std::string& url, CompletionToken&& token = default_completion_token{})
+    {
+        return async_get_before(std::chrono::milliseconds(0), url, std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_del_before(const beauty::duration& d, const std::string& url,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_send_request(make_request(beast::http::verb::delete_), d, url,
+                std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_del(const std::string& url, CompletionToken&& token = default_completion_token{})
+    {
+        return async_del_before(std::chrono::milliseconds(0), url, std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_post_before(const beauty::duration& d, const std::string& url, std::string&& body,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_send_request(make_request(beast::http::verb::post, std::move(body)), d, url,
+                std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_post(const std::string& url, std::string&& body,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_post_before(std::chrono::milliseconds(0), url, std::move(body),
+                std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_put_before(const beauty::duration& d, const std::string& url, std::string&& body,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_send_request(make_request(beast::http::verb::put, std::move(body)), d, url,
+                std::forward<CompletionToken>(token));
+    }
+
+    template<typename CompletionToken = default_completion_token>
+    auto async_put(const std::string& url, std::string&& body,
+            CompletionToken&& token = default_completion_token{})
+    {
+        return async_put_before(std::chrono::milliseconds(0), url, std::move(body),
+                std::forward<CompletionToken>(token));
+    }
+
     // --------------------------------------------------------------------------
     // WebSocket client management
     // --------------------------------------------------------------------------
@@ -192,13 +358,60 @@ public:
     void ws_send(std::string&& data);
 
 private:
-    url             _url;
+    static beauty::request make_request(beast::http::verb method, std::string&& body = "")
+    {
+        beauty::request req;
+        req.method(method);
+        req.body() = std::move(body);
+        return req;
+    }
+
+    // The handler of a completion token, on its associated executor. Its
+    // event loop has some work until then.
+    template<typename Handler>
+    struct token_handler {
+        using work_type = std::decay_t<decltype(asio::prefer(
+                asio::get_associated_executor(std::declval<Handler&>()),
+                asio::execution::outstanding_work.tracked))>;
+
+        explicit token_handler(Handler&& h) :
+                work(asio::prefer(asio::get_associated_executor(h), asio::execution::outstanding_work.tracked)),
+                handler(std::move(h))
+        {}
+
+        // Called once, moved out as Asio does (a coroutine handler owns its frame)
+        void operator()(boost::system::error_code ec, beauty::response&& response)
+        {
+            auto w = std::move(work);
+            asio::dispatch(beast::bind_front_handler(std::move(handler), ec, std::move(response)));
+        }
+
+        work_type   work;
+        Handler     handler;
+    };
+
+    // The response body streamed if a handler is given
+    void
+    send_request(beauty::request&& req, const beauty::duration& d, const std::string& url,
+            completion_handler&& cb, std::shared_ptr<response_handler> stream);
+
+    // The event loop of the connections runs in this thread
+    bool in_event_loop() const;
+
+    // A connection, and an event loop, for this request only
+    static client_response
+    send_request_alone(beauty::request&& req, const beauty::duration& d, const std::string& url);
+
+private:
+    client_settings _settings;
 
-    // Waiting for some improvements...no more double shared_ptr
-    std::shared_ptr<session_client_http> _session_http;
+    // Connections by host, created on the first asynchronous request
+    std::shared_ptr<client_pool_http> _pool_http;
 #if BEAUTY_ENABLE_OPENSSL
-    std::shared_ptr<session_client_https> _session_https;
+    std::shared_ptr<client_pool_https> _pool_https;
 #endif
+    // Hedges and retries of the idempotent requests, with the response times by host
+    std::shared_ptr<request_policy> _policy;
 
     // Websocket management
     std::shared_ptr<websocket_client> _websocket_client;
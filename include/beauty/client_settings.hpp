@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Connection settings of a client, for the asynchronous requests
+// --------------------------------------------------------------------------
+struct client_settings {
+    using duration = std::chrono::steady_clock::duration;
+
+    // HTTP/2, negotiated with ALPN over TLS, or with prior knowledge on a
+    // plain connection. The concurrent requests are multiplexed as streams
+    // on one connection, HTTP/1.1 is used when the server does not support it.
+    bool http2 = true;
+
+    // Connections kept by host (scheme, host and port), a request waits for
+    // one to be available above the maximum
+    std::size_t max_connections_per_host = 8;
+    // Idle connections kept open, whatever their idle time
+    std::size_t min_connections_per_host = 0;
+    // An idle connection is closed after this delay
+    duration idle_timeout = std::chrono::seconds(60);
+
+    // Requests waiting for a connection by host, failed at once above
+    std::size_t max_pending_requests_per_host = 1024;
+    // Longest wait for a connection, the request timeout applies if shorter
+    duration pending_timeout = std::chrono::seconds(30);
+
+    // Hedged requests, for the idempotent methods only (GET, HEAD, OPTIONS, PUT
+    // and DELETE): without a response after the hedge delay, the request is sent
+    // again on another connection. The first response is given, the other request
+    // is cancelled.
+    bool hedging = false;
+    std::size_t max_hedges = 1;
+    // The delay is this percentile of the recent response times of the host, at
+    // least hedge_min_delay, and hedge_delay until enough of them are known
+    double hedge_percentile = 0.95;
+    duration hedge_delay = std::chrono::milliseconds(100);
+    duration hedge_min_delay = std::chrono::milliseconds(5);
+
+    // Idempotent requests sent again on a connection error, or on a 502, 503 or
+    // 504 response, within the request timeout
+    std::size_t max_retries = 0;
+    // The retries and the hedges take a token each from a bucket holding at most
+    // retry_budget_tokens, full at first, and each request adds retry_budget_ratio:
+    // under load, this part of the requests at most is sent more than once
+    double retry_budget_ratio = 0.1;
+    double retry_budget_tokens = 10;
+};
+
+// --------------------------------------------------------------------------
+// Connection pool counters of a client, all the hosts together
+// --------------------------------------------------------------------------
+struct client_pool_stats {
+    std::size_t     connections = 0;    // Open, or being opened
+    std::size_t     pending = 0;        // Requests waiting for a connection
+    std::size_t     hits = 0;           // Requests sent on an existing connection
+    std::size_t     connects = 0;       // New connections
+    std::size_t     evictions = 0;      // Idle connections closed
+    std::size_t     requeued = 0;       // Requests not written on a connection closed, sent on another one
+};
+
+// --------------------------------------------------------------------------
+// Hedged and retried requests of a client
+// --------------------------------------------------------------------------
+struct client_request_stats {
+    std::size_t     hedges = 0;         // Requests sent again after the hedge delay
+    std::size_t     hedge_wins = 0;     // Responses given by a hedged request
+    std::size_t     retries = 0;        // Requests sent again after a failure
+    std::size_t     throttled = 0;      // Hedges or retries refused, no token left
+};
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <beauty/response.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// The completion of a client request, called once: a client callback, or
+// the handler of a completion token. Move only, an Asio handler may not be
+// copied, and kept in place without allocation when small enough (the
+// handler of a coroutine with its executor). An empty std::function gives
+// an empty handler.
+// --------------------------------------------------------------------------
+class completion_handler
+{
+public:
+    static constexpr std::size_t inline_size = 128;
+
+    completion_handler() noexcept = default;
+    completion_handler(std::nullptr_t) noexcept {}
+
+    template<typename F, typename = std::enable_if_t<
+            !std::is_same_v<std::decay_t<F>, completion_handler>
+            && std::is_invocable_v<std::decay_t<F>&, boost::system::error_code, beauty::response&&>>>
+    completion_handler(F&& f)
+    {
+        using T = std::decay_t<F>;
+        if constexpr(std::is_constructible_v<bool, const T&>) {
+            if (!static_cast<bool>(f)) {
+                return; // Empty std::function, or null pointer
+            }
+        }
+
+        if constexpr(fits<T>()) {
+            ::new (static_cast<void*>(&_storage)) T(std::forward<F>(f));
+        } else {
+            *reinterpret_cast<T**>(&_storage) = new T(std::forward<F>(f));
+        }
+        _ops = &ops_of<T>::value;
+    }
+
+    completion_handler(completion_handler&& other) noexcept
+    {
+        take(other);
+    }
+
+    completion_handler& operator=(completion_handler&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    completion_handler& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    completion_handler(const completion_handler&) = delete;
+    completion_handler& operator=(const completion_handler&) = delete;
+
+    ~completion_handler() { reset(); }
+
+    explicit operator bool() const noexcept { return _ops != nullptr; }
+
+    void operator()(boost::system::error_code ec, beauty::response&& response)
+    {
+        _ops->invoke(&_storage, ec, std::move(response));
+    }
+
+    // The callable kept, if of this type
+    template<typename T>
+    T* target() noexcept
+    {
+        if (_ops != &ops_of<T>::value) {
+            return nullptr;
+        }
+        if constexpr(fits<T>()) {
+            return std::launder(reinterpret_cast<T*>(&_storage));
+        } else {
+            return *reinterpret_cast<T**>(&_storage);
+        }
+    }
+
+private:
+    using storage = std::aligned_storage_t<inline_size, alignof(std::max_align_t)>;
+
+    struct ops {
+        void (*invoke)(storage*, boost::system::error_code, beauty::response&&);
+        void (*move)(storage* from, storage* to) noexcept;
+        void (*destroy)(storage*) noexcept;
+    };
+
+    template<typename T>
+    static constexpr bool fits()
+    {
+        return sizeof(T) <= inline_size && alignof(T) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible_v<T>;
+    }
+
+    template<typename T>
+    struct ops_of {
+        static T* get(storage* s) noexcept
+        {
+            if constexpr(fits<T>()) {
+                return std::launder(reinterpret_cast<T*>(s));
+            } else {
+                return *reinterpret_cast<T**>(s);
+            }
+        }
+
+        static void invoke(storage* s, boost::system::error_code ec, beauty::response&& response)
+        {
+            (*get(s))(ec, std::move(response));
+        }
+
+        static void move(storage* from, storage* to) noexcept
+        {
+            if constexpr(fits<T>()) {
+                ::new (static_cast<void*>(to)) T(std::move(*get(from)));
+                get(from)->~T();
+            } else {
+                *reinterpret_cast<T**>(to) = get(from);
+            }
+        }
+
+        static void destroy(storage* s) noexcept
+        {
+            if constexpr(fits<T>()) {
+                get(s)->~T();
+            } else {
+                delete get(s);
+            }
+        }
+
+        static constexpr ops value = {&invoke, &move, &destroy};
+    };
+
+    void take(completion_handler& other) noexcept
+    {
+        if (other._ops) {
+            other._ops->move(&other._storage, &_storage);
+            _ops = std::exchange(other._ops, nullptr);
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (_ops) {
+            std::exchange(_ops, nullptr)->destroy(&_storage);
+        }
+    }
+
+private:
+    const ops*  _ops = nullptr;
+    storage     _storage;
+};
+
+}
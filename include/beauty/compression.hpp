@@ -0,0 +1,122 @@
+#pragma once
+
+#include <beauty/request.hpp>
+#include <beauty/response.hpp>
+#include <beauty/export.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Content codings of a response body, brotli and zstd are only available
+// if found at build time
+// --------------------------------------------------------------------------
+enum class content_coding { identity, deflate, gzip, zstd, br };
+
+BEAUTY_EXPORT std::string_view to_string(content_coding coding) noexcept;
+
+// True if the library is built with this coding
+BEAUTY_EXPORT bool is_supported(content_coding coding) noexcept;
+
+// Best supported coding accepted by an Accept-Encoding value, using the
+// quality values, then the server preference (br, zstd, gzip, deflate)
+BEAUTY_EXPORT content_coding negotiate(std::string_view accept_encoding) noexcept;
+
+// --------------------------------------------------------------------------
+struct compression_settings {
+    // Smaller bodies are sent as is
+    std::size_t min_size = 1024;
+
+    // Content types compressed, an entry ending with '/' matches the whole type
+    std::vector<std::string> content_types = {
+        "text/",
+        "application/json",
+        "application/javascript",
+        "application/xml",
+        "image/svg+xml"
+    };
+
+    int gzip_level      = 6;    // gzip and deflate, 1 to 9
+    int brotli_quality  = 5;    // 0 to 11
+    int zstd_level      = 3;    // 1 to 19
+
+    // Compressed bodies kept for the cacheable responses (with an ETag, a
+    // Last-Modified or a public max-age), with their original bodies counted
+    // as well, 0 disables the cache
+    std::size_t cache_capacity = 16 * 1024 * 1024; // 16Mo
+};
+
+// --------------------------------------------------------------------------
+// Compresses the response bodies, with the compressed variants of the
+// cacheable responses kept in a LRU cache, found by a hash of the body and
+// served only if the original body kept with them is the same
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT response_compressor
+{
+public:
+    explicit response_compressor(compression_settings settings = {});
+
+    response_compressor(const response_compressor&) = delete;
+    response_compressor& operator=(const response_compressor&) = delete;
+
+    const compression_settings& settings() const noexcept { return _settings; }
+
+    // Compress the body if accepted by the request, and if the status, the
+    // content type and the size are eligible. Returns the coding applied.
+    content_coding compress(const beauty::request& req, beauty::response& res);
+
+    // Compress a body, an empty result on error
+    std::string compress(std::string_view body, content_coding coding) const;
+
+    std::size_t cache_size() const;
+    std::size_t cache_hits() const;
+
+private:
+    bool is_eligible(const beauty::response& res) const;
+
+private:
+    compression_settings    _settings;
+
+    struct cache_key {
+        content_coding  coding;
+        std::size_t     size;
+        std::size_t     hash;
+
+        bool operator==(const cache_key& other) const noexcept {
+            return coding == other.coding && size == other.size && hash == other.hash;
+        }
+    };
+    struct cache_key_hash {
+        std::size_t operator()(const cache_key& key) const noexcept {
+            return key.hash ^ (key.size << 4) ^ static_cast<std::size_t>(key.coding);
+        }
+    };
+
+    struct cache_entry {
+        cache_key                           key;
+        std::string                         body;   // The original one, compared on lookup
+        std::shared_ptr<const std::string>  compressed;
+
+        std::size_t bytes() const noexcept { return body.size() + compressed->size(); }
+    };
+
+    // Compressed bodies, most recently used first
+    using lru_list = std::list<cache_entry>;
+
+    mutable std::mutex      _cache_mtx;
+    lru_list                _cache;
+    std::unordered_map<cache_key, lru_list::iterator, cache_key_hash> _cache_index;
+    std::size_t             _cache_bytes = 0;
+    std::size_t             _cache_hits = 0;
+};
+
+}
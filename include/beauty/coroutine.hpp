@@ -0,0 +1,85 @@
+#pragma once
+
+#if BEAUTY_ENABLE_COROUTINES
+
+#include <beauty/application.hpp>
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Suspend the coroutine without blocking the I/O thread
+// --------------------------------------------------------------------------
+inline asio::awaitable<void>
+sleep_for(std::chrono::steady_clock::duration d)
+{
+    asio::steady_timer timer(co_await asio::this_coro::executor, d);
+    co_await timer.async_wait(asio::use_awaitable);
+}
+
+// --------------------------------------------------------------------------
+// Run a blocking or heavy function on the application compute pool, the
+// coroutine is resumed on its executor with the result or the exception
+// --------------------------------------------------------------------------
+template<typename F>
+asio::awaitable<std::invoke_result_t<std::decay_t<F>&>>
+offload(beauty::application& app, F&& f)
+{
+    using result_type = std::invoke_result_t<std::decay_t<F>&>;
+    using stored_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+    auto executor = co_await asio::this_coro::executor;
+    auto fct = std::forward<F>(f);
+
+    std::optional<stored_type> result;
+    std::exception_ptr error;
+
+    // The locals live in the coroutine frame while suspended
+    co_await asio::async_initiate<const asio::use_awaitable_t<>&, void()>(
+        [&](auto handler) {
+            // The awaitable handler is move only, std::function needs a copyable callable
+            auto h = std::make_shared<decltype(handler)>(std::move(handler));
+            app.offload([&, h, executor] {
+                try {
+                    if constexpr (std::is_void_v<result_type>) {
+                        fct();
+                        result.emplace(true);
+                    } else {
+                        result.emplace(fct());
+                    }
+                }
+                catch(...) {
+                    error = std::current_exception();
+                }
+                asio::post(executor, [h] { (*h)(); });
+            });
+        },
+        asio::use_awaitable);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<result_type>) {
+        co_return std::move(*result);
+    }
+}
+
+// --------------------------------------------------------------------------
+template<typename F>
+asio::awaitable<std::invoke_result_t<std::decay_t<F>&>>
+offload(F&& f)
+{
+    return beauty::offload(beauty::application::Instance(), std::forward<F>(f));
+}
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <beauty/export.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beauty::hpack
+{
+// --------------------------------------------------------------------------
+// HPACK header compression for HTTP/2 (RFC 7541)
+// --------------------------------------------------------------------------
+struct field {
+    std::string name;
+    std::string value;
+};
+
+// Huffman coding of the string literals
+BEAUTY_EXPORT std::size_t huffman_size(std::string_view s) noexcept;
+BEAUTY_EXPORT void huffman_encode(std::string_view s, std::string& out);
+// False on an invalid code, an EOS symbol or a wrong padding
+BEAUTY_EXPORT bool huffman_decode(const std::uint8_t* data, std::size_t size, std::string& out);
+
+// Header field representation, the static table only: no dynamic table
+// state to keep in sync with the peer. The name is written in lower case,
+// the value Huffman coded if shorter.
+BEAUTY_EXPORT void encode(std::string& out, std::string_view name, std::string_view value);
+
+// --------------------------------------------------------------------------
+// Header blocks decoder, with the dynamic table of a connection
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT decoder
+{
+public:
+    // The table size given in the SETTINGS_HEADER_TABLE_SIZE of the connection
+    explicit decoder(std::size_t max_table_size = 4096);
+
+    // Decode a whole header block, false on a compression error which is
+    // a connection error. The fields are appended, in the block order.
+    // The decoded list is limited to max_list_size, in the unit of the
+    // SETTINGS_MAX_HEADER_LIST_SIZE (32 bytes per field overhead), against
+    // small blocks of references to large entries.
+    bool decode(const std::uint8_t* data, std::size_t size, std::vector<field>& fields,
+                std::size_t max_list_size = static_cast<std::size_t>(-1));
+
+    // Current dynamic table size, in the RFC unit (32 bytes per entry overhead)
+    std::size_t table_size() const noexcept { return _table_size; }
+
+private:
+    const field* find(std::uint64_t index) const noexcept;
+    void insert(field f);
+    void evict(std::size_t max_size);
+
+private:
+    std::deque<field>   _table; // Most recent first
+    std::size_t         _table_size = 0;
+    std::size_t         _max_table_size;
+    const std::size_t   _settings_table_size;
+};
+
+}
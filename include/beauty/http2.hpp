@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace beauty::http2
+{
+// --------------------------------------------------------------------------
+// HTTP/2 protocol constants (RFC 9113)
+// --------------------------------------------------------------------------
+enum class frame_type : std::uint8_t {
+    data = 0x0, headers = 0x1, priority = 0x2, rst_stream = 0x3, settings = 0x4,
+    push_promise = 0x5, ping = 0x6, goaway = 0x7, window_update = 0x8, continuation = 0x9
+};
+
+namespace flags {
+constexpr std::uint8_t end_stream   = 0x1;
+constexpr std::uint8_t ack          = 0x1;
+constexpr std::uint8_t end_headers  = 0x4;
+constexpr std::uint8_t padded       = 0x8;
+constexpr std::uint8_t priority     = 0x20;
+}
+
+enum class error_code : std::uint32_t {
+    no_error = 0x0, protocol_error = 0x1, internal_error = 0x2, flow_control_error = 0x3,
+    settings_timeout = 0x4, stream_closed = 0x5, frame_size_error = 0x6, refused_stream = 0x7,
+    cancel = 0x8, compression_error = 0x9, connect_error = 0xa, enhance_your_calm = 0xb,
+    inadequate_security = 0xc, http_1_1_required = 0xd
+};
+
+enum class setting : std::uint16_t {
+    header_table_size = 0x1, enable_push = 0x2, max_concurrent_streams = 0x3,
+    initial_window_size = 0x4, max_frame_size = 0x5, max_header_list_size = 0x6
+};
+
+constexpr std::string_view client_preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr std::size_t frame_header_size = 9;
+constexpr std::uint32_t default_window_size = 65535;
+constexpr std::uint32_t default_max_frame_size = 16384;
+constexpr std::uint32_t max_window_size = 0x7fffffff;
+
+// --------------------------------------------------------------------------
+inline void
+append_frame_header(std::string& out, std::size_t length, frame_type type, std::uint8_t flags, std::uint32_t stream_id)
+{
+    const char header[frame_header_size] = {
+        static_cast<char>(length >> 16), static_cast<char>(length >> 8), static_cast<char>(length),
+        static_cast<char>(type), static_cast<char>(flags),
+        static_cast<char>((stream_id >> 24) & 0x7f), static_cast<char>(stream_id >> 16),
+        static_cast<char>(stream_id >> 8), static_cast<char>(stream_id)
+    };
+    out.append(header, frame_header_size);
+}
+
+// --------------------------------------------------------------------------
+inline void
+append_uint32(std::string& out, std::uint32_t value)
+{
+    const char bytes[4] = {
+        static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+        static_cast<char>(value >> 8), static_cast<char>(value)
+    };
+    out.append(bytes, 4);
+}
+
+// --------------------------------------------------------------------------
+inline std::uint32_t
+read_uint32(const std::uint8_t* p) noexcept
+{
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+// --------------------------------------------------------------------------
+inline void
+append_setting(std::string& out, setting id, std::uint32_t value)
+{
+    out.push_back(static_cast<char>(static_cast<std::uint16_t>(id) >> 8));
+    out.push_back(static_cast<char>(static_cast<std::uint16_t>(id)));
+    append_uint32(out, value);
+}
+
+// --------------------------------------------------------------------------
+// Padding of a DATA or HEADERS frame removed, false on a wrong padding
+// --------------------------------------------------------------------------
+inline bool
+unpad(std::uint8_t frame_flags, const std::uint8_t*& payload, std::size_t& length) noexcept
+{
+    if (!(frame_flags & flags::padded)) {
+        return true;
+    }
+    if (length == 0 || payload[0] >= length) {
+        return false;
+    }
+    length -= 1 + payload[0];
+    payload += 1;
+    return true;
+}
+
+}
@@ -0,0 +1,1323 @@
+#pragma once
+
+#include <beauty/application.hpp>
+#include <beauty/router.hpp>
+#include <beauty/server_settings.hpp>
+#include <beauty/body_spool.hpp>
+#include <beauty/message_pool.hpp>
+#include <beauty/version.hpp>
+#include <beauty/utils.hpp>
+#include <beauty/exception.hpp>
+#include <beauty/hpack.hpp>
+#include <beauty/http2.hpp>
+#include <beauty/base64.hpp>
+
+#include <boost/beast.hpp>
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+
+namespace beauty {
+// --------------------------------------------------------------------------
+// Handles an HTTP/2 server connection, handed over by the HTTP/1 session
+// once h2 is negotiated with ALPN, or on a h2c prior knowledge or upgrade.
+// The streams are dispatched to the same router, the responses are sent
+// interleaved within the flow control windows of the client.
+//---------------------------------------------------------------------------
+template<typename Stream, typename Executor>
+class http2_session : public std::enable_shared_from_this<http2_session<Stream, Executor>>
+{
+public:
+    using timer_type = asio::basic_waitable_timer<std::chrono::steady_clock,
+            asio::wait_traits<std::chrono::steady_clock>, Executor>;
+
+    // The stream is owned by the HTTP/1 session, kept alive with the owner
+    http2_session(beauty::application& app, Executor executor, Stream& stream, std::shared_ptr<void> owner,
+            const beauty::router& router, const beauty::server_settings& settings, beauty::endpoint remote) :
+          _app(app),
+          _executor(std::move(executor)),
+          _stream(stream),
+          _owner(std::move(owner)),
+          _router(router),
+          _settings(settings),
+          _remote(std::move(remote)),
+          _timer(_executor)
+    {}
+
+    // Start with the bytes already read, still beginning with the end of
+    // the client preface given. An upgraded HTTP/1.1 request is the stream 1.
+    void run(beast::flat_buffer&& buffer, std::string_view preface,
+            std::shared_ptr<beauty::request> upgrade = nullptr)
+    {
+        _buffer = std::move(buffer);
+        _preface = preface;
+
+        // Small control frames (WINDOW_UPDATE, PING, SETTINGS ack) are not delayed
+        boost::system::error_code ec;
+        _stream.lowest_layer().set_option(asio::ip::tcp::no_delay(true), ec);
+
+        if (upgrade) {
+            _out.push_back({"HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n"});
+        }
+
+        // The server preface, with a larger connection window for the uploads
+        std::string frame;
+        http2::append_frame_header(frame, 3 * 6, http2::frame_type::settings, 0, 0);
+        http2::append_setting(frame, http2::setting::max_concurrent_streams, max_concurrent_streams());
+        http2::append_setting(frame, http2::setting::initial_window_size, WINDOW_SIZE);
+        http2::append_setting(frame, http2::setting::max_header_list_size, HEADER_BLOCK_LIMIT);
+        http2::append_frame_header(frame, 4, http2::frame_type::window_update, 0, 0);
+        http2::append_uint32(frame, WINDOW_SIZE - http2::default_window_size);
+        _out.push_back({std::move(frame)});
+        _recv_window = WINDOW_SIZE;
+
+        update_timer();
+        if (upgrade && !on_upgrade(std::move(upgrade))) {
+            return do_write();
+        }
+
+        on_read({}, 0);
+    }
+
+private:
+    // Response being sent on a stream
+    struct stream_state {
+        std::shared_ptr<beauty::request>        req;
+        std::shared_ptr<response>               res;
+        std::shared_ptr<static_file_response>   file;
+        const beauty::route*                    route = nullptr;
+        static_files*                           files = nullptr;
+        std::shared_ptr<body_spool>             spool;
+
+        std::int64_t    send_window = http2::default_window_size;
+        std::int64_t    recv_window = WINDOW_SIZE;
+        std::uint64_t   body_limit = BODY_LIMIT;
+        std::uint64_t   received = 0;   // Request body bytes
+        std::uint64_t   offset = 0;     // Response body bytes sent
+        std::uint64_t   remain = 0;     // Body bytes to send
+        std::chrono::steady_clock::time_point body_deadline = std::chrono::steady_clock::time_point::max();
+        bool remote_closed = false;     // END_STREAM received
+        bool dispatched = false;
+        bool ready = false;             // Response ready to be sent
+        bool headers_sent = false;
+    };
+
+    // A frame to write, the payload references a response body kept alive
+    struct outgoing {
+        std::string             bytes;
+        asio::const_buffer      payload = {};
+        std::shared_ptr<response> keep = {};
+    };
+
+    static constexpr std::uint32_t WINDOW_SIZE = 1024 * 1024;           // Per stream, and per connection
+    static constexpr std::uint32_t HEADER_BLOCK_LIMIT = 64 * 1024;
+    static constexpr std::uint64_t BODY_LIMIT = 1024 * 1024 * 1024;     // 1Go..
+    static constexpr std::size_t READ_SIZE = 64 * 1024;
+    static constexpr std::size_t WRITE_HIGH_WATER = 256 * 1024;         // Data frames queued at a time
+
+    std::uint32_t max_concurrent_streams() const noexcept
+    {
+        return static_cast<std::uint32_t>(_settings.http2_max_concurrent_streams
+                ? _settings.http2_max_concurrent_streams : http2::max_window_size);
+    }
+
+    // The upgraded request, with the client settings given in the HTTP2-Settings header
+    bool on_upgrade(std::shared_ptr<beauty::request> req)
+    {
+        auto encoded = std::string((*req)["HTTP2-Settings"]);
+        std::replace(encoded.begin(), encoded.end(), '-', '+');
+        std::replace(encoded.begin(), encoded.end(), '_', '/');
+        encoded.resize((encoded.size() + 3) / 4 * 4, '=');
+        auto payload = base64::decode(encoded.begin(), encoded.end());
+
+        if (!apply_settings(reinterpret_cast<const std::uint8_t*>(payload.data()), payload.size())) {
+            return false;
+        }
+
+        req->erase(beast::http::field::upgrade);
+        req->erase(beast::http::field::connection);
+        req->erase("HTTP2-Settings");
+        req->version(20);
+
+        _last_stream_id = 1;
+        auto& s = open_stream(1, std::move(req));
+        on_end_stream(1, s);
+        return true;
+    }
+
+    void do_read()
+    {
+        if (_read_closed) {
+            return;
+        }
+
+        _stream.async_read_some(_buffer.prepare(READ_SIZE),
+            asio::bind_executor(
+                _executor,
+                [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
+                    me->on_read(ec, bytes_transferred);
+                }));
+    }
+
+    void on_read(boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        if (ec) {
+            _read_closed = true;
+            _streams.clear();
+            if (ec != asio::error::eof && ec != asio::error::operation_aborted) {
+                fail(ec, "read");
+            }
+            return do_close();
+        }
+        _buffer.commit(bytes_transferred);
+
+        // The responses of the frames read are gathered in one write
+        _processing = true;
+        process();
+        _processing = false;
+
+        do_send();
+        do_write();
+        do_read();
+    }
+
+    // Handle the complete frames read
+    void process()
+    {
+        if (!_preface.empty()) {
+            auto size = std::min(_preface.size(), _buffer.size());
+            if (std::string_view(static_cast<const char*>(_buffer.data().data()), size) != _preface.substr(0, size)) {
+                _read_closed = true;
+                return;
+            }
+            _buffer.consume(size);
+            _preface.remove_prefix(size);
+            if (!_preface.empty()) {
+                return;
+            }
+        }
+
+        while (!_read_closed && _buffer.size() >= http2::frame_header_size) {
+            const auto* p = static_cast<const std::uint8_t*>(_buffer.data().data());
+            const std::size_t length = (std::size_t(p[0]) << 16) | (std::size_t(p[1]) << 8) | p[2];
+            const auto type = static_cast<http2::frame_type>(p[3]);
+            const std::uint8_t flags = p[4];
+            const std::uint32_t id = http2::read_uint32(p + 5) & 0x7fffffff;
+
+            if (length > http2::default_max_frame_size) {
+                return connection_error(http2::error_code::frame_size_error);
+            }
+            if (_buffer.size() < http2::frame_header_size + length) {
+                return;
+            }
+
+            on_frame(type, flags, id, p + http2::frame_header_size, length);
+            _buffer.consume(http2::frame_header_size + length);
+        }
+    }
+
+    void on_frame(http2::frame_type type, std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        // The first frame is the client settings, a header block is not interrupted
+        if (!_settings_received && type != http2::frame_type::settings) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (_continuation_id && (type != http2::frame_type::continuation || id != _continuation_id)) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+
+        switch(type) {
+            case http2::frame_type::data:           return on_data(flags, id, payload, length);
+            case http2::frame_type::headers:        return on_headers(flags, id, payload, length);
+            case http2::frame_type::continuation:   return on_continuation(flags, id, payload, length);
+            case http2::frame_type::rst_stream:     return on_rst_stream(id, length);
+            case http2::frame_type::settings:       return on_settings(flags, id, payload, length);
+            case http2::frame_type::ping:           return on_ping(flags, id, payload, length);
+            case http2::frame_type::goaway:         return on_goaway(id);
+            case http2::frame_type::window_update:  return on_window_update(id, payload, length);
+            case http2::frame_type::push_promise:   return connection_error(http2::error_code::protocol_error);
+            case http2::frame_type::priority:
+                if (length != 5) {
+                    return stream_error(id, http2::error_code::frame_size_error);
+                }
+                return; // No prioritization
+            default:
+                return; // Unknown frames are ignored
+        }
+    }
+
+    void on_headers(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (id == 0 || id % 2 == 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (!http2::unpad(flags, payload, length)) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (flags & http2::flags::priority) {
+            if (length < 5) {
+                return connection_error(http2::error_code::frame_size_error);
+            }
+            payload += 5;
+            length -= 5;
+        }
+
+        if (length > HEADER_BLOCK_LIMIT) {
+            return connection_error(http2::error_code::enhance_your_calm);
+        }
+
+        _header_block.assign(reinterpret_cast<const char*>(payload), length);
+        if (flags & http2::flags::end_headers) {
+            return on_header_block(flags, id);
+        }
+        _continuation_id = id;
+        _continuation_flags = flags;
+        _header_deadline = deadline(_settings.header_timeout);
+        update_timer();
+    }
+
+    void on_continuation(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (!_continuation_id) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (_header_block.size() + length > HEADER_BLOCK_LIMIT) {
+            return connection_error(http2::error_code::enhance_your_calm);
+        }
+
+        _header_block.append(reinterpret_cast<const char*>(payload), length);
+        if (flags & http2::flags::end_headers) {
+            _continuation_id = 0;
+            _header_deadline = std::chrono::steady_clock::time_point::max();
+            on_header_block(_continuation_flags, id);
+            update_timer();
+        }
+    }
+
+    void on_header_block(std::uint8_t flags, std::uint32_t id)
+    {
+        // Always decoded, the dynamic table is shared by the streams. The
+        // decoded list is limited to the SETTINGS_MAX_HEADER_LIST_SIZE sent.
+        _fields.clear();
+        if (!_decoder.decode(reinterpret_cast<const std::uint8_t*>(_header_block.data()), _header_block.size(),
+                    _fields, HEADER_BLOCK_LIMIT)) {
+            return connection_error(http2::error_code::compression_error);
+        }
+
+        if (auto found = _streams.find(id); found != _streams.end()) {
+            // Trailer fields, ending the stream
+            auto& s = found->second;
+            if (s.remote_closed) {
+                return stream_error(id, http2::error_code::stream_closed);
+            }
+            if (!(flags & http2::flags::end_stream)) {
+                return stream_error(id, http2::error_code::protocol_error);
+            }
+            for (const auto& f : _fields) {
+                if (!f.name.empty() && f.name[0] != ':') {
+                    s.req->insert(f.name, f.value);
+                }
+            }
+            return on_end_stream(id, s);
+        }
+
+        // A new stream identifier must be greater than all the previous ones
+        // (RFC 9113 5.1.1), a closed stream is no exception
+        if (id <= _last_stream_id) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        _last_stream_id = id;
+
+        // No new stream once the connection is closing
+        if (_goaway_sent) {
+            return;
+        }
+        if (_streams.size() >= max_concurrent_streams()) {
+            return stream_error(id, http2::error_code::refused_stream);
+        }
+
+        auto req = request_pool::acquire();
+        if (!make_request(*req)) {
+            return stream_error(id, http2::error_code::protocol_error);
+        }
+
+        // The last request allowed, no other stream is accepted
+        if (_settings.max_requests_per_connection
+                && ++_request_count >= _settings.max_requests_per_connection) {
+            send_goaway(http2::error_code::no_error);
+        }
+
+        auto& s = open_stream(id, std::move(req));
+        auto content_length = (*s.req)[beast::http::field::content_length];
+        if (!content_length.empty()
+                && std::strtoull(std::string(content_length).c_str(), nullptr, 10) > s.body_limit) {
+            return reject(id, s);
+        }
+
+        if (flags & http2::flags::end_stream) {
+            on_end_stream(id, s);
+        }
+    }
+
+    // The request from the decoded fields, false on a malformed request
+    bool make_request(beauty::request& req)
+    {
+        std::string_view method, scheme, path, authority;
+        std::string cookie;
+        bool regular = false;
+
+        for (const auto& f : _fields) {
+            if (std::any_of(f.name.begin(), f.name.end(), [](unsigned char c) { return std::isupper(c); })) {
+                return false;
+            }
+
+            if (!f.name.empty() && f.name[0] == ':') {
+                if (regular) {
+                    return false; // Pseudo-header after a regular field
+                }
+                if (f.name == ":method") method = f.value;
+                else if (f.name == ":scheme") scheme = f.value;
+                else if (f.name == ":path") path = f.value;
+                else if (f.name == ":authority") authority = f.value;
+                else return false;
+                continue;
+            }
+            regular = true;
+
+            if (f.name == "connection" || f.name == "keep-alive" || f.name == "proxy-connection"
+                    || f.name == "transfer-encoding" || f.name == "upgrade") {
+                return false; // Connection-specific fields are not allowed
+            }
+            if (f.name == "cookie") {
+                // Cookie fields may be split, and are joined again for HTTP/1
+                cookie.append(cookie.empty() ? "" : "; ").append(f.value);
+                continue;
+            }
+            req.insert(f.name, f.value);
+        }
+
+        if (method.empty() || scheme.empty() || path.empty()) {
+            return false;
+        }
+
+        req.method_string(beast::string_view{method.data(), method.size()});
+        req.target(beast::string_view{path.data(), path.size()});
+        req.version(20);
+        if (!cookie.empty()) {
+            req.set(beast::http::field::cookie, cookie);
+        }
+        if (!authority.empty() && !req.count(beast::http::field::host)) {
+            req.set(beast::http::field::host, beast::string_view{authority.data(), authority.size()});
+        }
+        req.remote(_remote);
+        return true;
+    }
+
+    stream_state& open_stream(std::uint32_t id, std::shared_ptr<beauty::request> req)
+    {
+        auto& s = _streams[id];
+        s.req = std::move(req);
+        s.send_window = _peer_initial_window;
+
+        // Try to match a route for this request target
+        auto& r = *s.req;
+        if (_router.find(r.method()) != _router.end()) {
+            s.route = _router.match(r.method(), r, false);
+        }
+
+        // Static files are only looked for when no route matches
+        if (!s.route && (r.method() == beast::http::verb::get || r.method() == beast::http::verb::head)) {
+            auto target = std::string_view{r.target().data(), r.target().size()};
+            s.files = _router.match_static(target.substr(0, target.find('?')));
+        }
+
+        if (s.route && s.route->is_streaming()) {
+            s.body_limit = s.route->stream_handler().body_limit;
+            if (!s.route->stream_handler().on_chunk) {
+                s.spool = std::make_shared<body_spool>(_app, _executor, s.route->stream_handler().spool_threshold);
+            }
+        }
+
+        // The whole body is received within the body timeout, cleared by END_STREAM
+        s.body_deadline = deadline(_settings.body_timeout);
+        update_timer();
+        return s;
+    }
+
+    void on_data(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (id == 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+
+        // The whole frame counts for the flow control, padding included
+        if (static_cast<std::int64_t>(length) > _recv_window) {
+            return connection_error(http2::error_code::flow_control_error);
+        }
+        _recv_window -= length;
+        if (WINDOW_SIZE - _recv_window >= WINDOW_SIZE / 2) {
+            send_window_update(0, static_cast<std::uint32_t>(WINDOW_SIZE - _recv_window));
+            _recv_window = WINDOW_SIZE;
+        }
+
+        auto found = _streams.find(id);
+        if (found == _streams.end()) {
+            if (id > _last_stream_id) {
+                return connection_error(http2::error_code::protocol_error);
+            }
+            return; // Reset meanwhile
+        }
+
+        auto& s = found->second;
+        if (s.remote_closed) {
+            return stream_error(id, http2::error_code::stream_closed);
+        }
+        if (static_cast<std::int64_t>(length) > s.recv_window) {
+            return stream_error(id, http2::error_code::flow_control_error);
+        }
+        s.recv_window -= length;
+
+        if (!http2::unpad(flags, payload, length)) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+
+        if (s.dispatched) {
+            // Answered already on an error, the remaining body is ignored
+        }
+        else if (s.received + length > s.body_limit) {
+            return reject(id, s);
+        }
+        else if (length) {
+            s.received += length;
+            if (s.route && s.route->is_streaming()) {
+                // Each chunk of a streaming route within the body timeout
+                s.body_deadline = deadline(_settings.body_timeout);
+            }
+            try {
+                if (s.spool) {
+                    s.spool->append(*s.req, reinterpret_cast<const char*>(payload), length);
+                } else if (s.route && s.route->is_streaming()) {
+                    s.route->chunk(*s.req, reinterpret_cast<const char*>(payload), length);
+                } else {
+                    s.req->body().append(reinterpret_cast<const char*>(payload), length);
+                }
+            }
+            catch(const beauty::exception& ex) {
+                dispatch(id, s, ex.create_response(*s.req));
+            }
+            catch(const std::exception& ex) {
+                dispatch(id, s, helper::server_error(*s.req, ex.what()));
+            }
+        }
+
+        if (flags & http2::flags::end_stream) {
+            return on_end_stream(id, s);
+        }
+
+        // Consumed at once, the window is given back by halves
+        if (WINDOW_SIZE - s.recv_window >= WINDOW_SIZE / 2) {
+            send_window_update(id, static_cast<std::uint32_t>(WINDOW_SIZE - s.recv_window));
+            s.recv_window = WINDOW_SIZE;
+        }
+    }
+
+    // The body is too large, answered before being fully received
+    void reject(std::uint32_t id, stream_state& s)
+    {
+        dispatch(id, s, beauty::exception(beast::http::status::payload_too_large, "Request body too large")
+                .create_response(*s.req));
+    }
+
+    void on_end_stream(std::uint32_t id, stream_state& s)
+    {
+        s.remote_closed = true;
+        s.body_deadline = std::chrono::steady_clock::time_point::max();
+        if (s.dispatched) {
+            return;
+        }
+
+        if (s.spool) {
+            // The spool file is written on the compute pool
+            return s.spool->async_flush([me = this->shared_from_this(), id](std::exception_ptr error) {
+                me->on_spool_flushed(id, error);
+            });
+        }
+
+        dispatch(id, s);
+    }
+
+    void on_spool_flushed(std::uint32_t id, std::exception_ptr error)
+    {
+        auto found = _streams.find(id);
+        if (found == _streams.end() || found->second.dispatched) {
+            return; // Reset meanwhile
+        }
+        auto& s = found->second;
+
+        std::shared_ptr<response> res;
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            s.spool->finish(*s.req);
+        }
+        catch(const beauty::exception& ex) {
+            res = ex.create_response(*s.req);
+        }
+        catch(const std::exception& ex) {
+            res = helper::server_error(*s.req, ex.what());
+        }
+
+        dispatch(id, s, res);
+    }
+
+    // Call the route handler, or serve the static file
+    void dispatch(std::uint32_t id, stream_state& s, std::shared_ptr<response> res = nullptr)
+    {
+        s.dispatched = true;
+
+        if (!res && s.files) {
+            try {
+                s.file = s.files->serve(*s.req);
+            }
+            catch(const std::exception& ex) {
+                res = helper::server_error(*s.req, ex.what());
+            }
+            if (s.file) {
+                s.ready = true;
+                return start_response(id, s);
+            }
+        }
+
+#if BEAUTY_ENABLE_COROUTINES
+        if (!res && s.route && s.route->is_coroutine()) {
+            return execute_awaitable(id, s.req, s.route);
+        }
+#endif
+        if (!res && s.route && s.route->policy() == execution_policy::offload) {
+            // The handler runs on the compute pool, the response is given back to the session executor
+            _app.offload([me = this->shared_from_this(), id, req = s.req, route = s.route] {
+                auto res = execute(*route, *req);
+                asio::post(me->_executor, [me, id, req, res] { me->on_executed(id, req, res); });
+            });
+            return;
+        }
+
+        if (!res) {
+            if (_router.find(s.req->method()) == _router.end() && !s.files) {
+                res = helper::bad_request(*s.req, "Not supported HTTP-method");
+            } else if (!s.route) {
+                res = helper::not_found(*s.req);
+            } else {
+                res = execute(*s.route, *s.req);
+            }
+        }
+        on_executed(id, s.req, res);
+    }
+
+    void on_executed(std::uint32_t id, const std::shared_ptr<beauty::request>& req, const std::shared_ptr<response>& res)
+    {
+        auto found = _streams.find(id);
+        if (found == _streams.end() || found->second.req != req) {
+            return; // Reset meanwhile
+        }
+
+        auto& s = found->second;
+        s.res = res;
+        if (res->is_postponed()) {
+            // The response is kept by the stream, not by its own callback
+            res->on_done([me = this->shared_from_this(), id, res = std::weak_ptr<response>(res)] {
+                asio::post(me->_executor, [me, id, res] { me->on_postponed_done(id, res.lock()); });
+            });
+            return;
+        }
+
+        s.ready = true;
+        start_response(id, s);
+        if (!_processing) {
+            do_send();
+            do_write();
+        }
+    }
+
+    void on_postponed_done(std::uint32_t id, const std::shared_ptr<response>& res)
+    {
+        auto found = _streams.find(id);
+        if (!res || found == _streams.end() || found->second.res != res) {
+            return;
+        }
+
+        found->second.ready = true;
+        start_response(id, found->second);
+        do_send();
+        do_write();
+    }
+
+    // The response header block, the body is sent by do_send
+    void start_response(std::uint32_t id, stream_state& s)
+    {
+        const beast::http::fields* fields = nullptr;
+        unsigned status = 0;
+
+        if (s.file) {
+            fields = &s.file->base();
+            status = s.file->result_int();
+            s.remain = s.file->body().size;
+            s.offset = s.file->body().offset;
+        } else {
+            if (auto* compressor = _router.compressor()) {
+                compressor->compress(*s.req, *s.res);
+            }
+            s.res->prepare_payload();
+            fields = &s.res->base();
+            status = s.res->result_int();
+            s.remain = s.res->body().size();
+            s.offset = 0;
+        }
+
+        if (s.req->method() == beast::http::verb::head || status == 204 || status == 304) {
+            s.remain = 0;
+        }
+
+        std::string block;
+        hpack::encode(block, ":status", std::to_string(status));
+        for (const auto& field : *fields) {
+            auto name = field.name();
+            if (name == beast::http::field::connection || name == beast::http::field::keep_alive
+                    || name == beast::http::field::transfer_encoding || name == beast::http::field::upgrade
+                    || name == beast::http::field::proxy_connection) {
+                continue;
+            }
+            hpack::encode(block,
+                    std::string_view{field.name_string().data(), field.name_string().size()},
+                    std::string_view{field.value().data(), field.value().size()});
+        }
+
+        // Split in CONTINUATION frames above the frame size of the client
+        std::string frame;
+        std::string_view rest = block;
+        bool first = true;
+        do {
+            auto size = std::min<std::size_t>(rest.size(), _peer_max_frame_size);
+            std::uint8_t flags = (size == rest.size() ? http2::flags::end_headers : 0);
+            if (first && s.remain == 0) {
+                flags |= http2::flags::end_stream;
+            }
+            http2::append_frame_header(frame,
+                    size, (first ? http2::frame_type::headers : http2::frame_type::continuation), flags, id);
+            frame.append(rest.substr(0, size));
+            rest.remove_prefix(size);
+            first = false;
+        } while (!rest.empty());
+
+        _out.push_back({std::move(frame)});
+        s.headers_sent = true;
+
+        if (s.remain == 0) {
+            close_stream(id);
+        }
+    }
+
+    // Queue the DATA frames allowed by the flow control, the streams in turn
+    void do_send()
+    {
+        if (_closed) {
+            return;
+        }
+
+        while (_send_window > 0 && _queued < WRITE_HIGH_WATER) {
+            auto it = next_sendable();
+            if (it == _streams.end()) {
+                break;
+            }
+            _last_sent_id = it->first;
+            send_data(it->first, it->second);
+        }
+    }
+
+    // The next stream with a body to send after the last one served
+    typename std::map<std::uint32_t, stream_state>::iterator next_sendable()
+    {
+        auto sendable = [](const stream_state& s) {
+            return s.headers_sent && s.remain > 0 && s.send_window > 0;
+        };
+
+        for (auto it = _streams.upper_bound(_last_sent_id); it != _streams.end(); ++it) {
+            if (sendable(it->second)) {
+                return it;
+            }
+        }
+        for (auto it = _streams.begin(); it != _streams.end() && it->first <= _last_sent_id; ++it) {
+            if (sendable(it->second)) {
+                return it;
+            }
+        }
+        return _streams.end();
+    }
+
+    void send_data(std::uint32_t id, stream_state& s)
+    {
+        auto size = static_cast<std::size_t>(std::min<std::uint64_t>({
+                s.remain, _peer_max_frame_size,
+                static_cast<std::uint64_t>(_send_window), static_cast<std::uint64_t>(s.send_window)}));
+        const bool last = (size == s.remain);
+
+        outgoing frame;
+        http2::append_frame_header(frame.bytes, size, http2::frame_type::data,
+                (last ? http2::flags::end_stream : 0), id);
+
+        if (s.file) {
+            // Read in the frame itself, the file position is not shared
+            boost::system::error_code ec;
+            frame.bytes.resize(http2::frame_header_size + size);
+            auto read = s.file->body().file->read(s.offset, frame.bytes.data() + http2::frame_header_size, size, ec);
+            if (ec || read != size) {
+                // The file has been truncated since opened, the response cannot be completed
+                return stream_error(id, http2::error_code::internal_error);
+            }
+        } else {
+            frame.payload = asio::buffer(s.res->body().data() + s.offset, size);
+            frame.keep = s.res;
+        }
+
+        s.offset += size;
+        s.remain -= size;
+        s.send_window -= size;
+        _send_window -= size;
+        _queued += size;
+        _out.push_back(std::move(frame));
+
+        if (last) {
+            close_stream(id);
+        }
+    }
+
+    // The response is complete, a stream still receiving its body is reset
+    void close_stream(std::uint32_t id)
+    {
+        auto found = _streams.find(id);
+        if (found == _streams.end()) {
+            return;
+        }
+
+        if (!found->second.remote_closed) {
+            send_rst_stream(id, http2::error_code::no_error);
+        }
+        release(found->second);
+        _streams.erase(found);
+        update_timer();
+    }
+
+    void on_rst_stream(std::uint32_t id, std::size_t length)
+    {
+        if (id == 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (length != 4) {
+            return connection_error(http2::error_code::frame_size_error);
+        }
+        if (id > _last_stream_id) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+
+        if (auto found = _streams.find(id); found != _streams.end()) {
+            release(found->second);
+            _streams.erase(found);
+        }
+        update_timer();
+    }
+
+    void on_settings(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (id != 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (flags & http2::flags::ack) {
+            if (length != 0) {
+                return connection_error(http2::error_code::frame_size_error);
+            }
+            return;
+        }
+        if (length % 6 != 0) {
+            return connection_error(http2::error_code::frame_size_error);
+        }
+
+        if (!apply_settings(payload, length)) {
+            return;
+        }
+        _settings_received = true;
+
+        std::string frame;
+        http2::append_frame_header(frame, 0, http2::frame_type::settings, http2::flags::ack, 0);
+        _out.push_back({std::move(frame)});
+    }
+
+    bool apply_settings(const std::uint8_t* payload, std::size_t length)
+    {
+        if (length % 6 != 0) {
+            connection_error(http2::error_code::frame_size_error);
+            return false;
+        }
+
+        for (std::size_t i = 0; i < length; i += 6) {
+            auto id = static_cast<http2::setting>((payload[i] << 8) | payload[i + 1]);
+            auto value = http2::read_uint32(payload + i + 2);
+
+            switch(id) {
+                case http2::setting::enable_push:
+                    if (value > 1) {
+                        connection_error(http2::error_code::protocol_error);
+                        return false;
+                    }
+                    break;
+                case http2::setting::initial_window_size: {
+                    if (value > http2::max_window_size) {
+                        connection_error(http2::error_code::flow_control_error);
+                        return false;
+                    }
+                    // Applies to the open streams too
+                    auto delta = static_cast<std::int64_t>(value) - _peer_initial_window;
+                    for (auto& [sid, s] : _streams) {
+                        s.send_window += delta;
+                        if (s.send_window > http2::max_window_size) {
+                            connection_error(http2::error_code::flow_control_error);
+                            return false;
+                        }
+                    }
+                    _peer_initial_window = value;
+                    break;
+                }
+                case http2::setting::max_frame_size:
+                    if (value < http2::default_max_frame_size || value > 0xffffff) {
+                        connection_error(http2::error_code::protocol_error);
+                        return false;
+                    }
+                    _peer_max_frame_size = value;
+                    break;
+                default:
+                    break; // The header table is not used by the encoder
+            }
+        }
+        return true;
+    }
+
+    void on_ping(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (id != 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+        if (length != 8) {
+            return connection_error(http2::error_code::frame_size_error);
+        }
+        if (flags & http2::flags::ack) {
+            return;
+        }
+
+        std::string frame;
+        http2::append_frame_header(frame, 8, http2::frame_type::ping, http2::flags::ack, 0);
+        frame.append(reinterpret_cast<const char*>(payload), 8);
+        _out.push_back({std::move(frame)});
+    }
+
+    void on_goaway(std::uint32_t id)
+    {
+        if (id != 0) {
+            return connection_error(http2::error_code::protocol_error);
+        }
+
+        // No new stream from the client, the current ones are completed
+        if (!_goaway_sent) {
+            send_goaway(http2::error_code::no_error);
+        }
+    }
+
+    void on_window_update(std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (length != 4) {
+            return connection_error(http2::error_code::frame_size_error);
+        }
+
+        const std::int64_t increment = http2::read_uint32(payload) & 0x7fffffff;
+        if (id == 0) {
+            if (increment == 0) {
+                return connection_error(http2::error_code::protocol_error);
+            }
+            _send_window += increment;
+            if (_send_window > http2::max_window_size) {
+                return connection_error(http2::error_code::flow_control_error);
+            }
+            return;
+        }
+
+        auto found = _streams.find(id);
+        if (found == _streams.end()) {
+            return; // Closed meanwhile
+        }
+        if (increment == 0) {
+            return stream_error(id, http2::error_code::protocol_error);
+        }
+        found->second.send_window += increment;
+        if (found->second.send_window > http2::max_window_size) {
+            return stream_error(id, http2::error_code::flow_control_error);
+        }
+    }
+
+    void send_window_update(std::uint32_t id, std::uint32_t increment)
+    {
+        std::string frame;
+        http2::append_frame_header(frame, 4, http2::frame_type::window_update, 0, id);
+        http2::append_uint32(frame, increment);
+        _out.push_back({std::move(frame)});
+    }
+
+    void send_rst_stream(std::uint32_t id, http2::error_code code)
+    {
+        std::string frame;
+        http2::append_frame_header(frame, 4, http2::frame_type::rst_stream, 0, id);
+        http2::append_uint32(frame, static_cast<std::uint32_t>(code));
+        _out.push_back({std::move(frame)});
+    }
+
+    void send_goaway(http2::error_code code)
+    {
+        _goaway_sent = true;
+
+        std::string frame;
+        http2::append_frame_header(frame, 8, http2::frame_type::goaway, 0, 0);
+        http2::append_uint32(frame, _last_stream_id);
+        http2::append_uint32(frame, static_cast<std::uint32_t>(code));
+        _out.push_back({std::move(frame)});
+    }
+
+    void stream_error(std::uint32_t id, http2::error_code code)
+    {
+        send_rst_stream(id, code);
+        if (auto found = _streams.find(id); found != _streams.end()) {
+            release(found->second);
+            _streams.erase(found);
+        }
+        update_timer();
+    }
+
+    // Back to the pools of the thread, a response still sent is given back
+    // by its last frame written
+    static void release(stream_state& s)
+    {
+        request_pool::release(std::move(s.req));
+        response_pool::release(std::move(s.res));
+    }
+
+    // The connection is closed once the GOAWAY is sent
+    void connection_error(http2::error_code code)
+    {
+        send_goaway(code);
+        _read_closed = true;
+        _streams.clear();
+    }
+
+    void do_write()
+    {
+        if (_writing || _closed) {
+            return;
+        }
+
+        if (_out.empty()) {
+            // Closing once the last stream is answered
+            if (_read_closed || (_goaway_sent && _streams.empty())) {
+                do_close();
+            }
+            return;
+        }
+
+        _writing = true;
+        std::swap(_out, _in_flight);
+        _write_buffers.clear();
+        _write_data.clear();
+        for (const auto& frame : _in_flight) {
+            if constexpr(std::is_same_v<Stream, asio::ip::tcp::socket>) {
+                _write_buffers.push_back(asio::buffer(frame.bytes));
+                if (frame.payload.size()) {
+                    _write_buffers.push_back(frame.payload);
+                }
+            } else {
+                // A TLS record for each buffer otherwise, the frames are copied in one
+                _write_data.append(frame.bytes);
+                _write_data.append(static_cast<const char*>(frame.payload.data()), frame.payload.size());
+            }
+        }
+        if (!_write_data.empty()) {
+            _write_buffers.push_back(asio::buffer(_write_data));
+        }
+        _queued = 0;
+        update_timer();
+
+        asio::async_write(_stream, beast::buffers_range_ref(_write_buffers),
+            asio::bind_executor(
+                _executor,
+                [me = this->shared_from_this()](auto ec, auto /* bytes_transferred */) {
+                    me->on_write(ec);
+                }));
+    }
+
+    void on_write(boost::system::error_code ec)
+    {
+        _writing = false;
+        for (auto& frame : _in_flight) {
+            response_pool::release(std::move(frame.keep));
+        }
+        _in_flight.clear();
+
+        if (ec) {
+            _read_closed = true;
+            _streams.clear();
+            if (ec != asio::error::operation_aborted) {
+                fail(ec, "write");
+            }
+            return do_close();
+        }
+
+        update_timer();
+        do_send();
+        do_write();
+    }
+
+    static std::chrono::steady_clock::time_point deadline(server_settings::duration timeout)
+    {
+        return (timeout.count() ? std::chrono::steady_clock::now() + timeout
+                                : std::chrono::steady_clock::time_point::max());
+    }
+
+    // Write timeout while writing, idle timeout without any stream, the
+    // header timeout of an incomplete header block and the body timeout of
+    // the streams still receiving, the earliest one
+    void update_timer()
+    {
+        auto timeout = server_settings::duration::zero();
+        if (_writing) {
+            timeout = _settings.write_timeout;
+        } else if (_streams.empty()) {
+            timeout = _settings.idle_timeout;
+        }
+
+        _base_deadline = deadline(timeout);
+        _deadline = next_deadline();
+        if (_waiting && _timer.expiry() <= _deadline) {
+            return; // The wait in flight is renewed on expiry
+        }
+        _timer.expires_at(_deadline);
+        do_wait();
+    }
+
+    // A body deadline is moved forward by each chunk, without any timer update
+    std::chrono::steady_clock::time_point next_deadline() const
+    {
+        auto next = std::min(_base_deadline, _header_deadline);
+        for (const auto& [id, s] : _streams) {
+            if (!s.dispatched) {
+                next = std::min(next, s.body_deadline);
+            }
+        }
+        return next;
+    }
+
+    void do_wait()
+    {
+        _waiting = true;
+        _timer.async_wait([weak = this->weak_from_this()](auto ec) {
+            auto me = weak.lock();
+            if (!me || ec) {
+                return;
+            }
+
+            me->_waiting = false;
+            me->_deadline = me->next_deadline();
+            if (me->_deadline == std::chrono::steady_clock::time_point::max() || me->_closed) {
+                return;
+            }
+            if (me->_deadline > std::chrono::steady_clock::now()) {
+                me->_timer.expires_at(me->_deadline);
+                return me->do_wait();
+            }
+
+            me->on_timeout();
+        });
+    }
+
+    void on_timeout()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (_header_deadline <= now) {
+            // Header block never ended, the decoding context is lost with it
+            _header_deadline = std::chrono::steady_clock::time_point::max();
+            connection_error(http2::error_code::cancel);
+            return do_write();
+        }
+
+        std::vector<std::uint32_t> stalled;
+        for (const auto& [id, s] : _streams) {
+            if (!s.dispatched && s.body_deadline <= now) {
+                stalled.push_back(id);
+            }
+        }
+        if (!stalled.empty()) {
+            // Body not received in time, only these streams are reset
+            for (auto id : stalled) {
+                stream_error(id, http2::error_code::cancel);
+            }
+            return do_write();
+        }
+
+        if (_base_deadline > now) {
+            return update_timer();
+        }
+        if (!_writing && _streams.empty()) {
+            // Idle connection, closed gracefully
+            _read_closed = true;
+            send_goaway(http2::error_code::no_error);
+            return do_write();
+        }
+
+        // Slow or stalled client, the pending operations are aborted
+        fail(beast::error::timeout, "write");
+        _closed = true;
+        boost::system::error_code ec;
+        _stream.lowest_layer().close(ec);
+    }
+
+    void do_close()
+    {
+        if (_closed) {
+            return;
+        }
+        _closed = true;
+        _timer.cancel();
+
+        if constexpr(!std::is_same_v<Stream, asio::ip::tcp::socket>) {
+            // Perform the SSL shutdown
+            _stream.async_shutdown(
+                asio::bind_executor(
+                    _executor,
+                    [me = this->shared_from_this()](auto /* ec */) {
+                        boost::system::error_code ec;
+                        me->_stream.lowest_layer().close(ec);
+                    }));
+        } else {
+            boost::system::error_code ec;
+            _stream.shutdown(asio::ip::tcp::socket::shutdown_send, ec);
+            _stream.close(ec);
+        }
+    }
+
+    // Call the route user handler, on the session executor or on the compute pool
+    static std::shared_ptr<response>
+    execute(const beauty::route& route, const beauty::request& req)
+    {
+        try {
+            auto res = make_response(beast::http::status::ok, req.version());
+            res->set(beast::http::field::server, BEAUTY_PROJECT_VERSION);
+
+            route.execute(req, *res); // Call the route user handler
+
+            return res;
+        }
+        catch(const beauty::exception& ex) {
+            return ex.create_response(req);
+        }
+        catch(const std::exception& ex) {
+            return helper::server_error(req, ex.what());
+        }
+    }
+
+#if BEAUTY_ENABLE_COROUTINES
+    // Call the route user coroutine, the execution policy does not apply
+    void
+    execute_awaitable(std::uint32_t id, const std::shared_ptr<beauty::request>& req, const beauty::route* route)
+    {
+        auto res = make_response(beast::http::status::ok, req->version());
+        res->set(beast::http::field::server, BEAUTY_PROJECT_VERSION);
+
+        asio::co_spawn(_executor,
+                route->execute_awaitable(*req, *res),
+                [me = this->shared_from_this(), id, req, res](std::exception_ptr ex) {
+                    if (!ex) {
+                        me->on_executed(id, req, res);
+                        return;
+                    }
+
+                    try {
+                        std::rethrow_exception(ex);
+                    }
+                    catch(const beauty::exception& ex) {
+                        me->on_executed(id, req, ex.create_response(*req));
+                    }
+                    catch(const std::exception& ex) {
+                        me->on_executed(id, req, helper::server_error(*req, ex.what()));
+                    }
+                });
+    }
+#endif
+
+private:
+    beauty::application&    _app;
+    Executor                _executor;
+    Stream&                 _stream;
+    std::shared_ptr<void>   _owner; // The HTTP/1 session owning the socket
+    const beauty::router&   _router;
+    const beauty::server_settings _settings;
+    beauty::endpoint        _remote;
+
+    beast::flat_buffer      _buffer;
+    std::string_view        _preface;   // Client preface bytes still expected
+    hpack::decoder          _decoder{4096};
+    std::vector<hpack::field> _fields;
+    std::string             _header_block;
+    std::uint32_t           _continuation_id = 0;
+    std::uint8_t            _continuation_flags = 0;
+
+    std::map<std::uint32_t, stream_state> _streams;
+    std::uint32_t           _last_stream_id = 0;
+    std::uint32_t           _last_sent_id = 0;
+    std::size_t             _request_count = 0;
+
+    // Flow control
+    std::int64_t            _send_window = http2::default_window_size;
+    std::int64_t            _recv_window = http2::default_window_size;
+    std::int64_t            _peer_initial_window = http2::default_window_size;
+    std::uint32_t           _peer_max_frame_size = http2::default_max_frame_size;
+
+    // Frames queued, and the ones being written
+    std::vector<outgoing>   _out;
+    std::vector<outgoing>   _in_flight;
+    std::vector<asio::const_buffer> _write_buffers;
+    std::string             _write_data;
+    std::size_t             _queued = 0;
+
+    bool _settings_received = false;
+    bool _goaway_sent = false;
+    bool _processing = false;
+    bool _read_closed = false;
+    bool _writing = false;
+    bool _closed = false;
+
+    // Write, idle, header and body timeouts
+    timer_type              _timer;
+    std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max();
+    std::chrono::steady_clock::time_point _base_deadline = std::chrono::steady_clock::time_point::max();   // Write or idle
+    std::chrono::steady_clock::time_point _header_deadline = std::chrono::steady_clock::time_point::max();
+    bool                    _waiting = false;
+};
+
+}
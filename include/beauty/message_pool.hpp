@@ -0,0 +1,85 @@
+#pragma once
+
+#include <beauty/request.hpp>
+#include <beauty/response.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Per-thread free list of requests or responses, reused across the
+// keep-alive requests instead of a new allocation for each of them
+// --------------------------------------------------------------------------
+template<typename Message>
+class message_pool
+{
+public:
+    // Messages kept by each thread
+    static constexpr std::size_t capacity = 64;
+    // Body capacity kept by a recycled message, a larger body is released
+    static constexpr std::size_t body_capacity = 64 * 1024;
+
+    // A default message, from the pool of the calling thread if any
+    static std::shared_ptr<Message> acquire()
+    {
+        auto& messages = free_list();
+        if (messages.empty()) {
+            return std::make_shared<Message>();
+        }
+
+        auto message = std::move(messages.back());
+        messages.pop_back();
+        return message;
+    }
+
+    // Give back a message no longer used, ignored if still shared elsewhere
+    static void release(std::shared_ptr<Message>&& message)
+    {
+        auto m = std::move(message);
+        auto& messages = free_list();
+        if (!m || m.use_count() != 1 || messages.size() == capacity) {
+            return;
+        }
+
+        m->reset();
+        if (m->body().capacity() > body_capacity) {
+            std::string().swap(m->body());
+        }
+        messages.push_back(std::move(m));
+    }
+
+    // Messages available on the calling thread
+    static std::size_t size() { return free_list().size(); }
+
+private:
+    static std::vector<std::shared_ptr<Message>>& free_list()
+    {
+        thread_local std::vector<std::shared_ptr<Message>> messages = [] {
+            std::vector<std::shared_ptr<Message>> v;
+            v.reserve(capacity);
+            return v;
+        }();
+        return messages;
+    }
+};
+
+using request_pool = message_pool<beauty::request>;
+using response_pool = message_pool<beauty::response>;
+
+// --------------------------------------------------------------------------
+// A response from the pool of the calling thread
+// --------------------------------------------------------------------------
+inline std::shared_ptr<response>
+make_response(beast::http::status status, unsigned version)
+{
+    auto res = response_pool::acquire();
+    res->result(status);
+    res->version(version);
+    return res;
+}
+
+}
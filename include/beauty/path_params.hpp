@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Placeholders matched on the request target path (like /users/:id), stored
+// as offsets in the target to avoid any allocation during the routing
+// --------------------------------------------------------------------------
+class path_params
+{
+public:
+    static constexpr std::size_t capacity = 8;
+
+    struct param {
+        std::string_view name;  // Route segment without the ':'
+        std::size_t offset{0};  // Value position in the request target
+        std::size_t size{0};
+    };
+
+    // Returns false if the capacity is reached
+    bool push_back(std::string_view name, std::size_t offset, std::size_t size) noexcept {
+        if (_size == capacity) {
+            return false;
+        }
+        _params[_size++] = param{name, offset, size};
+        return true;
+    }
+
+    void clear() noexcept { _size = 0; }
+
+    const param* find(std::string_view name) const noexcept {
+        for (const auto& p : *this) {
+            if (p.name == name) return &p;
+        }
+        return nullptr;
+    }
+
+    const param* begin() const noexcept { return _params.data(); }
+    const param* end() const noexcept { return _params.data() + _size; }
+
+    std::size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+
+private:
+    std::array<param, capacity> _params{};
+    std::size_t                 _size{0};
+};
+
+}
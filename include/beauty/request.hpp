@@ -1,11 +1,15 @@
 #pragma once
 
 #include <beauty/attributes.hpp>
+#include <beauty/path_params.hpp>
 #include <beauty/utils.hpp>
 
 #include <boost/beast/http.hpp>
 #include "endpoint.hpp"
 
+#include <atomic>
+#include <mutex>
+
 namespace beast = boost::beast;
 
 namespace beauty
@@ -17,16 +21,99 @@ public:
     using beast::http::request<beast::http::string_body>::request;
     using beast::http::request<beast::http::string_body>::operator=;
 
-    attributes& get_attributes() { return _attributes; }
-    const attributes& get_attributes() const { return _attributes; }
-    const attribute& a(const std::string& key) const { return _attributes[key]; }
+    // Query attributes and path placeholders, the placeholders are copied
+    // there by the first call only, thread safe (a() and path_param() do
+    // not need them)
+    attributes& get_attributes() { add_path_params(); return _attributes; }
+    const attributes& get_attributes() const { add_path_params(); return _attributes; }
+
+    // Modified placeholders are copied again in the attributes
+    path_params& get_path_params() { _merged.done = false; return _path_params; }
+    const path_params& get_path_params() const { return _path_params; }
+
+    // Raw value of a path placeholder, a view on the target (still escaped)
+    std::string_view path_param(std::string_view name) const noexcept {
+        const auto* found = _path_params.find(name);
+        if (!found || found->offset + found->size > target().size()) {
+            return {};
+        }
+        return {target().data() + found->offset, found->size};
+    }
+
+    // Query attribute or path placeholder, the placeholder is unescaped only if needed
+    attribute a(const std::string& key) const {
+        {
+            std::unique_lock lock{_merged.mtx, std::defer_lock};
+            if (!_merged.done.load(std::memory_order_acquire)) {
+                lock.lock(); // Not read while the placeholders are copied
+            }
+            if (auto found = _attributes.find(key); found != _attributes.end()) {
+                return found->second;
+            }
+        }
+        if (_path_params.find(key)) {
+            auto value = path_param(key);
+            if (value.find_first_of("%+") != std::string_view::npos) {
+                return attribute(unescape(value));
+            }
+            return attribute(std::string(value));
+        }
+        return {};
+    }
 
     const beauty::endpoint& remote() const { return _remote_ep; }
     void remote(beauty::endpoint ep) { _remote_ep = std::move(ep); }
 
+    // Temporary file holding the body spooled by a streaming route, empty if none
+    const std::string& body_file() const { return _body_file; }
+    void body_file(std::string path) { _body_file = std::move(path); }
+
+    // Back to a default request, the body capacity is kept for the next use
+    void reset() {
+        base() = {};
+        body().clear();
+        _attributes.clear();
+        _path_params.clear();
+        _merged.done = false;
+        _remote_ep = {};
+        _body_file.clear();
+    }
+
+private:
+    void add_path_params() const {
+        if (_merged.done.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        std::lock_guard guard{_merged.mtx};
+        if (_merged.done.load(std::memory_order_relaxed)) {
+            return; // By another thread meanwhile
+        }
+        for (const auto& param : _path_params) {
+            std::string name(param.name);
+            if (_attributes.find(name) == _attributes.end()) {
+                _attributes.insert(std::move(name), std::string(path_param(param.name)));
+            }
+        }
+        _merged.done.store(true, std::memory_order_release);
+    }
+
+    // Placeholders copied in the attributes, copied with them
+    struct merge_state {
+        merge_state() = default;
+        merge_state(const merge_state& other) : done(other.done.load()) {}
+        merge_state& operator=(const merge_state& other) { done = other.done.load(); return *this; }
+
+        std::atomic<bool>   done{false};
+        std::mutex          mtx;
+    };
+
 private:
-    beauty::attributes  _attributes;
+    mutable beauty::attributes  _attributes;
+    mutable merge_state         _merged;
+    beauty::path_params _path_params;
     beauty::endpoint    _remote_ep;
+    std::string         _body_file;
 };
 
 }
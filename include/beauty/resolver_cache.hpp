@@ -0,0 +1,117 @@
+#pragma once
+
+#include <beauty/export.hpp>
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace asio = boost::asio;
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+struct resolver_cache_settings {
+    using duration = std::chrono::steady_clock::duration;
+
+    // How long the addresses of a host are kept, 0 disables the cache
+    duration ttl = std::chrono::seconds(60);
+    // How long a failed lookup is kept, the next connections fail at once
+    duration negative_ttl = std::chrono::seconds(5);
+
+    // An expired entry is still used while a new lookup is made in the
+    // background, the connections do not wait for the resolver
+    bool background_refresh = false;
+
+    // Hosts kept, the least recently used is removed above
+    std::size_t max_entries = 1024;
+};
+
+// --------------------------------------------------------------------------
+// Host name lookups of the clients, shared by the whole process. The
+// concurrent lookups of a host are made once, and the addresses are
+// given in turn (round-robin) to spread the connections. The lookups run
+// on the threads of the cache, whatever happens to the event loop of the
+// client asking first, a slow host does not delay the others.
+// Instance() is the one used by the clients.
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT resolver_cache
+{
+public:
+    using endpoints = std::vector<asio::ip::tcp::endpoint>;
+    using resolve_cb = std::function<void(boost::system::error_code, endpoints)>;
+
+    static resolver_cache& Instance();
+
+    explicit resolver_cache(resolver_cache_settings settings = {});
+    ~resolver_cache();
+
+    resolver_cache(const resolver_cache&) = delete;
+    resolver_cache& operator=(const resolver_cache&) = delete;
+
+    void settings(resolver_cache_settings settings);
+    resolver_cache_settings settings() const;
+
+    // The callback is always called on the executor, never from this call.
+    // The executor has some work until then, its event loop does not end.
+    void async_resolve(const asio::any_io_executor& executor,
+            const std::string& host, const std::string& port, resolve_cb cb);
+
+    // The lookups waited for on the executors of a context are given up,
+    // their callbacks destroyed without being called: to be done before
+    // the context is destroyed, if it may still wait for a lookup.
+    void cancel(asio::execution_context& context);
+
+    void clear();
+
+    std::size_t size() const;
+    std::size_t hits() const;
+    std::size_t lookups() const; // Made with the resolver
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct waiter {
+        asio::any_io_executor   executor;   // With the work tracked
+        resolve_cb              cb;
+    };
+
+    struct entry {
+        boost::system::error_code ec;
+        endpoints               addresses;
+        clock::time_point       expiry;
+        clock::time_point       last_used;
+        std::size_t             next = 0;       // Round-robin
+        bool                    resolving = false;
+        std::vector<waiter>     waiters;
+    };
+
+    void lookup(const std::string& key, const std::string& host, const std::string& port);
+    void on_lookup(const std::string& key, boost::system::error_code ec,
+            const asio::ip::tcp::resolver::results_type& results);
+
+    // Under the lock, the addresses starting from the next one
+    endpoints rotate(entry& e);
+    void evict();
+
+private:
+    mutable std::mutex      _mtx;
+    resolver_cache_settings _settings;
+    std::unordered_map<std::string, entry> _entries;
+    std::size_t             _hits = 0;
+    std::size_t             _lookups = 0;
+
+    // Blocking lookups, a host at a time on each thread. Asio resolves the
+    // asynchronous ones on a single thread. Started with the first lookup.
+    static constexpr std::size_t LOOKUP_THREADS = 4;
+    std::unique_ptr<asio::thread_pool> _pool;
+};
+
+}
@@ -35,6 +35,14 @@ public:
         _cb = std::move(cb);
     }
 
+    // Back to a default response, the body capacity is kept for the next use
+    void reset() {
+        base() = {};
+        body().clear();
+        _is_postponed = false;
+        _cb = []{};
+    }
+
     // Result alias and a common helper for no error
     http::status status() const { return result(); }
     bool is_status_ok() const { return status() == http::status::ok; }
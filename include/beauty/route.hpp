@@ -9,8 +9,15 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <type_traits>
+
+#if BEAUTY_ENABLE_COROUTINES
+#include <boost/asio/awaitable.hpp>
+#endif
 
 namespace beauty
 {
@@ -19,6 +26,47 @@ namespace beauty
 // --------------------------------------------------------------------------
 using route_cb = std::function<void(const beauty::request& req, beauty::response& res)>;
 
+#if BEAUTY_ENABLE_COROUTINES
+// --------------------------------------------------------------------------
+// Http coroutine callback, run on the connection executor, the response
+// is sent when the coroutine completes
+// --------------------------------------------------------------------------
+using route_awaitable_cb = std::function<boost::asio::awaitable<void>(const beauty::request& req, beauty::response& res)>;
+
+template<typename Cb, typename = void>
+struct is_route_awaitable : std::false_type {};
+
+template<typename Cb>
+struct is_route_awaitable<Cb, std::enable_if_t<std::is_same_v<
+        std::invoke_result_t<Cb&, const beauty::request&, beauty::response&>,
+        boost::asio::awaitable<void>>>> : std::true_type {};
+
+template<typename Cb>
+inline constexpr bool is_route_awaitable_v = is_route_awaitable<std::decay_t<Cb>>::value;
+#endif
+
+// --------------------------------------------------------------------------
+// Streaming body callbacks
+// --------------------------------------------------------------------------
+using body_chunk_cb = std::function<void(const beauty::request& req, const char* data, std::size_t size)>;
+
+struct stream_handler {
+    // Called for each body chunk received, if not set the body is spooled in
+    // the request body, or in a temporary file above the spool threshold
+    body_chunk_cb   on_chunk;
+    // Called when the whole body is received, to fill the response
+    route_cb        on_complete = [](const auto& req, auto& res) {};
+
+    std::uint64_t   body_limit = 1024 * 1024 * 1024; // 1Go
+    std::size_t     spool_threshold = 1024 * 1024;   // 1Mo
+};
+
+// --------------------------------------------------------------------------
+// Where the route handler is called, on the I/O thread of the connection,
+// or on the application compute pool for the blocking or heavy handlers
+// --------------------------------------------------------------------------
+enum class execution_policy { inline_, offload };
+
 // --------------------------------------------------------------------------
 class BEAUTY_EXPORT route
 {
@@ -26,13 +74,33 @@ public:
     explicit route(const std::string& path, route_cb&& cb = [](const auto& req, auto& res){});
     route(const std::string& path, const beauty::route_info& route_info, route_cb&& cb = [](const auto& req, auto& res){});
     route(const std::string& path, ws_handler&& handler);
+    route(const std::string& path, const beauty::route_info& route_info, beauty::stream_handler&& handler);
+#if BEAUTY_ENABLE_COROUTINES
+    route(const std::string& path, const beauty::route_info& route_info, route_awaitable_cb&& cb);
+#endif
 
     bool match(beauty::request& req, bool is_websocket = false) const noexcept;
 
+    // Update the request attributes from the query and the path placeholders,
+    // the request target must already match the route
+    void extract_attributes(beauty::request& req) const;
+
     void execute(const beauty::request& req, beauty::response& res) const {
         _cb(req, res);
     }
 
+#if BEAUTY_ENABLE_COROUTINES
+    boost::asio::awaitable<void> execute_awaitable(const beauty::request& req, beauty::response& res) const {
+        return _awaitable_cb(req, res);
+    }
+    [[nodiscard]] bool is_coroutine() const noexcept { return static_cast<bool>(_awaitable_cb); }
+#endif
+
+    // Streaming body
+    void chunk(const beauty::request& req, const char* data, std::size_t size) const {
+        _stream_handler.on_chunk(req, data, size);
+    }
+
     // Websocket
     void connect(const ws_context& ctx) const {
         _ws_handler.on_connect(ctx);
@@ -47,6 +115,12 @@ public:
     [[nodiscard]] const std::string& path() const noexcept { return _path; }
     [[nodiscard]] const std::vector<std::string>& segments() const noexcept { return _segments; }
     [[nodiscard]] const beauty::route_info& route_info() const noexcept { return _route_info; }
+    [[nodiscard]] bool is_websocket() const noexcept { return _is_websocket; }
+    [[nodiscard]] bool is_streaming() const noexcept { return _is_streaming; }
+    [[nodiscard]] const beauty::stream_handler& stream_handler() const noexcept { return _stream_handler; }
+
+    [[nodiscard]] execution_policy policy() const noexcept { return _policy; }
+    void policy(execution_policy policy) noexcept { _policy = policy; }
 
 private:
     void extract_route_info();
@@ -57,8 +131,14 @@ private:
     std::vector<std::string> _segments;
 
     route_cb    _cb;
+#if BEAUTY_ENABLE_COROUTINES
+    route_awaitable_cb _awaitable_cb;
+#endif
     bool        _is_websocket{false};
     ws_handler  _ws_handler;
+    bool        _is_streaming{false};
+    beauty::stream_handler _stream_handler;
+    execution_policy _policy{execution_policy::inline_};
     beauty::route_info  _route_info;
 };
 
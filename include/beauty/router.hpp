@@ -1,10 +1,17 @@
 #pragma once
 
+#include <beauty/compression.hpp>
 #include <beauty/route.hpp>
+#include <beauty/static_files.hpp>
 #include <beauty/export.hpp>
 
 #include <boost/beast.hpp>
 
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
 namespace beast = boost::beast;
 
 namespace beauty
@@ -16,6 +23,21 @@ public:
 
     void add_route(beast::http::verb v, route&& r);
 
+    // Find the best route for the request target, using the route priority,
+    // and update the request attributes. Returns nullptr if nothing matches.
+    const route* match(beast::http::verb v, beauty::request& req, bool is_websocket = false) const;
+
+    // Serve the files of root_dir below the target prefix (GET and HEAD only)
+    void add_static(const std::string& prefix, const std::string& root_dir);
+
+    // Static files with the longest prefix matching the target path, nullptr if none.
+    // Only used when no route matches.
+    static_files* match_static(std::string_view path) const noexcept;
+
+    // Compress the responses accepting it, nullptr if not enabled
+    void compression(const compression_settings& settings);
+    response_compressor* compressor() const noexcept { return _compressor.get(); }
+
     routes::const_iterator find(beast::http::verb v) const noexcept {
         return _routes.find(v);
     }
@@ -23,8 +45,27 @@ public:
     routes::const_iterator begin() const noexcept { return _routes.begin(); }
     routes::const_iterator end() const noexcept { return _routes.end(); }
 
+private:
+    // Segment tree compiled from the routes path, one per verb.
+    // Each node holds the indexes (in the sorted routes) ending on it.
+    struct node {
+        std::map<std::string, std::unique_ptr<node>, std::less<>> statics;
+        std::unique_ptr<node>       placeholder;
+        std::vector<std::size_t>    routes;
+    };
+
+    static const route* lookup(const node& n, std::string_view path, std::size_t begin,
+            const std::vector<route>& routes, bool is_websocket) noexcept;
+    static void shift(node& n, std::size_t from);
+
 private:
     routes      _routes;
+    std::unordered_map<beast::http::verb, node> _trees;
+
+    // Longest prefix first
+    std::vector<std::unique_ptr<static_files>> _static_files;
+
+    std::unique_ptr<response_compressor> _compressor;
 };
 
 }
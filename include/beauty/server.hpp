@@ -4,11 +4,13 @@
 #include <beauty/route.hpp>
 #include <beauty/router.hpp>
 #include <beauty/acceptor.hpp>
+#include <beauty/server_settings.hpp>
 #include <beauty/endpoint.hpp>
 #include <beauty/swagger.hpp>
 #include <beauty/export.hpp>
 
 #include <string>
+#include <utility>
 
 namespace beauty
 {
@@ -23,33 +25,86 @@ public:
         server_route(server& s, std::string path) : _server(s), _path(std::move(path))
         {}
 
+        // Execution policy of the handlers added after
+        server_route& policy(execution_policy policy) { _policy = policy; return *this; }
+
         // Http verbs
-        server_route& get(route_cb&& cb) { _server.get(_path, std::move(cb)); return *this; };
+        server_route& get(route_cb&& cb) { return get({}, std::move(cb)); };
         server_route& get(const route_info& route_info, route_cb&& cb)
-        {  _server.get(_path, route_info, std::move(cb)); return *this; }
+        {  return add(beast::http::verb::get, beauty::route(_path, route_info, std::move(cb))); }
 
-        server_route& put(route_cb&& cb) { _server.put(_path, std::move(cb)); return *this; };
+        server_route& put(route_cb&& cb) { return put({}, std::move(cb)); };
         server_route& put(const route_info& route_info, route_cb&& cb)
-        {  _server.put(_path, route_info, std::move(cb)); return *this; }
+        {  return add(beast::http::verb::put, beauty::route(_path, route_info, std::move(cb))); }
+        server_route& put(stream_handler&& handler)
+        {  return put({}, std::move(handler)); }
+        server_route& put(const route_info& route_info, stream_handler&& handler)
+        {  return add(beast::http::verb::put, beauty::route(_path, route_info, std::move(handler))); }
 
-        server_route& post(route_cb&& cb) { _server.post(_path, std::move(cb)); return *this; };
+        server_route& post(route_cb&& cb) { return post({}, std::move(cb)); };
         server_route& post(const route_info& route_info, route_cb&& cb)
-        {  _server.post(_path, route_info, std::move(cb)); return *this; }
+        {  return add(beast::http::verb::post, beauty::route(_path, route_info, std::move(cb))); }
+        server_route& post(stream_handler&& handler)
+        {  return post({}, std::move(handler)); }
+        server_route& post(const route_info& route_info, stream_handler&& handler)
+        {  return add(beast::http::verb::post, beauty::route(_path, route_info, std::move(handler))); }
 
-        server_route& options(route_cb&& cb) { _server.options(_path, std::move(cb)); return *this; };
+        server_route& options(route_cb&& cb) { return options({}, std::move(cb)); };
         server_route& options(const route_info& route_info, route_cb&& cb)
-        {  _server.options(_path, route_info, std::move(cb)); return *this; }
+        {  return add(beast::http::verb::options, beauty::route(_path, route_info, std::move(cb))); }
 
-        server_route& del(route_cb&& cb) { _server.del(_path, std::move(cb)); return *this; };
+        server_route& del(route_cb&& cb) { return del({}, std::move(cb)); };
         server_route& del(const route_info& route_info, route_cb&& cb)
-        {  _server.del(_path, route_info, std::move(cb)); return *this; }
+        {  return add(beast::http::verb::delete_, beauty::route(_path, route_info, std::move(cb))); }
+
+#if BEAUTY_ENABLE_COROUTINES
+        // Http verbs with a coroutine handler
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& get(Cb&& cb) { return get({}, std::forward<Cb>(cb)); }
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& get(const route_info& route_info, Cb&& cb)
+        {  return add(beast::http::verb::get, beauty::route(_path, route_info, route_awaitable_cb(std::forward<Cb>(cb)))); }
+
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& put(Cb&& cb) { return put({}, std::forward<Cb>(cb)); }
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& put(const route_info& route_info, Cb&& cb)
+        {  return add(beast::http::verb::put, beauty::route(_path, route_info, route_awaitable_cb(std::forward<Cb>(cb)))); }
+
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& post(Cb&& cb) { return post({}, std::forward<Cb>(cb)); }
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& post(const route_info& route_info, Cb&& cb)
+        {  return add(beast::http::verb::post, beauty::route(_path, route_info, route_awaitable_cb(std::forward<Cb>(cb)))); }
+
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& options(Cb&& cb) { return options({}, std::forward<Cb>(cb)); }
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& options(const route_info& route_info, Cb&& cb)
+        {  return add(beast::http::verb::options, beauty::route(_path, route_info, route_awaitable_cb(std::forward<Cb>(cb)))); }
+
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& del(Cb&& cb) { return del({}, std::forward<Cb>(cb)); }
+        template<typename Cb, typename = std::enable_if_t<is_route_awaitable_v<Cb>>>
+        server_route& del(const route_info& route_info, Cb&& cb)
+        {  return add(beast::http::verb::delete_, beauty::route(_path, route_info, route_awaitable_cb(std::forward<Cb>(cb)))); }
+#endif
 
         // Websocket
         server_route& ws(ws_handler&& handler) { _server.ws(_path, std::move(handler)); return *this;}
 
+    private:
+        server_route& add(beast::http::verb v, beauty::route&& r)
+        {
+            r.policy(_policy);
+            _server._router.add_route(v, std::move(r));
+            return *this;
+        }
+
     private:
         server& _server;
         std::string _path;
+        execution_policy _policy{execution_policy::inline_};
     };
 
 public:
@@ -70,6 +125,13 @@ public:
 
     server& concurrency(int concurrency) { _concurrency = concurrency; return *this; }
 
+    // An io_context and a listening socket per thread (see application::set_sharded)
+    server& sharded(bool sharded) { _app.set_sharded(sharded); return *this; }
+
+    // Timeouts and limits of the connections, to be set before listen
+    server& settings(const beauty::server_settings& settings) { _settings = settings; return *this; }
+    const beauty::server_settings& settings() const noexcept { return _settings; }
+
     server_route add_route(const std::string& path) { return {*this, path}; }
 
     // Legacy API, should not be used anymore to avoid PATH duplication
@@ -86,6 +148,16 @@ public:
 
     server& ws(const std::string& path, ws_handler&& handler);
 
+    // Streaming body routes
+    server& put(const std::string& path, const route_info& route_info, stream_handler&& handler);
+    server& post(const std::string& path, const route_info& route_info, stream_handler&& handler);
+
+    // Static files, served when no route matches
+    server& add_static(const std::string& prefix, const std::string& root_dir);
+
+    // Compress the responses from the request Accept-Encoding, to be set before listen
+    server& compression(const compression_settings& settings = {});
+
     void listen(int port = 0, const std::string& address = "0.0.0.0");
     void stop();
     void run();
@@ -105,6 +177,7 @@ private:
     beauty::application&    _app;
     int                     _concurrency{1};
     beauty::router          _router;
+    beauty::server_settings _settings;
     std::shared_ptr<beauty::acceptor> _acceptor;
 
     beauty::endpoint        _endpoint;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Connection limits of a server, a zero value disables the limit
+// --------------------------------------------------------------------------
+struct server_settings {
+    using duration = std::chrono::steady_clock::duration;
+
+    // Keep-alive connection waiting for the next request
+    duration idle_timeout   = std::chrono::seconds(60);
+    // From the first byte of a request to the end of its header
+    duration header_timeout = std::chrono::seconds(30);
+    // Whole body read, or each chunk read for a streaming route
+    duration body_timeout   = std::chrono::seconds(60);
+    // Each response write, or each file part sent
+    duration write_timeout  = std::chrono::seconds(60);
+
+    // Requests served on a connection before closing it
+    std::size_t max_requests_per_connection = 0;
+
+    // HTTP/2, negotiated with ALPN over TLS, or h2c with prior knowledge
+    // or an upgrade from HTTP/1.1 on a plain connection
+    bool http2 = true;
+    // Streams opened at the same time by a client on a HTTP/2 connection
+    std::uint32_t http2_max_concurrent_streams = 100;
+};
+
+}
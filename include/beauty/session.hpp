@@ -1,22 +1,38 @@
 #pragma once
 
+#include <beauty/application.hpp>
 #include <beauty/router.hpp>
+#include <beauty/server_settings.hpp>
+#include <beauty/body_spool.hpp>
+#include <beauty/message_pool.hpp>
 #include <beauty/version.hpp>
 #include <beauty/utils.hpp>
 #include <beauty/exception.hpp>
 #include <beauty/websocket_session.hpp>
+#include <beauty/http2_session.hpp>
 
 #include <boost/beast.hpp>
 #include <boost/asio.hpp>
+#include <boost/circular_buffer.hpp>
 
 #if BEAUTY_ENABLE_OPENSSL
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/ssl/stream.hpp>
 #endif
 
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <string>
 #include <memory>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 namespace asio = boost::asio;
 namespace beast = boost::beast;
@@ -25,30 +41,56 @@ namespace beauty {
 
 // --------------------------------------------------------------------------
 // Handles an HTTP/S server connection
+// The executor is a strand when the threads share the io_context, or the
+// io_context executor when the connection stays on one thread. A concrete
+// type, an any_io_executor on a strand allocates for each operation.
 //---------------------------------------------------------------------------
-template<bool SSL>
-class session : public std::enable_shared_from_this<session<SSL>>
+template<bool SSL, typename Executor = asio::strand<asio::io_context::executor_type>>
+class session : public std::enable_shared_from_this<session<SSL, Executor>>
 {
 public:
     using stream_type = std::conditional_t<SSL,
             asio::ssl::stream<asio::ip::tcp::socket&>,
             void*>;
+    using executor_type = Executor;
+    using timer_type = asio::basic_waitable_timer<std::chrono::steady_clock,
+            asio::wait_traits<std::chrono::steady_clock>, Executor>;
+
+    // A timeout, moving the deadline does not restart the timer wait
+    // which would allocate for each request
+    struct watchdog {
+        explicit watchdog(const Executor& executor) : timer(executor) {}
+
+        timer_type timer;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        bool waiting = false;
+    };
 
 public:
     template<bool U = SSL, typename std::enable_if_t<!U, int> = 0>
-    session(asio::io_context& ioc, asio::ip::tcp::socket&& socket, const beauty::router& router) :
+    session(beauty::application& app, Executor executor, asio::ip::tcp::socket&& socket,
+            const beauty::router& router, const beauty::server_settings& settings) :
+          _app(app),
           _socket(std::move(socket)),
-          _strand(asio::make_strand(ioc)),
-          _router(router)
+          _executor(std::move(executor)),
+          _router(router),
+          _settings(settings),
+          _read_timer(_executor),
+          _write_timer(_executor)
     {}
 
 #if BEAUTY_ENABLE_OPENSSL
     template<bool U = SSL, typename std::enable_if_t<U, int> = 0>
-    session(asio::io_context& ioc, asio::ip::tcp::socket&& socket, const beauty::router& router, asio::ssl::context& ctx) :
+    session(beauty::application& app, Executor executor, asio::ip::tcp::socket&& socket,
+            const beauty::router& router, const beauty::server_settings& settings, asio::ssl::context& ctx) :
+          _app(app),
           _socket(std::move(socket)),
           _stream(_socket, ctx),
-          _strand(asio::make_strand(ioc)),
-          _router(router)
+          _executor(std::move(executor)),
+          _router(router),
+          _settings(settings),
+          _read_timer(_executor),
+          _write_timer(_executor)
     {}
 #endif
 
@@ -61,7 +103,7 @@ public:
             _stream.async_handshake(
                 asio::ssl::stream_base::server,
                 asio::bind_executor(
-                    _strand,
+                    _executor,
                     [me = this->shared_from_this()](auto ec) {
                         me->on_ssl_handshake(ec);
                 }));
@@ -77,28 +119,167 @@ public:
             return fail(ec, "failed handshake");
         }
 
+#if BEAUTY_ENABLE_OPENSSL
+        if constexpr(SSL) {
+            // h2 negotiated with ALPN, the client starts with its preface
+            const unsigned char* protocol = nullptr;
+            unsigned int length = 0;
+            SSL_get0_alpn_selected(_stream.native_handle(), &protocol, &length);
+            if (_settings.http2 && std::string_view(reinterpret_cast<const char*>(protocol), length) == "h2") {
+                return upgrade_http2(http2::client_preface);
+            }
+        }
+#endif
+
         do_read();
     }
 
     void do_read()
     {
+        // Only one request is read at a time, up to the pipeline limit in flight
+        if (_reading || _read_closed || _pending.size() >= PIPELINE_LIMIT) {
+            return;
+        }
+        _reading = true;
+
+        if (_buffer.size() == 0) {
+            // Idle until the next request begins, only for a keep-alive
+            // connection without any response in flight
+            _idle = true;
+            if (_pending.empty() && !_writing) {
+                arm(_read_timer, _settings.idle_timeout);
+            } else {
+                disarm(_read_timer);
+            }
+
+            // The TLS layer could hold already decrypted data, only the header read is used
+            if constexpr(!SSL) {
+                _socket.async_wait(asio::ip::tcp::socket::wait_read,
+                    asio::bind_executor(
+                        _executor,
+                        [me = this->shared_from_this()](auto ec) {
+                            if (ec) {
+                                return me->on_read_error(ec);
+                            }
+                            me->do_read_header();
+                        }));
+                return;
+            }
+        }
+
+        do_read_header();
+    }
+
+    void do_read_header()
+    {
+        // With TLS, the idle timeout covers the whole header read from an empty buffer
+        if (!(SSL && _idle)) {
+            _idle = false;
+            arm(_read_timer, _settings.header_timeout);
+        }
+
         //std::cout << "session: do read" << std::endl;
-        // Make a new request_parser before reading
-        _request_parser = std::make_unique<beast::http::request_parser<beast::http::string_body>>();
-        _request_parser->body_limit(1024 * 1024 * 1024); // 1Go..
+        // Make a new parser before reading, only the header is read
+        // first to know if the body must be streamed or not
+        _header_parser.emplace();
+        _header_parser->body_limit(std::numeric_limits<std::uint64_t>::max()); // Checked once the route is known
+
+        if constexpr(SSL) {
+            beast::http::async_read_header(_stream, _buffer, *_header_parser,
+                asio::bind_executor(
+                    _executor,
+                    [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
+                        me->on_read_header(ec, bytes_transferred);
+                    }));
+        } else {
+            beast::http::async_read_header(_socket, _buffer, *_header_parser,
+                asio::bind_executor(
+                    _executor,
+                    [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
+                        me->on_read_header(ec, bytes_transferred);
+                    }));
+        }
+    }
+
+    void on_read_header(boost::system::error_code ec, std::size_t /* bytes_transferred */)
+    {
+        _idle = false;
+
+        // HTTP/2 with prior knowledge, the client preface is left unread by the parser
+        if (ec == beast::http::error::bad_version && _settings.http2 && _first_request) {
+            const auto preface_start = http2::client_preface.substr(0, http2::client_preface.find("\r\n"));
+            auto data = std::string_view(static_cast<const char*>(_buffer.data().data()), _buffer.size());
+            if (data.substr(0, preface_start.size()) == preface_start) {
+                return upgrade_http2(http2::client_preface);
+            }
+        }
+
+        if (ec) {
+            return on_read_error(ec);
+        }
+
+        // The header is moved, the parser only needs its own state to read the body
+        _request.base() = std::move(_header_parser->get().base());
+        _request.body().clear();
+        _request.body_file({});
+        _request.remote(_socket.remote_endpoint());
+
+        // Upgrade to h2c, only without a request body
+        if (!SSL && _settings.http2 && _first_request
+                && beast::iequals(_request[beast::http::field::upgrade], "h2c")
+                && _request.count("HTTP2-Settings")
+                && !_header_parser->chunked() && _header_parser->content_length().value_or(0) == 0) {
+            auto req = request_pool::acquire();
+            *req = std::move(_request);
+            return upgrade_http2(http2::client_preface, std::move(req));
+        }
+
+        _is_websocket = (beast::websocket::is_upgrade(_request));
+
+        // Try to match a route for this request target
+        // Match will update parameters request from the URL
+        _route = nullptr;
+        if (_router.find(_request.method()) != _router.end()) {
+            _route = _router.match(_request.method(), _request, _is_websocket);
+        }
+
+        // Static files are only looked for when no route matches
+        _static_files = nullptr;
+        if (!_route && !_is_websocket
+                && (_request.method() == beast::http::verb::get || _request.method() == beast::http::verb::head)) {
+            auto target = std::string_view{_request.target().data(), _request.target().size()};
+            _static_files = _router.match_static(target.substr(0, target.find('?')));
+        }
+
+        const bool is_streaming = (_route && _route->is_streaming());
+        const std::uint64_t body_limit = (is_streaming ? _route->stream_handler().body_limit : BODY_LIMIT);
+
+        // The content length is only checked by the parser with the header
+        if (_header_parser->content_length().value_or(0) > body_limit) {
+            return on_read_error(beast::http::error::body_limit);
+        }
+
+        if (is_streaming) {
+            return do_read_stream(body_limit);
+        }
+
+        // Read the full body
+        _request_parser.emplace(std::move(*_header_parser));
+        _request_parser->body_limit(body_limit);
+
+        arm(_read_timer, _settings.body_timeout);
 
-        // Read a full request (only if on _stream/_socket)
         if constexpr(SSL) {
             beast::http::async_read(_stream, _buffer, *_request_parser,
                 asio::bind_executor(
-                    _strand,
+                    _executor,
                     [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
                         me->on_read(ec, bytes_transferred);
                     }));
         } else {
             beast::http::async_read(_socket, _buffer, *_request_parser,
                 asio::bind_executor(
-                    _strand,
+                    _executor,
                     [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
                         me->on_read(ec, bytes_transferred);
                     }));
@@ -108,29 +289,367 @@ public:
     void on_read(boost::system::error_code ec, std::size_t /* bytes_transferred */ )
     {
         //std::cout << "session: on read" << std::endl;
+        if (ec) {
+            return on_read_error(ec);
+        }
+
+        _request.body() = std::move(_request_parser->get().body());
+        // Only the trailer fields of a chunked body, if any
+        for (const auto& field : _request_parser->get()) {
+            _request.insert(field.name_string(), field.value());
+        }
+
+        dispatch();
+    }
+
+    void on_read_error(boost::system::error_code ec)
+    {
+        _reading = false;
+        _read_closed = true;
+        disarm(_read_timer);
 
-        // This means they closed the connection
+        // This means they closed the connection, the pending responses are still sent
         if (ec == beast::http::error::end_of_stream) {
-            return do_close();
+            return do_flush();
+        }
+
+        if (ec != asio::error::operation_aborted) {
+            fail(ec, "read");
+        }
+    }
+
+    void do_read_stream(std::uint64_t body_limit)
+    {
+        _chunk_parser.emplace(std::move(*_header_parser));
+        _chunk_parser->body_limit(body_limit);
+
+        if (!_route->stream_handler().on_chunk) {
+            _spool = std::make_shared<body_spool>(_app, _executor, _route->stream_handler().spool_threshold);
+        }
+
+        _chunk.resize(CHUNK_SIZE);
+
+        do_read_chunk();
+    }
+
+    void do_read_chunk()
+    {
+        auto& body = _chunk_parser->get().body();
+        body.data = _chunk.data();
+        body.size = _chunk.size();
+
+        if (_chunk_parser->is_done()) {
+            // No body at all
+            return on_read_chunk({}, 0);
+        }
+
+        arm(_read_timer, _settings.body_timeout);
+
+        if constexpr(SSL) {
+            beast::http::async_read(_stream, _buffer, *_chunk_parser,
+                asio::bind_executor(
+                    _executor,
+                    [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
+                        me->on_read_chunk(ec, bytes_transferred);
+                    }));
+        } else {
+            beast::http::async_read(_socket, _buffer, *_chunk_parser,
+                asio::bind_executor(
+                    _executor,
+                    [me = this->shared_from_this()](auto ec, auto bytes_transferred) {
+                        me->on_read_chunk(ec, bytes_transferred);
+                    }));
+        }
+    }
+
+    void on_read_chunk(boost::system::error_code ec, std::size_t /* bytes_transferred */)
+    {
+        // The chunk buffer is full, not an error
+        if (ec == beast::http::error::need_buffer) {
+            ec = {};
         }
 
         if (ec) {
-            return fail(ec, "read");
+            return on_read_error(ec);
         }
 
-        // Send the response
-        auto response = handle_request();
+        std::shared_ptr<response> res;
+        try {
+            auto size = _chunk.size() - _chunk_parser->get().body().size;
+            if (size) {
+                if (_spool) {
+                    _spool->append(_request, _chunk.data(), size);
+                } else {
+                    _route->chunk(_request, _chunk.data(), size);
+                }
+            }
+        }
+        catch(const beauty::exception& ex) {
+            res = ex.create_response(_request);
+        }
+        catch(const std::exception& ex) {
+            res = helper::server_error(_request, ex.what());
+        }
+
+        if (res) {
+            return dispatch_stream(res);
+        }
 
-        if (response) { // Probably not a WebSocket request
-            if (!response->is_postponed()) {
-                do_write(response);
+        if (_chunk_parser->is_done()) {
+            // Only the trailer fields of a chunked body, if any
+            for (const auto& field : _chunk_parser->get()) {
+                _request.insert(field.name_string(), field.value());
             }
-            else {
-                response->on_done([me = this->shared_from_this(), response] {
-                    me->do_write(response);
-                });
+        }
+
+        // The spool file is written on the compute pool: waited for at the
+        // end, or before the next chunk when the disk is behind the network
+        if (_spool && (_chunk_parser->is_done() || _spool->queued() >= SPOOL_QUEUE_LIMIT)) {
+            disarm(_read_timer);
+            return _spool->async_flush([me = this->shared_from_this()](std::exception_ptr error) {
+                me->on_chunk_done(error);
+            });
+        }
+
+        on_chunk_done(nullptr);
+    }
+
+    void on_chunk_done(std::exception_ptr error)
+    {
+        std::shared_ptr<response> res;
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+
+            if (!_chunk_parser->is_done()) {
+                return do_read_chunk();
+            }
+
+            if (_spool) {
+                _spool->finish(_request);
+            }
+        }
+        catch(const beauty::exception& ex) {
+            res = ex.create_response(_request);
+        }
+        catch(const std::exception& ex) {
+            res = helper::server_error(_request, ex.what());
+        }
+
+        dispatch_stream(res);
+    }
+
+    void dispatch_stream(std::shared_ptr<response> res)
+    {
+        if (res) {
+            // The body is not fully read, the connection cannot be reused
+            res->keep_alive(_chunk_parser->is_done() && res->keep_alive());
+            if (!_chunk_parser->is_done()) {
+                _read_closed = true;
             }
         }
+
+        dispatch(res);
+    }
+
+    // Queue the response of the request just read, in the request order,
+    // and read the next pipelined request meanwhile
+    void dispatch(std::shared_ptr<response> res = nullptr)
+    {
+        _reading = false;
+        _first_request = false;
+        disarm(_read_timer);
+
+        _pending.push_back({});
+        auto& p = _pending.back();
+        p.req = request_pool::acquire();
+        *p.req = std::move(_request);
+        p.spool = std::move(_spool);
+
+        // The last request allowed, answered with a 'Connection: close'
+        if (_settings.max_requests_per_connection
+                && ++_request_count >= _settings.max_requests_per_connection) {
+            p.req->keep_alive(false);
+        }
+
+        if (!p.req->keep_alive()) {
+            _read_closed = true;
+        }
+
+        if (!res && _is_websocket && _route) {
+            // The socket is given to the websocket session once the previous responses are sent
+            p.ws_route = _route;
+            _read_closed = true;
+        }
+        else if (!res && _static_files) {
+            try {
+                p.file = _static_files->serve(*p.req);
+            }
+            catch(const std::exception& ex) {
+                res = helper::server_error(*p.req, ex.what());
+            }
+        }
+
+        if (p.ws_route || p.file) {
+            p.ready = true;
+        }
+#if BEAUTY_ENABLE_COROUTINES
+        else if (!res && _route && _route->is_coroutine()) {
+            // The coroutine runs on the session executor, the response is queued when it completes
+            execute_awaitable(p.req, _route);
+        }
+#endif
+        else if (!res && _route && _route->policy() == execution_policy::offload) {
+            // The handler runs on the compute pool, the response is given back to the session executor
+            _app.offload([me = this->shared_from_this(), req = p.req, route = _route] {
+                auto res = execute(*route, *req);
+                asio::post(me->_executor, [me, req, res] { me->on_executed(req, res); });
+            });
+        }
+        else {
+            on_executed(p.req, (res ? res : handle_request(*p.req)));
+        }
+
+        do_flush();
+        do_read();
+    }
+
+    void on_executed(const std::shared_ptr<beauty::request>& req, const std::shared_ptr<response>& res)
+    {
+        auto found = std::find_if(_pending.begin(), _pending.end(),
+                [&req](const auto& p) { return p.req == req; });
+        if (found == _pending.end()) {
+            return; // Closed meanwhile
+        }
+
+        found->res = res;
+        found->ready = !res->is_postponed();
+
+        if (res->is_postponed()) {
+            // The response is kept by the session, not by its own callback
+            res->on_done([me = this->shared_from_this(), res = std::weak_ptr<response>(res)] {
+                asio::post(me->_executor, [me, res] { me->on_postponed_done(res.lock()); });
+            });
+        }
+
+        do_flush();
+    }
+
+    void on_postponed_done(const std::shared_ptr<response>& res)
+    {
+        if (!res) {
+            return; // Closed meanwhile
+        }
+
+        for (auto& p : _pending) {
+            if (p.res == res) {
+                p.ready = true;
+                break;
+            }
+        }
+        do_flush();
+    }
+
+    // Write the ready responses at the front of the queue, in order
+    void do_flush()
+    {
+        if (_writing || _closed) {
+            return;
+        }
+
+        if (_pending.empty()) {
+            if (_read_closed && !_reading) {
+                do_close();
+            }
+            return;
+        }
+
+        auto& front = _pending.front();
+        if (!front.ready) {
+            return;
+        }
+
+        if (front.ws_route) {
+            // Create a websocket session, and transferring ownership
+            auto p = std::move(front);
+            _pending.pop_front();
+            _closed = true;
+            disarm(_read_timer);
+            disarm(_write_timer);
+            try {
+                std::make_shared<websocket_session>(std::move(_socket), *p.ws_route)->run(*p.req);
+            }
+            catch(const std::exception& ex) {
+                fail({}, ex.what());
+            }
+            return;
+        }
+
+        _writing = true;
+        arm(_write_timer, _settings.write_timeout);
+
+        if (front.file) {
+            _write_count = 1;
+            return do_write_file(front.file);
+        }
+
+        if (front.res->chunked()) {
+            _write_count = 1;
+            return do_write(front.res);
+        }
+
+        // Consecutive ready responses are gathered in one write
+        _write_count = 0;
+        _write_buffers.clear();
+        for (auto& p : _pending) {
+            if (!p.ready || !p.res || p.res->chunked() || _write_count == _serializers.size()) {
+                break;
+            }
+
+            if (auto* compressor = _router.compressor()) {
+                compressor->compress(*p.req, *p.res);
+            }
+            p.res->prepare_payload();
+            _serializers[_write_count].emplace(*p.res);
+
+            boost::system::error_code ec;
+            _serializers[_write_count]->next(ec, [this](auto&, const auto& buffers) {
+                for (auto buffer : beast::buffers_range_ref(buffers)) {
+                    _write_buffers.push_back(buffer);
+                }
+            });
+            ++_write_count;
+
+            if (p.res->need_eof()) {
+                break;
+            }
+        }
+
+        const bool close = _pending[_write_count - 1].res->need_eof();
+
+        // The buffers are referenced, not copied by the write operation
+        if constexpr(SSL) {
+            asio::async_write(
+                this->_stream,
+                beast::buffers_range_ref(_write_buffers),
+                asio::bind_executor(this->_executor,
+                        [me = this->shared_from_this(), close](auto ec, auto bytes_transferred) {
+                            me->on_write(ec, bytes_transferred, close);
+                        }
+                )
+            );
+        } else {
+            asio::async_write(
+                this->_socket,
+                beast::buffers_range_ref(_write_buffers),
+                asio::bind_executor(this->_executor,
+                        [me = this->shared_from_this(), close](auto ec, auto bytes_transferred) {
+                            me->on_write(ec, bytes_transferred, close);
+                        }
+                )
+            );
+        }
     }
 
     void do_write(const std::shared_ptr<response>& response)
@@ -143,7 +662,7 @@ public:
             beast::http::async_write(
                 this->_stream,
                 *response,
-                asio::bind_executor(this->_strand,
+                asio::bind_executor(this->_executor,
                         [me = this->shared_from_this(), response](auto ec, auto bytes_transferred) {
                             me->on_write(ec, bytes_transferred, response->need_eof());
                         }
@@ -153,7 +672,7 @@ public:
             beast::http::async_write(
                 this->_socket,
                 *response,
-                asio::bind_executor(this->_strand,
+                asio::bind_executor(this->_executor,
                         [me = this->shared_from_this(), response](auto ec, auto bytes_transferred) {
                             me->on_write(ec, bytes_transferred, response->need_eof());
                         }
@@ -162,33 +681,258 @@ public:
         }
     }
 
+    void do_write_file(const std::shared_ptr<static_file_response>& res)
+    {
+#if defined(__linux__)
+        if constexpr(!SSL) {
+            if (res->body().file) {
+                // Header first, then the file content from the kernel
+                auto sr = std::make_shared<beast::http::response_serializer<static_file_body>>(*res);
+                beast::http::async_write_header(
+                    this->_socket,
+                    *sr,
+                    asio::bind_executor(this->_executor,
+                            [me = this->shared_from_this(), res, sr](auto ec, auto /* bytes_transferred */) {
+                                if (ec) {
+                                    return me->on_write(ec, 0, true);
+                                }
+                                me->_socket.native_non_blocking(true, ec);
+                                if (ec) {
+                                    return me->on_write(ec, 0, true);
+                                }
+                                me->do_sendfile(res, res->body().offset, res->body().size);
+                            }
+                    )
+                );
+                return;
+            }
+        }
+#endif
+
+        // TLS or no body (HEAD, 304, 416), the file is read by chunks
+        if constexpr(SSL) {
+            beast::http::async_write(
+                this->_stream,
+                *res,
+                asio::bind_executor(this->_executor,
+                        [me = this->shared_from_this(), res](auto ec, auto bytes_transferred) {
+                            me->on_write(ec, bytes_transferred, res->need_eof());
+                        }
+                )
+            );
+        } else {
+            beast::http::async_write(
+                this->_socket,
+                *res,
+                asio::bind_executor(this->_executor,
+                        [me = this->shared_from_this(), res](auto ec, auto bytes_transferred) {
+                            me->on_write(ec, bytes_transferred, res->need_eof());
+                        }
+                )
+            );
+        }
+    }
+
+#if defined(__linux__)
+    void do_sendfile(const std::shared_ptr<static_file_response>& res, std::uint64_t offset, std::uint64_t remain)
+    {
+        const int fd = res->body().file->file().native_handle();
+
+        while (remain > 0) {
+            auto position = static_cast<off_t>(offset);
+            auto count = static_cast<std::size_t>(std::min<std::uint64_t>(remain, 1u << 30));
+
+            auto sent = ::sendfile(_socket.native_handle(), fd, &position, count);
+            if (sent > 0) {
+                offset += sent;
+                remain -= sent;
+                continue;
+            }
+
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // Socket buffer full, wait for it to be writable
+                arm(_write_timer, _settings.write_timeout);
+                _socket.async_wait(asio::ip::tcp::socket::wait_write,
+                    asio::bind_executor(_executor,
+                        [me = this->shared_from_this(), res, offset, remain](auto ec) {
+                            if (ec) {
+                                return me->on_write(ec, 0, true);
+                            }
+                            me->do_sendfile(res, offset, remain);
+                        }));
+                return;
+            }
+
+            // The file has been truncated since opened, the response cannot be completed
+            boost::system::error_code ec = (sent < 0
+                    ? boost::system::error_code{errno, boost::system::system_category()}
+                    : beast::http::error::short_read);
+            return on_write(ec, 0, true);
+        }
+
+        on_write({}, res->body().size, res->need_eof());
+    }
+#endif
+
     void on_write(boost::system::error_code ec, std::size_t /* bytes_transferred */, bool close)
     {
         //std::cout << "session: do write" << std::endl;
+        _writing = false;
+        disarm(_write_timer);
+
+        // Remove the written responses, and the spooled bodies if any
+        for (std::size_t i = 0; i < _write_count; ++i) {
+            _serializers[i].reset();
+            request_pool::release(std::move(_pending.front().req));
+            response_pool::release(std::move(_pending.front().res));
+            _pending.pop_front();
+        }
+        _write_count = 0;
+
         if (ec) {
-            return fail(ec, "write");
+            _read_closed = true;
+            _pending.clear();
+            if (ec != asio::error::operation_aborted) {
+                fail(ec, "write");
+            }
+            return;
         }
 
         if (close) {
             // This means we should close the connection, usually because
             // the response indicated the "Connection: close" semantic.
+            _read_closed = true;
+            _pending.clear();
             return do_close();
         }
 
-        // Read another request
+        // Read another request, if paused by the pipeline limit
         //std::cout << "session: Read another request" << std::endl;
-        // Allow staying alive the session in case of postponed response
         do_read();
+        do_flush();
+
+        // Nothing in flight anymore, the connection is idle
+        if (_idle && _pending.empty() && !_writing) {
+            arm(_read_timer, _settings.idle_timeout);
+        }
+    }
+
+    // The connection is handed over to a HTTP/2 session, this one stays
+    // alive with it as the owner of the socket
+    void upgrade_http2(std::string_view preface, std::shared_ptr<beauty::request> upgrade = nullptr)
+    {
+        _closed = true;
+        _reading = false;
+        disarm(_read_timer);
+        disarm(_write_timer);
+
+        boost::system::error_code ec;
+        auto remote = _socket.remote_endpoint(ec);
+
+        using http2_stream_type = std::conditional_t<SSL, stream_type, asio::ip::tcp::socket>;
+        auto& stream = [this]() -> http2_stream_type& {
+            if constexpr(SSL) {
+                return _stream;
+            } else {
+                return _socket;
+            }
+        }();
+
+        std::make_shared<http2_session<http2_stream_type, Executor>>(
+                _app, _executor, stream, this->shared_from_this(), _router, _settings, remote)
+            ->run(std::move(_buffer), preface, std::move(upgrade));
+    }
+
+    // Start or restart a timeout, the connection is closed on expiry
+    void arm(watchdog& w, server_settings::duration timeout)
+    {
+        if (timeout.count() == 0) {
+            return disarm(w);
+        }
+
+        w.deadline = std::chrono::steady_clock::now() + timeout;
+        if (w.waiting && w.timer.expiry() <= w.deadline) {
+            return; // The wait in flight is renewed on expiry
+        }
+
+        // An earlier deadline, the wait in flight is cancelled
+        w.timer.expires_at(w.deadline);
+        do_wait(w);
+    }
+
+    void disarm(watchdog& w)
+    {
+        w.deadline = std::chrono::steady_clock::time_point::max();
+    }
+
+    void do_wait(watchdog& w)
+    {
+        w.waiting = true;
+        w.timer.async_wait([weak = this->weak_from_this(), &w](auto ec) {
+            auto me = weak.lock();
+            // Restarted with an earlier deadline meanwhile
+            if (!me || ec) {
+                return;
+            }
+
+            w.waiting = false;
+            if (w.deadline == std::chrono::steady_clock::time_point::max()) {
+                return;
+            }
+
+            if (w.deadline > std::chrono::steady_clock::now()) {
+                w.timer.expires_at(w.deadline);
+                return me->do_wait(w);
+            }
+
+            me->on_timeout(&w == &me->_write_timer);
+        });
+    }
+
+    void on_timeout(bool write)
+    {
+        if (_closed) {
+            return;
+        }
+
+        if (!write && _idle) {
+            // Idle keep-alive connection, closed gracefully
+            _read_closed = true;
+            return do_close();
+        }
+
+        // Slow or stalled client, the pending operations are aborted
+        fail(beast::error::timeout, (write ? "write" : "read"));
+        _closed = true;
+        _read_closed = true;
+        boost::system::error_code ec;
+        _socket.close(ec);
     }
 
     void do_close()
     {
+        if (_closed) {
+            return;
+        }
+        _closed = true;
+
         //std::cout << "session: do close, Shutdown the connection" << std::endl;
         if constexpr(SSL) {
+            if (_reading) {
+                // A pipelined request is being read, no shutdown at the same time
+                boost::system::error_code ec;
+                _socket.close(ec);
+                return;
+            }
+
             // Perform the SSL shutdown
             _stream.async_shutdown(
                 asio::bind_executor(
-                    _strand,
+                    _executor,
                     [me = this->shared_from_this()](auto ec){
                         me->on_ssl_shutdown(ec);
                     }));
@@ -211,63 +955,127 @@ public:
     }
 
 private:
+    beauty::application&  _app;
     asio::ip::tcp::socket _socket;
     stream_type                                   _stream = {};
-    asio::strand<asio::io_context::executor_type> _strand;
+    // A strand, or the io_context executor when the connection stays on one thread
+    Executor            _executor;
     beast::flat_buffer  _buffer;
     beauty::request     _request;
-    std::unique_ptr<beast::http::request_parser<beast::http::string_body>> _request_parser;
+    std::optional<beast::http::request_parser<beast::http::empty_body>>  _header_parser;
+    std::optional<beast::http::request_parser<beast::http::string_body>> _request_parser;
     bool _is_websocket = false;
+    const beauty::route* _route = nullptr;
+    static_files* _static_files = nullptr;
+
+    static constexpr std::uint64_t BODY_LIMIT = 1024 * 1024 * 1024; // 1Go..
+
+    // Pipelined requests, the responses are written in the requests order
+    struct pending {
+        std::shared_ptr<beauty::request>        req; // Alive until the response is written
+        std::shared_ptr<response>               res;
+        std::shared_ptr<static_file_response>   file;
+        const beauty::route*                    ws_route = nullptr;
+        std::shared_ptr<body_spool>             spool;
+        bool ready = false;
+    };
+
+    static constexpr std::size_t PIPELINE_LIMIT = 16;
+    boost::circular_buffer<pending> _pending = boost::circular_buffer<pending>(PIPELINE_LIMIT);
+    bool _reading = false;
+    bool _read_closed = false;  // No more request to read
+    bool _writing = false;
+    bool _closed = false;
+
+    // Gathered write of the responses ready
+    std::array<std::optional<beast::http::response_serializer<beast::http::string_body>>, PIPELINE_LIMIT> _serializers;
+    std::vector<asio::const_buffer> _write_buffers;
+    std::size_t _write_count = 0;
+
+    // Streaming body
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr std::size_t SPOOL_QUEUE_LIMIT = 4 * CHUNK_SIZE;
+    std::optional<beast::http::request_parser<beast::http::buffer_body>> _chunk_parser;
+    std::vector<char>           _chunk;
+    std::shared_ptr<body_spool> _spool;
 
     const beauty::router& _router;
+    const beauty::server_settings _settings;
+
+    // Read (idle, header and body) and write timeouts
+    watchdog            _read_timer;
+    watchdog            _write_timer;
+    bool                _idle = false;
+    bool                _first_request = true;
+    std::size_t         _request_count = 0;
 
 private:
     std::shared_ptr<response>
-    handle_request()
+    handle_request(beauty::request& req)
     {
         // Make sure we can handle the method
-        _request = _request_parser->release();
-        _request.remote(_socket.remote_endpoint());
+        //std::cout << "session: handle request, method: " << req.method_string() << ", target: " << req.target() << std::endl;
+        if (!_static_files && _router.find(req.method()) == _router.end()) {
+            return helper::bad_request(req, "Not supported HTTP-method");
+        }
 
-        _is_websocket = (beast::websocket::is_upgrade(_request));
-        //std::cout << "session: handle " << (_is_websocket ? "websocket" : "request") << ", method: " << _request.method_string() << ", target: " << _request.target() << std::endl;
+        if (!_route) {
+            return helper::not_found(req);
+        }
+
+        return execute(*_route, req);
+    }
 
-        auto found_method = _router.find(_request.method());
-        if (found_method == _router.end()) {
-            return helper::bad_request(_request, "Not supported HTTP-method");
+    // Call the route user handler, on the session executor or on the compute pool
+    static std::shared_ptr<response>
+    execute(const beauty::route& route, const beauty::request& req)
+    {
+        try {
+            auto res = make_response(beast::http::status::ok, req.version());
+            res->set(beast::http::field::server, BEAUTY_PROJECT_VERSION);
+            res->keep_alive(req.keep_alive());
+
+            route.execute(req, *res); // Call the route user handler
+
+            return res;
+        }
+        catch(const beauty::exception& ex) {
+            return ex.create_response(req);
+        }
+        catch(const std::exception& ex) {
+            return helper::server_error(req, ex.what());
         }
+    }
 
-        // Try to match a route for this request target
-        for(auto&& route : found_method->second) {
-            if (route.match(_request, _is_websocket)) {
-                // Match will update parameters request from the URL
-                try {
-                    if (_is_websocket) {
-                        // Create a websocket session, and transferring ownership
-                        std::make_shared<websocket_session>(std::move(_socket), route)->run(_request);
-                        return nullptr;
-                     }
-                    else {
-                        auto res = std::make_shared<response>(beast::http::status::ok, _request.version());
-                        res->set(beast::http::field::server, BEAUTY_PROJECT_VERSION);
-                        res->keep_alive(_request.keep_alive());
-
-                        route.execute(_request, *res); // Call the route user handler
-
-                        return res;
+#if BEAUTY_ENABLE_COROUTINES
+    // Call the route user coroutine, the execution policy does not apply
+    void
+    execute_awaitable(const std::shared_ptr<beauty::request>& req, const beauty::route* route)
+    {
+        auto res = make_response(beast::http::status::ok, req->version());
+        res->set(beast::http::field::server, BEAUTY_PROJECT_VERSION);
+        res->keep_alive(req->keep_alive());
+
+        asio::co_spawn(_executor,
+                route->execute_awaitable(*req, *res),
+                [me = this->shared_from_this(), req, res](std::exception_ptr ex) {
+                    if (!ex) {
+                        me->on_executed(req, res);
+                        return;
                     }
-                }
-                catch(const beauty::exception& ex) {
-                    return ex.create_response(_request);
-                }
-                catch(const std::exception& ex) {
-                    return helper::server_error(_request, ex.what());
-                }
-            }
-        }
 
-        return helper::not_found(_request);
+                    try {
+                        std::rethrow_exception(ex);
+                    }
+                    catch(const beauty::exception& ex) {
+                        me->on_executed(req, ex.create_response(*req));
+                    }
+                    catch(const std::exception& ex) {
+                        me->on_executed(req, helper::server_error(*req, ex.what()));
+                    }
+                });
     }
+#endif
 };
 
 // --------------------------------------------------------------------------
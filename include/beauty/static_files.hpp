@@ -0,0 +1,157 @@
+#pragma once
+
+#include <beauty/request.hpp>
+#include <beauty/export.hpp>
+
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace beast = boost::beast;
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// An opened file, shared by the responses and kept in the static_files cache
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT static_file
+{
+public:
+    static_file(beast::file&& file, std::uint64_t size, std::filesystem::file_time_type write_time);
+
+    // Positional read, the file position is not shared between the responses
+    std::size_t read(std::uint64_t offset, char* buffer, std::size_t size, boost::system::error_code& ec);
+
+    beast::file& file() noexcept { return _file; }
+    std::uint64_t size() const noexcept { return _size; }
+    std::filesystem::file_time_type write_time() const noexcept { return _write_time; }
+    const std::string& etag() const noexcept { return _etag; }
+    const std::string& last_modified() const noexcept { return _last_modified; }
+    std::int64_t last_modified_time() const noexcept { return _last_modified_time; }
+
+private:
+    beast::file     _file;
+    std::uint64_t   _size;
+    std::filesystem::file_time_type _write_time;
+
+    std::string     _etag;
+    std::string     _last_modified;
+    std::int64_t    _last_modified_time; // Seconds since epoch
+#if !BOOST_BEAST_USE_POSIX_FILE
+    std::mutex      _mtx;
+#endif
+};
+
+// --------------------------------------------------------------------------
+// Body of a byte range of a static file
+// --------------------------------------------------------------------------
+struct static_file_body
+{
+    struct value_type {
+        std::shared_ptr<static_file> file;
+        std::uint64_t offset{0};
+        std::uint64_t size{0};
+    };
+
+    static std::uint64_t size(const value_type& body) { return body.size; }
+
+    class writer {
+    public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template<bool isRequest, class Fields>
+        writer(const beast::http::header<isRequest, Fields>&, const value_type& body) :
+                _body(body),
+                _offset(body.offset),
+                _remain(body.size)
+        {}
+
+        void init(boost::system::error_code& ec) { ec = {}; }
+
+        boost::optional<std::pair<const_buffers_type, bool>>
+        get(boost::system::error_code& ec)
+        {
+            if (_remain == 0) {
+                ec = {};
+                return boost::none;
+            }
+
+            auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(_remain, _buffer.size()));
+            auto read = _body.file->read(_offset, _buffer.data(), amount, ec);
+            if (ec) {
+                return boost::none;
+            }
+            if (read == 0) {
+                ec = beast::http::error::short_read;
+                return boost::none;
+            }
+
+            _offset += read;
+            _remain -= read;
+
+            return {{const_buffers_type{_buffer.data(), read}, _remain > 0}};
+        }
+
+    private:
+        const value_type&   _body;
+        std::uint64_t       _offset;
+        std::uint64_t       _remain;
+        std::array<char, 16 * 1024> _buffer;
+    };
+};
+
+using static_file_response = beast::http::response<static_file_body>;
+
+// --------------------------------------------------------------------------
+// Serves the files of a root directory below a target prefix, with the
+// opened files kept in a LRU cache
+// --------------------------------------------------------------------------
+class BEAUTY_EXPORT static_files
+{
+public:
+    static_files(const std::string& prefix, std::filesystem::path root, std::size_t cache_capacity = 256);
+
+    static_files(const static_files&) = delete;
+    static_files& operator=(const static_files&) = delete;
+
+    const std::string& prefix() const noexcept { return _prefix; }
+    const std::filesystem::path& root() const noexcept { return _root; }
+
+    // True if the target path is the prefix or below
+    bool match(std::string_view path) const noexcept;
+
+    // Response for a GET or HEAD request (200, 206, 304 or 416),
+    // nullptr if the file does not exist
+    std::shared_ptr<static_file_response> serve(const beauty::request& req);
+
+    std::size_t cache_size() const;
+
+private:
+    std::shared_ptr<static_file> open(const std::filesystem::path& path);
+
+private:
+    std::string             _prefix;
+    std::filesystem::path   _root;
+
+    // Opened files cache, most recently used first
+    using lru_list = std::list<std::pair<std::string, std::shared_ptr<static_file>>>;
+
+    std::size_t             _cache_capacity;
+    mutable std::mutex      _cache_mtx;
+    lru_list                _cache;
+    std::unordered_map<std::string, lru_list::iterator> _cache_index;
+};
+
+}
@@ -24,6 +24,10 @@ public:
     url() = default;
     explicit url(std::string u);
 
+    // The views are moved to the copied string
+    url(const url& other);
+    url& operator=(const url& other);
+
     std::string_view scheme_view() const { return _scheme; }
     std::string scheme() const { return std::string(_scheme); }
     bool is_http() const { return _scheme == "http"; }
@@ -48,6 +52,9 @@ public:
 
     std::string strip_login_password() const;
 
+private:
+    void rebase(const url& other);
+
 private:
     // Full input url for the string_view
     std::string _url;
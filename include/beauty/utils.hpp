@@ -52,8 +52,18 @@ std::vector<std::string_view>
 split(const std::string_view& str_view, char sep = '/');
 
 // --------------------------------------------------------------------------
-BEAUTY_EXPORT std::string escape(const std::string& s);
-BEAUTY_EXPORT std::string unescape(const std::string& s);
+// Percent-encoding of all but the unreserved characters (A-Z a-z 0-9 - . _ ~),
+// and decoding of %XX and '+' as a space
+// --------------------------------------------------------------------------
+BEAUTY_EXPORT std::string escape(std::string_view s);
+BEAUTY_EXPORT std::string unescape(std::string_view s);
+
+// Written in out, of 3 * s.size() bytes at least for escape and s.size() for
+// unescape, the size written is returned. unescape can be done in place (out
+// is s.data()).
+BEAUTY_EXPORT std::size_t escape(std::string_view s, char* out);
+BEAUTY_EXPORT std::size_t unescape(std::string_view s, char* out);
+
 BEAUTY_EXPORT std::string make_uuid();
 
 // --------------------------------------------------------------------------
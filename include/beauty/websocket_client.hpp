@@ -1,6 +1,7 @@
 #pragma once
 
 #include <beauty/version.hpp>
+#include <beauty/resolver_cache.hpp>
 #include <beauty/utils.hpp>
 #include <beauty/websocket_context.hpp>
 
@@ -23,7 +24,6 @@ namespace beauty {
 class websocket_client : public std::enable_shared_from_this<websocket_client> {
 public:
     websocket_client(asio::io_context& ioc, url&& url, ws_handler&& handler) :
-            _resolver(asio::make_strand(ioc)),
             _websocket(asio::make_strand(ioc)),
             _url(std::move(url)),
             _ws_handler(std::move(handler))
@@ -45,11 +45,12 @@ public:
             port_view = "80";
         }
 
-        _resolver.async_resolve(
+        resolver_cache::Instance().async_resolve(
+                _websocket.get_executor(),
                 _url.host(),
-                port_view,
-                [me = this->shared_from_this()](auto ec, auto&& results) {
-                    me->on_resolve(ec, results);
+                std::string(port_view),
+                [me = this->shared_from_this()](auto ec, auto&& addresses) {
+                    me->on_resolve(ec, addresses);
                 });
     }
 
@@ -62,20 +63,20 @@ public:
     }
 
 private:
-    void on_resolve(beast::error_code ec, asio::ip::tcp::resolver::results_type results) {
+    void on_resolve(beast::error_code ec, const resolver_cache::endpoints& addresses) {
         if (ec) {
             return fail(ec, "resolve");
         }
 
         // Make the connection on the IP address we get from a lookup
         beast::get_lowest_layer(_websocket).async_connect(
-                results,
+                addresses,
                 [me = this->shared_from_this()](auto ec, auto&& ep) {
                     me->on_connect(ec, ep);
                 });
     }
 
-    void on_connect(beast::error_code ec, asio::ip::tcp::resolver::results_type::endpoint_type ep) {
+    void on_connect(beast::error_code ec, asio::ip::tcp::endpoint ep) {
         if (ec) {
             return fail(ec, "connect");
         }
@@ -207,7 +208,6 @@ private:
     }
 
 private:
-    asio::ip::tcp::tcp::resolver _resolver;
     beast::websocket::stream<beast::tcp_stream> _websocket;
     beast::flat_buffer _buffer;
     url _url;
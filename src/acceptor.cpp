@@ -3,54 +3,134 @@
 #include <beauty/session.hpp>
 #include <beauty/utils.hpp>
 
+namespace {
+#if defined(SO_REUSEPORT)
+using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+#if BEAUTY_ENABLE_OPENSSL
+//---------------------------------------------------------------------------
+// ALPN protocol selected by the server, h2 first if offered by the client
+//---------------------------------------------------------------------------
+int
+select_alpn(SSL*, const unsigned char** out, unsigned char* out_length,
+        const unsigned char* in, unsigned int in_length, void*)
+{
+    static constexpr unsigned char protocols[] = "\x02h2\x08http/1.1";
+    if (SSL_select_next_proto(const_cast<unsigned char**>(out), out_length,
+                protocols, sizeof(protocols) - 1, in, in_length) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+#endif
+
+//---------------------------------------------------------------------------
+// Create the session SLL or not and run it
+//---------------------------------------------------------------------------
+template<typename Executor>
+void
+run_session(beauty::application& app, Executor executor, asio::ip::tcp::socket&& socket,
+        const beauty::router& router, const beauty::server_settings& settings)
+{
+    if (app.is_ssl_activated()) {
+#if BEAUTY_ENABLE_OPENSSL
+        std::make_shared<beauty::session<true, Executor>>(
+                app, std::move(executor), std::move(socket), router, settings, app.ssl_context())->run();
+#endif
+    } else {
+        std::make_shared<beauty::session<false, Executor>>(
+                app, std::move(executor), std::move(socket), router, settings)->run();
+    }
+}
+}
+
 namespace beauty {
 
 //---------------------------------------------------------------------------
 acceptor::acceptor(
     application& app,
     beauty::endpoint& endpoint,
-    const beauty::router& router) :
+    const beauty::router& router,
+    const beauty::server_settings& settings) :
             _app(app),
-            _acceptor(app.ioc()),
-            _socket(app.ioc()),
-            _router(router)
+            _router(router),
+            _settings(settings)
+{
+    std::size_t listener_count = 1;
+#if defined(SO_REUSEPORT)
+    if (_app.is_sharded()) {
+        listener_count = _app.shard_count();
+    }
+#endif
+
+#if BEAUTY_ENABLE_OPENSSL
+    if (_app.is_ssl_activated() && _settings.http2) {
+        SSL_CTX_set_alpn_select_cb(_app.ssl_context().native_handle(), select_alpn, nullptr);
+    }
+#endif
+
+    // The first listener gives the port in case of dynamic port allocation
+    for (std::size_t i = 0; i < listener_count; ++i) {
+        auto a = std::make_unique<asio::ip::tcp::acceptor>(_app.shard(i));
+        if (!open(*a, endpoint, _app.is_sharded())) {
+            _acceptors.clear();
+            _app.stop();
+            return;
+        }
+        _acceptors.push_back(std::move(a));
+    }
+}
+
+//---------------------------------------------------------------------------
+bool
+acceptor::open(asio::ip::tcp::acceptor& acceptor, beauty::endpoint& endpoint, bool sharded)
 {
     boost::system::error_code ec;
 
     // Open the acceptor
-    _acceptor.open(endpoint.protocol(), ec);
+    acceptor.open(endpoint.protocol(), ec);
     if (ec) {
         fail(ec, "open");
-        _app.stop();
-        return;
+        return false;
     }
 
     // Allow address reuse
-    _acceptor.set_option(asio::socket_base::reuse_address(true));
+    acceptor.set_option(asio::socket_base::reuse_address(true), ec);
     if (ec) {
         fail(ec, "set_option");
-        _app.stop();
-        return;
+        return false;
     }
 
+#if defined(SO_REUSEPORT)
+    // A listening socket per shard on the same port, the kernel balances the connections
+    if (sharded) {
+        acceptor.set_option(reuse_port(true), ec);
+        if (ec) {
+            fail(ec, "set_option");
+            return false;
+        }
+    }
+#endif
+
     // Bind to the server address
-    _acceptor.bind(endpoint, ec);
+    acceptor.bind(endpoint, ec);
     if (ec) {
         fail(ec, "bind");
-        _app.stop();
-        return;
+        return false;
     }
 
     // Update server endpoint in case of dynamic port allocation
-    endpoint.port(_acceptor.local_endpoint().port());
+    endpoint.port(acceptor.local_endpoint().port());
 
     // Start listening for connections
-    _acceptor.listen(asio::socket_base::max_listen_connections, ec);
+    acceptor.listen(asio::socket_base::max_listen_connections, ec);
     if (ec) {
         fail(ec, "listen");
-        _app.stop();
-        return;
+        return false;
     }
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
@@ -63,35 +143,48 @@ acceptor::~acceptor()
 void
 acceptor::run()
 {
-    if (!_acceptor.is_open()) {
-        return;
+    for (std::size_t i = 0; i < _acceptors.size(); ++i) {
+        do_accept(i);
     }
-    do_accept();
 }
 
 //---------------------------------------------------------------------------
 void
 acceptor::stop()
 {
-    if (_acceptor.is_open()) {
-        _acceptor.close();
+    for (auto& a : _acceptors) {
+        if (a->is_open()) {
+            boost::system::error_code ec;
+            a->close(ec);
+        }
     }
 }
 
 //---------------------------------------------------------------------------
 void
-acceptor::do_accept()
+acceptor::do_accept(std::size_t index)
 {
-    _acceptor.async_accept(
-        _socket,
-        [me = shared_from_this()](auto ec) {
-            me->on_accept(ec);
-        });
+    auto& a = *_acceptors[index];
+    if (!a.is_open()) {
+        return;
+    }
+
+    auto handler = [me = shared_from_this(), index](auto ec, asio::ip::tcp::socket socket) {
+        me->on_accept(index, ec, std::move(socket));
+    };
+
+    if (_acceptors.size() == 1 && _app.is_sharded()) {
+        // No SO_REUSEPORT, the connections are given to the shards in turn
+        auto& ioc = _app.shard(_next_shard++ % _app.shard_count());
+        a.async_accept(ioc, std::move(handler));
+    } else {
+        a.async_accept(std::move(handler));
+    }
 }
 
 //---------------------------------------------------------------------------
 void
-acceptor::on_accept(boost::system::error_code ec)
+acceptor::on_accept(std::size_t index, boost::system::error_code ec, asio::ip::tcp::socket&& socket)
 {
     if (ec == boost::system::errc::operation_canceled) {
         return; // Nothing to do anymore
@@ -101,19 +194,24 @@ acceptor::on_accept(boost::system::error_code ec)
         fail(ec, "accept");
         _app.stop();
     }
-    else {
-        // Create the session SLL or not and run it
-        if (_app.is_ssl_activated()) {
-#if BEAUTY_ENABLE_OPENSSL
-            std::make_shared<session_https>(_app.ioc(), std::move(_socket), _router, _app.ssl_context())->run();
-#endif
+    else if (_app.is_sharded()) {
+        // A sharded connection stays on its io_context thread, no strand needed
+        auto executor = *socket.get_executor().target<asio::io_context::executor_type>();
+        if (executor.running_in_this_thread()) {
+            run_session(_app, executor, std::move(socket), _router, _settings);
         } else {
-            std::make_shared<session_http>(_app.ioc(), std::move(_socket), _router)->run();
+            // Accepted for another shard (in turn), started on its thread
+            asio::post(executor, [me = shared_from_this(), executor, socket = std::move(socket)]() mutable {
+                run_session(me->_app, executor, std::move(socket), me->_router, me->_settings);
+            });
         }
     }
+    else {
+        run_session(_app, asio::make_strand(_app.ioc()), std::move(socket), _router, _settings);
+    }
 
     // Accept another connection
-    do_accept();
+    do_accept(index);
 }
 
 }
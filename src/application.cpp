@@ -71,20 +71,34 @@ application::start(int concurrency)
         // The application was started before, we need
         // to restart the ioc cleanly
         ioc().restart();
+        for (auto& s : _shards) {
+            s->ioc.restart();
+        }
     }
     _state = State::started;
 
+    // A shard per thread, the first one is the main io_context
+    if (_sharded) {
+        _shards.resize(std::max(1, concurrency) - 1);
+        for (auto& s : _shards) {
+            if (!s) {
+                s = std::make_unique<shard_context>();
+            }
+        }
+    }
+
     // Run the I/O service on the requested number of threads
     _threads.resize(std::max(1, concurrency));
     _active_threads = 0;
     for(auto& t : _threads) {
         int id = ++_active_threads;
-        t = std::thread([this, id] {
+        auto& ioc = (_sharded ? shard(id - 1) : this->ioc());
+        t = std::thread([this, id, &ioc] {
             beauty::thread_set_name(_thread_name_prefix + std::to_string(id));
 
             for(;;) {
                 try {
-                    ioc().run();
+                    ioc.run();
                     break;
                 }
                 catch(const std::exception& ex) {
@@ -106,6 +120,10 @@ application::stop(bool reset)
         return;
     }
     _state = State::stopped;
+    {
+        std::lock_guard guard{_wait_mtx}; // Not missed by a waiter checking the state
+    }
+    _wait_cv.notify_all();
 
     if (reset) {
         for(auto&& t : timers) {
@@ -115,6 +133,27 @@ application::stop(bool reset)
     }
 
     ioc().stop();
+    for (auto& s : _shards) {
+        s->ioc.stop();
+    }
+
+    // The offloaded works still running are waited for, the queued ones are dropped
+    std::unique_ptr<asio::thread_pool> compute_pool;
+    {
+        std::lock_guard guard{_compute_mtx};
+        compute_pool = std::move(_compute_pool);
+    }
+    if (compute_pool) {
+        compute_pool->stop();
+        if (compute_pool->get_executor().running_in_this_thread()) {
+            // Stopped from an offloaded work, its own thread cannot be joined there
+            std::thread([pool = std::shared_ptr<asio::thread_pool>(std::move(compute_pool))] {
+                pool->join();
+            }).detach();
+        } else {
+            compute_pool->join();
+        }
+    }
 
     while(_active_threads != 0) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -147,6 +186,26 @@ application::wait() const
     }
 }
 
+// --------------------------------------------------------------------------
+bool
+application::wait_until(const std::function<bool()>& done)
+{
+    std::unique_lock lock{_wait_mtx};
+    _wait_cv.wait(lock, [this, &done] { return done() || is_stopped(); });
+    return done();
+}
+
+// --------------------------------------------------------------------------
+void
+application::notify(const std::function<void()>& update)
+{
+    {
+        std::lock_guard guard{_wait_mtx};
+        update();
+    }
+    _wait_cv.notify_all();
+}
+
 // --------------------------------------------------------------------------
 void
 application::post(std::function<void()> fct)
@@ -154,6 +213,18 @@ application::post(std::function<void()> fct)
     boost::asio::post(ioc().get_executor(), std::move(fct));
 }
 
+// --------------------------------------------------------------------------
+void
+application::offload(std::function<void()> fct)
+{
+    std::lock_guard guard{_compute_mtx};
+    if (!_compute_pool) {
+        auto count = (_compute_threads > 0 ? _compute_threads : (int)std::thread::hardware_concurrency());
+        _compute_pool = std::make_unique<asio::thread_pool>(std::max(1, count));
+    }
+    boost::asio::post(*_compute_pool, std::move(fct));
+}
+
 // --------------------------------------------------------------------------
 application&
 application::Instance()
@@ -18,7 +18,9 @@ attributes::attributes(const std::string& str, char sep)
 void
 attributes::insert(std::string key, std::string value)
 {
-    _attributes.emplace(std::move(key), beauty::unescape(value));
+    // Decoded in place, never longer
+    value.resize(beauty::unescape(value, value.data()));
+    _attributes.emplace(std::move(key), std::move(value));
 }
 
 // --------------------------------------------------------------------------
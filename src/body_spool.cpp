@@ -0,0 +1,137 @@
+#include <beauty/body_spool.hpp>
+
+#include <beauty/application.hpp>
+#include <beauty/request.hpp>
+#include <beauty/utils.hpp>
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+body_spool::~body_spool()
+{
+    if (_file) {
+        std::fclose(_file);
+    }
+    if (!_path.empty()) {
+        std::remove(_path.c_str());
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::append(beauty::request& req, const char* data, std::size_t size)
+{
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+
+    if (_path.empty()) {
+        if (req.body().size() + size <= _threshold) {
+            req.body().append(data, size);
+            return;
+        }
+
+        // Threshold exceeded, the body already received goes in a temporary file
+        _path = (std::filesystem::temp_directory_path() / ("beauty_" + make_uuid())).string();
+        _queued = std::move(req.body());
+        std::string{}.swap(req.body());
+    }
+
+    _queued.append(data, size);
+    if (!_busy) {
+        do_write();
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::async_flush(flush_cb cb)
+{
+    if (_busy) {
+        _on_flush = std::move(cb);
+        return;
+    }
+
+    asio::post(_executor, [cb = std::move(cb), error = _error] { cb(error); });
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::finish(beauty::request& req)
+{
+    if (_file) {
+        // Already flushed on the compute pool, nothing left to write
+        auto error = std::fclose(_file);
+        _file = nullptr;
+        if (error) {
+            throw std::runtime_error("Unable to close the spool file [" + _path + "]");
+        }
+    }
+
+    req.body_file(_path);
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::do_write()
+{
+    _busy = true;
+    _writing.swap(_queued);
+
+    _app.offload([me = shared_from_this()] {
+        std::exception_ptr error;
+        try {
+            if (!me->_file) {
+                me->_file = std::fopen(me->_path.c_str(), "wb");
+                if (!me->_file) {
+                    throw std::runtime_error("Unable to create the spool file [" + me->_path + "]");
+                }
+            }
+            me->write(me->_writing.data(), me->_writing.size());
+            if (std::fflush(me->_file)) {
+                throw std::runtime_error("Unable to write in the spool file [" + me->_path + "]");
+            }
+        }
+        catch(...) {
+            error = std::current_exception();
+        }
+
+        asio::post(me->_executor, [me, error] { me->on_write(error); });
+    });
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::on_write(std::exception_ptr error)
+{
+    _busy = false;
+    _writing.clear();
+    if (error) {
+        _error = error;
+        _queued.clear();
+    }
+
+    if (!_queued.empty()) {
+        return do_write();
+    }
+
+    if (_on_flush) {
+        auto cb = std::move(_on_flush);
+        _on_flush = nullptr;
+        cb(_error);
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+body_spool::write(const char* data, std::size_t size)
+{
+    if (size && std::fwrite(data, 1, size, _file) != size) {
+        throw std::runtime_error("Unable to write in the spool file [" + _path + "]");
+    }
+}
+
+}
@@ -1,17 +1,67 @@
 #include <beauty/client.hpp>
 
 #include <boost/system/error_code.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
 #if BEAUTY_ENABLE_OPENSSL
 #include <boost/asio/ssl/stream.hpp>
 #endif
 
 #include "session_client.hpp"
+#include "client_pool.hpp"
+#include "request_policy.hpp"
 
 namespace beauty
 {
+namespace {
+// --------------------------------------------------------------------------
+// Created on the first asynchronous request, by one of the threads sending it
+// --------------------------------------------------------------------------
+template<typename T, typename F>
+std::shared_ptr<T>
+create_once(std::shared_ptr<T>& ptr, F&& make)
+{
+    auto existing = std::atomic_load(&ptr);
+    if (existing) {
+        return existing;
+    }
+
+    auto created = make();
+    if (std::atomic_compare_exchange_strong(&ptr, &existing, created)) {
+        return created;
+    }
+    return existing; // Created by another thread meanwhile
+}
+
+// --------------------------------------------------------------------------
+// The idempotent requests are sent by the policy, which may send them again
+// --------------------------------------------------------------------------
+template<typename Pool>
+void
+send_on(const std::shared_ptr<Pool>& pool, request_policy& policy, beauty::request&& req,
+        const beauty::url& url, const beauty::duration& d, completion_handler&& cb,
+        std::shared_ptr<client::response_handler> stream)
+{
+    if (stream || !policy.applies(req)) {
+        pool->send(std::move(req), url, d, std::move(cb), std::move(stream));
+        return;
+    }
+
+    policy.send(std::move(req), Pool::key(url), d, std::move(cb),
+            [pool, url](beauty::request&& req, const beauty::duration& d, completion_handler&& cb,
+                    std::shared_ptr<request_handle> handle) {
+                pool->send(std::move(req), url, d, std::move(cb), nullptr, std::move(handle));
+            });
+}
+}
+
 #if BEAUTY_ENABLE_OPENSSL
 // --------------------------------------------------------------------------
-client::client(certificates&& c)
+client::client(certificates&& c, client_settings settings) :
+        _settings(std::move(settings))
 {
     beauty::application::Instance(std::move(c));
 }
@@ -110,17 +160,188 @@ client::put_before(const beauty::duration& d, const std::string& url,
 }
 
 // --------------------------------------------------------------------------
-// Synchronous request
+void
+client::get_stream_before(const beauty::duration& d, const std::string& url,
+        response_handler&& handler)
+{
+    beauty::request request;
+    request.method(beast::http::verb::get);
+
+    send_request(std::move(request), d, url, std::move(handler));
+}
+
+// --------------------------------------------------------------------------
+void
+client::get_file_before(const beauty::duration& d, const std::string& url,
+        const std::string& path, client_cb&& cb)
+{
+    // The file, and the first write error
+    struct download {
+        beast::file                 file;
+        boost::system::error_code   ec;
+    };
+
+    auto dl = std::make_shared<download>();
+    boost::system::error_code ec;
+    dl->file.open(path.c_str(), beast::file_mode::write, ec);
+    if (ec) {
+        return cb(ec, {});
+    }
+
+    response_handler handler;
+    handler.on_chunk = [dl](const char* data, std::size_t size, resume_cb&& resume) {
+        while (size && !dl->ec) {
+            auto written = dl->file.write(data, size, dl->ec);
+            data += written;
+            size -= written;
+        }
+        resume();
+    };
+    handler.on_complete = [dl, cb = std::move(cb)](boost::system::error_code ec, beauty::response&& response) {
+        boost::system::error_code close_ec;
+        dl->file.close(close_ec);
+        if (!ec) {
+            ec = (dl->ec ? dl->ec : close_ec);
+        }
+        cb(ec, std::move(response));
+    };
+
+    get_stream_before(d, url, std::move(handler));
+}
+
+// --------------------------------------------------------------------------
+void
+client::send_all(std::vector<request_spec>&& requests, const beauty::duration& deadline,
+        batch_cb&& cb, std::size_t successes)
+{
+    // The responses gathered, until the callback is called
+    struct batch {
+        std::mutex                      mtx;
+        std::vector<client_response>    responses;
+        std::size_t                     remaining;
+        std::size_t                     successes;
+        batch_cb                        cb;
+    };
+
+    auto b = std::make_shared<batch>();
+    b->responses.resize(requests.size(),
+            std::make_pair(boost::system::error_code(asio::error::operation_aborted), beauty::response{}));
+    b->remaining = requests.size();
+    b->successes = (successes ? std::min(successes, requests.size()) : requests.size());
+    b->cb = std::move(cb);
+
+    if (requests.empty() || !b->successes) {
+        return b->cb(std::move(b->responses));
+    }
+
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        auto& request = requests[i].request;
+        if (request.method() == beast::http::verb::unknown) {
+            request.method(beast::http::verb::get);
+        }
+
+        send_request(std::move(request), deadline, requests[i].url,
+                [b, i, all = !successes](boost::system::error_code ec, beauty::response&& response) {
+                    batch_cb cb;
+                    std::vector<client_response> responses;
+                    {
+                        std::lock_guard guard{b->mtx};
+                        if (!b->cb) {
+                            return; // Enough successes already
+                        }
+
+                        const bool success = (!ec && response.result_int() / 100 == 2);
+                        b->responses[i] = std::make_pair(ec, std::move(response));
+                        --b->remaining;
+                        if (success || all) {
+                            --b->successes;
+                        }
+
+                        if (!b->successes || !b->remaining) {
+                            cb = std::move(b->cb);
+                            b->cb = nullptr;
+                            responses = std::move(b->responses);
+                        }
+                    }
+
+                    if (cb) {
+                        cb(std::move(responses));
+                    }
+                });
+    }
+}
+
+// --------------------------------------------------------------------------
+// Synchronous request, on the connections of the asynchronous ones
 // --------------------------------------------------------------------------
 client::client_response
 client::send_request(beauty::request&& req, const beauty::duration& d,
         const std::string& url)
+{
+    if (in_event_loop()) {
+        // From a handler or a callback, the event loop cannot wait for itself
+        return send_request_alone(std::move(req), d, url);
+    }
+
+    auto& app = beauty::application::Instance();
+    auto result = std::make_shared<std::optional<client_response>>();
+
+    send_request(std::move(req), d, url,
+            [&app, result](boost::system::error_code ec, beauty::response&& response) {
+                app.notify([&] { *result = std::make_pair(ec, std::move(response)); });
+            });
+
+    if (!app.wait_until([&result] { return result->has_value(); })) {
+        // Stopped meanwhile, the request will not complete
+        return std::make_pair(boost::system::error_code(asio::error::operation_aborted),
+                beauty::response{});
+    }
+    return std::move(**result);
+}
+
+// --------------------------------------------------------------------------
+// The event loop of the connections, or of the application before the first
+// request, runs in this thread
+// --------------------------------------------------------------------------
+bool
+client::in_event_loop() const
+{
+    auto running = [](const auto& pool) {
+        return pool && pool->get_executor().running_in_this_thread();
+    };
+    if (running(std::atomic_load(&_pool_http))) {
+        return true;
+    }
+#if BEAUTY_ENABLE_OPENSSL
+    if (running(std::atomic_load(&_pool_https))) {
+        return true;
+    }
+#endif
+    return beauty::application::Instance().ioc().get_executor().running_in_this_thread();
+}
+
+// --------------------------------------------------------------------------
+// Synchronous request, with its own event loop and connection
+// --------------------------------------------------------------------------
+client::client_response
+client::send_request_alone(beauty::request&& req, const beauty::duration& d,
+        const std::string& url)
 {
     asio::io_context ioc;
 
+    // A lookup still waited for (timeout) is given up before the event loop is destroyed
+    struct lookups_guard {
+        asio::io_context& ioc;
+        ~lookups_guard() { resolver_cache::Instance().cancel(ioc); }
+    } lookups{ioc};
+
     boost::system::error_code ec;
     beauty::response response;
 
+    // One request on its own connection, HTTP/2 would not help
+    client_settings settings;
+    settings.http2 = false;
+
     try {
         std::shared_ptr<session_client_http> session_http;
 #if BEAUTY_ENABLE_OPENSSL
@@ -131,7 +352,7 @@ client::send_request(beauty::request&& req, const beauty::duration& d,
         if (_url.is_https()) {
 #if BEAUTY_ENABLE_OPENSSL
             session_https = std::make_shared<session_client_https>(ioc,
-                    beauty::application::Instance().ssl_context());
+                    beauty::application::Instance().ssl_context(), settings);
 
             session_https->run(std::move(req), _url, d);
 #else
@@ -139,7 +360,7 @@ client::send_request(beauty::request&& req, const beauty::duration& d,
 #endif
         }
         else {
-            session_http = std::make_shared<session_client_http>(ioc);
+            session_http = std::make_shared<session_client_http>(ioc, settings);
             session_http->run(std::move(req), _url, d);
         }
 
@@ -169,53 +390,114 @@ client::send_request(beauty::request&& req, const beauty::duration& d,
 void
 client::send_request(beauty::request&& req, const beauty::duration& d,
         const std::string& url, client_cb&& cb)
+{
+    send_request(std::move(req), d, url, std::move(cb), nullptr);
+}
+
+// --------------------------------------------------------------------------
+void
+client::send_request(beauty::request&& req, const beauty::duration& d,
+        const std::string& url, response_handler&& handler)
+{
+    auto cb = std::move(handler.on_complete);
+    send_request(std::move(req), d, url, std::move(cb),
+            std::make_shared<response_handler>(std::move(handler)));
+}
+
+// --------------------------------------------------------------------------
+void
+client::send_request(beauty::request&& req, const beauty::duration& d,
+        const std::string& url, completion_handler&& cb, std::shared_ptr<response_handler> stream)
 {
     try {
         if (!beauty::application::Instance().is_started()) {
             beauty::application::Instance().start();
         }
 
-        _url = beauty::url(url);
+        auto _url = beauty::url(url);
+
+        auto policy = create_once(_policy, [this] {
+            return std::make_shared<request_policy>(beauty::application::Instance().ioc(), _settings);
+        });
 
         if (_url.is_https()) {
 #if BEAUTY_ENABLE_OPENSSL
-            if (!_session_https) {
-                // Create the session on first call...
-                _session_https = std::make_shared<session_client_https>(
-                        beauty::application::Instance().ioc(),
-                        beauty::application::Instance().ssl_context());
-            }
-
-            _session_https->run(std::move(req), _url, d, std::move(cb));
+            auto pool = create_once(_pool_https, [this] {
+                return std::make_shared<client_pool_https>(
+                        beauty::application::Instance().ioc(), _settings,
+                        [settings = _settings](bool http2) mutable {
+                            settings.http2 = http2;
+                            return std::make_shared<session_client_https>(
+                                    beauty::application::Instance().ioc(),
+                                    beauty::application::Instance().ssl_context(),
+                                    settings);
+                        });
+            });
+
+            send_on(pool, *policy, std::move(req), _url, d, std::move(cb), std::move(stream));
 #else
             throw std::runtime_error("OpenSSL is not activated");
 #endif
         }
         else {
-            if (!_session_http) {
-                // Create the session on first call...
-                _session_http = std::make_shared<session_client_http>(
-                        beauty::application::Instance().ioc());
-            }
-
-            _session_http->run(std::move(req), _url, d, std::move(cb));
+            auto pool = create_once(_pool_http, [this] {
+                return std::make_shared<client_pool_http>(
+                        beauty::application::Instance().ioc(), _settings,
+                        [settings = _settings](bool http2) mutable {
+                            settings.http2 = http2;
+                            return std::make_shared<session_client_http>(
+                                    beauty::application::Instance().ioc(), settings);
+                        });
+            });
+
+            send_on(pool, *policy, std::move(req), _url, d, std::move(cb), std::move(stream));
         }
     }
     catch(const boost::system::system_error& ex) {
-        cb(ex.code(), {});
-#if BEAUTY_ENABLE_OPENSSL
-        _session_https.reset();
-#endif
-        _session_http.reset();
+        if (cb) {
+            cb(ex.code(), {});
+        }
     }
     catch(const std::exception&) {
-        cb(boost::system::error_code(boost::system::errc::bad_address,
-                boost::system::system_category()), {});
+        if (cb) {
+            cb(boost::system::error_code(boost::system::errc::bad_address,
+                    boost::system::system_category()), {});
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+client_pool_stats
+client::pool_stats() const
+{
+    auto pool_http = std::atomic_load(&_pool_http);
+#if BEAUTY_ENABLE_OPENSSL
+    auto pool_https = std::atomic_load(&_pool_https);
+#endif
+
+    client_pool_stats stats;
+    for (const auto& s : {
+                pool_http ? pool_http->stats() : client_pool_stats{},
 #if BEAUTY_ENABLE_OPENSSL
-        _session_https.reset();
+                pool_https ? pool_https->stats() : client_pool_stats{},
 #endif
-        _session_http.reset();
+            }) {
+        stats.connections += s.connections;
+        stats.pending += s.pending;
+        stats.hits += s.hits;
+        stats.connects += s.connects;
+        stats.evictions += s.evictions;
+        stats.requeued += s.requeued;
     }
+    return stats;
+}
+
+// --------------------------------------------------------------------------
+client_request_stats
+client::request_stats() const
+{
+    auto policy = std::atomic_load(&_policy);
+    return (policy ? policy->stats() : client_request_stats{});
 }
 
 // --------------------------------------------------------------------------
@@ -229,7 +511,7 @@ client::ws(const std::string& url, ws_handler&& handler)
             beauty::application::Instance().start();
         }
 
-        if (!_session_http) {
+        if (!_websocket_client) {
             // Create the session on first call...
             _websocket_client = std::make_shared<websocket_client>(
                     beauty::application::Instance().ioc(),
@@ -0,0 +1,496 @@
+#pragma once
+
+// Only there to split the client.cpp file
+// Should be included only there, after session_client.hpp
+
+#include <beauty/client_settings.hpp>
+#include <beauty/request.hpp>
+#include <beauty/url.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mpsc_queue.hpp"
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Connections kept by host (scheme, host and port) for the asynchronous
+// requests of a client. A request is sent on a connection with some room
+// left, a HTTP/2 one is shared by the streams, a new connection is opened
+// below the maximum, otherwise the request waits for a connection. The
+// requests sent are queued without lock, and given a connection on the
+// strand of the pool.
+// --------------------------------------------------------------------------
+template<bool SSL>
+class client_pool : public std::enable_shared_from_this<client_pool<SSL>>
+{
+public:
+    using session_ptr = std::shared_ptr<session_client<SSL>>;
+    // The session of a new connection, with HTTP/2 or not
+    using session_factory = std::function<session_ptr(bool http2)>;
+    using clock = std::chrono::steady_clock;
+
+private:
+    struct connection {
+        session_ptr         session;
+        std::size_t         in_use = 0;
+        bool                connected = false;  // Once, the protocol known
+        clock::time_point   idle_since = clock::now();
+    };
+
+    struct pending_request {
+        explicit pending_request(asio::io_context& ioc) : timer(ioc) {}
+
+        beauty::request     request;
+        beauty::url         url;
+        beauty::duration    timeout{0};         // Of the whole request, none if 0
+        clock::time_point   since = clock::now();
+        completion_handler  cb;
+        std::shared_ptr<client::response_handler> stream;
+        std::shared_ptr<request_handle> handle;
+        asio::steady_timer  timer;
+    };
+
+    struct host {
+        std::vector<std::shared_ptr<connection>> connections;
+        std::deque<std::shared_ptr<pending_request>> waiting;
+        bool                http1 = false;      // No multiplexing, the protocol is not waited for
+    };
+
+    // The completion of a request sent on a connection, which is given back
+    struct pooled_callback {
+        std::weak_ptr<client_pool>  pool;
+        std::string                 k;
+        std::shared_ptr<connection> conn;
+        completion_handler          cb;
+
+        void operator()(boost::system::error_code ec, beauty::response&& response)
+        {
+            if (auto p = pool.lock()) {
+                p->release(k, conn, ec);
+            }
+            cb(ec, std::move(response));
+        }
+    };
+
+    // A request to send, or to fail, once the lock is released
+    struct action {
+        std::shared_ptr<pending_request>    request;
+        std::shared_ptr<connection> conn;       // None on failure
+        boost::system::error_code   ec = {};
+    };
+
+public:
+    client_pool(asio::io_context& ioc, client_settings settings, session_factory make_session) :
+            _ioc(ioc),
+            _settings(std::move(settings)),
+            _make_session(std::move(make_session)),
+            _strand(asio::make_strand(ioc)),
+            _sweep_timer(ioc)
+    {}
+
+    ~client_pool()
+    {
+        std::vector<std::shared_ptr<pending_request>> aborted;
+        _submitted.drain([&aborted](std::shared_ptr<pending_request>&& w) { aborted.push_back(std::move(w)); });
+        {
+            std::lock_guard guard{_mtx};
+            _sweep_timer.cancel();
+            for (auto& [key, h] : _hosts) {
+                aborted.insert(aborted.end(), h.waiting.begin(), h.waiting.end());
+                h.waiting.clear();
+            }
+        }
+
+        for (auto& w : aborted) {
+            w->timer.cancel();
+            w->cb(boost::asio::error::operation_aborted, {});
+        }
+    }
+
+    // The handle, if any, cancels the request and gives its connection
+    void send(beauty::request&& req, const beauty::url& url, const beauty::duration& d,
+            completion_handler&& cb, std::shared_ptr<client::response_handler> stream = nullptr,
+            std::shared_ptr<request_handle> handle = nullptr)
+    {
+        auto w = std::make_shared<pending_request>(_ioc);
+        w->request = std::move(req);
+        w->url = url;
+        w->timeout = d;
+        w->cb = std::move(cb);
+        w->stream = std::move(stream);
+        w->handle = std::move(handle);
+
+        // From any thread, the lock of the pool is taken by the strand only
+        if (_submitted.push(std::move(w))) {
+            asio::post(_strand, [me = this->shared_from_this()] {
+                me->_submitted.drain([&](std::shared_ptr<pending_request>&& w) { me->enqueue(w, false); });
+            });
+        }
+    }
+
+    asio::io_context::executor_type get_executor() const { return _ioc.get_executor(); }
+
+    client_pool_stats stats() const
+    {
+        std::lock_guard guard{_mtx};
+        auto s = _stats;
+        for (const auto& [key, h] : _hosts) {
+            s.connections += h.connections.size();
+            s.pending += h.waiting.size();
+        }
+        return s;
+    }
+
+    // Scheme, host and port
+    static std::string key(const beauty::url& url)
+    {
+        auto port = url.port();
+        if (!port) {
+            port = (url.is_https() ? 443 : 80);
+        }
+        return url.scheme() + "://" + url.host() + ":" + std::to_string(port);
+    }
+
+private:
+    // A request waits for a connection, the first one if sent before on a
+    // connection which could not take it
+    void enqueue(const std::shared_ptr<pending_request>& w, bool first)
+    {
+        const auto k = key(w->url);
+        if (w->handle) {
+            // Before it can be sent, the session replaces it then
+            w->handle->on_cancel(
+                    [weak = this->weak_from_this(), k, weak_w = std::weak_ptr<pending_request>(w)] {
+                        auto pool = weak.lock();
+                        auto w = weak_w.lock();
+                        if (pool && w) {
+                            pool->abandon(k, w, asio::error::operation_aborted);
+                        }
+                    });
+        }
+
+        std::vector<action> actions;
+        {
+            std::lock_guard guard{_mtx};
+            auto& h = _hosts[k];
+            if (first) {
+                h.waiting.push_front(w);
+                ++_stats.requeued;
+            } else if (h.waiting.size() >= _settings.max_pending_requests_per_host) {
+                actions.push_back({w, nullptr,
+                        boost::system::errc::make_error_code(boost::system::errc::resource_unavailable_try_again)});
+            } else {
+                h.waiting.push_back(w);
+            }
+
+            if (actions.empty()) {
+                dispatch(k, h, actions);
+
+                if (std::find(h.waiting.begin(), h.waiting.end(), w) != h.waiting.end()) {
+                    wait(k, w);
+                }
+            }
+        }
+
+        run(k, actions);
+    }
+
+    // A request not written on a connection closed meanwhile (a HTTP/1.1
+    // request timed out before it over TLS): its connection is released, and
+    // it waits for another one, whatever its method and the retry settings
+    void requeue(typename session_client<SSL>::unsent_request&& unsent)
+    {
+        auto* pooled = unsent.cb.template target<pooled_callback>();
+        if (!pooled) {
+            return unsent.cb(asio::error::connection_aborted, {});
+        }
+        release(pooled->k, pooled->conn, asio::error::connection_aborted);
+
+        auto w = std::make_shared<pending_request>(_ioc);
+        w->request = std::move(unsent.request);
+        w->url = std::move(unsent.url);
+        w->timeout = unsent.timeout;
+        w->cb = std::move(pooled->cb);
+        w->stream = std::move(unsent.stream);
+        w->handle = std::move(unsent.handle);
+
+        enqueue(w, true);
+    }
+
+    // Under the lock, the requests waiting are given a connection while possible
+    void dispatch(const std::string& k, host& h, std::vector<action>& actions)
+    {
+        while (!h.waiting.empty()) {
+            const auto& handle = h.waiting.front()->handle;
+            const void* avoid = (handle ? handle->avoid : nullptr);
+
+            auto conn = available(h, avoid);
+            if (conn) {
+                ++_stats.hits;
+            }
+            else if (_settings.http2 && !h.http1 && negotiating(h, avoid)) {
+                break; // May be HTTP/2, and shared by all the requests
+            }
+            else if (h.connections.size() < _settings.max_connections_per_host) {
+                conn = open(k, h);
+            }
+            else if (avoid && (conn = available(h, nullptr))) {
+                ++_stats.hits; // No other connection possible
+            }
+            else {
+                break;
+            }
+
+            auto w = std::move(h.waiting.front());
+            h.waiting.pop_front();
+            w->timer.cancel();
+
+            ++conn->in_use;
+            actions.push_back({std::move(w), std::move(conn)});
+        }
+    }
+
+    std::shared_ptr<connection> available(host& h, const void* avoid)
+    {
+        for (auto& conn : h.connections) {
+            if (conn->connected && conn->session.get() != avoid
+                    && conn->in_use < conn->session->capacity()) {
+                return conn;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool negotiating(const host& h, const void* avoid)
+    {
+        return std::any_of(h.connections.begin(), h.connections.end(),
+                [avoid](const auto& conn) { return !conn->connected && conn->session.get() != avoid; });
+    }
+
+    std::shared_ptr<connection> open(const std::string& k, host& h)
+    {
+        auto conn = std::make_shared<connection>();
+        conn->session = _make_session(_settings.http2 && !h.http1);
+        conn->session->on_unsent(
+                [weak = this->weak_from_this()](typename session_client<SSL>::unsent_request&& unsent) {
+                    if (auto pool = weak.lock()) {
+                        pool->requeue(std::move(unsent));
+                    } else {
+                        unsent.cb(asio::error::operation_aborted, {});
+                    }
+                });
+        conn->session->on_connected(
+                [weak = this->weak_from_this(), k, c = std::weak_ptr<connection>(conn)] {
+                    if (auto pool = weak.lock()) {
+                        if (auto conn = c.lock()) {
+                            pool->on_connected(k, conn);
+                        }
+                    }
+                });
+
+        ++_stats.connects;
+        h.connections.push_back(conn);
+        return conn;
+    }
+
+    // A request waits for a connection, the request timeout applies if shorter
+    void wait(const std::string& k, const std::shared_ptr<pending_request>& w)
+    {
+        auto d = _settings.pending_timeout;
+        if (w->timeout.count() && w->timeout < d) {
+            d = w->timeout;
+        }
+
+        w->timer.expires_after(d);
+        w->timer.async_wait(
+                [weak = this->weak_from_this(), k, weak_w = std::weak_ptr<pending_request>(w)](boost::system::error_code ec) {
+                    auto pool = weak.lock();
+                    auto w = weak_w.lock();
+                    if (!ec && pool && w) {
+                        pool->abandon(k, w, boost::system::errc::make_error_code(boost::system::errc::timed_out));
+                    }
+                });
+    }
+
+    // A request no longer waits for a connection: timed out, or cancelled
+    void abandon(const std::string& k, const std::shared_ptr<pending_request>& w, boost::system::error_code ec)
+    {
+        {
+            std::lock_guard guard{_mtx};
+            auto& waiting = _hosts[k].waiting;
+            auto found = std::find(waiting.begin(), waiting.end(), w);
+            if (found == waiting.end()) {
+                return; // Sent meanwhile
+            }
+            waiting.erase(found);
+            w->timer.cancel();
+        }
+
+        w->cb(ec, {});
+    }
+
+    void on_connected(const std::string& k, const std::shared_ptr<connection>& conn)
+    {
+        std::vector<action> actions;
+        {
+            std::lock_guard guard{_mtx};
+            auto& h = _hosts[k];
+            conn->connected = true;
+            if (conn->session->capacity() <= 1) {
+                h.http1 = true;
+            }
+            dispatch(k, h, actions);
+        }
+
+        run(k, actions);
+    }
+
+    // A request is completed, its connection can take another one
+    void release(const std::string& k, const std::shared_ptr<connection>& conn, boost::system::error_code ec)
+    {
+        std::vector<action> actions;
+        {
+            std::lock_guard guard{_mtx};
+            auto& h = _hosts[k];
+            if (!ec) {
+                conn->connected = true; // A response may be there before the connected hook
+            }
+            if (--conn->in_use == 0) {
+                conn->idle_since = clock::now();
+
+                // Not connected, or no longer usable: HTTP/2 GOAWAY
+                if (!conn->connected || conn->session->capacity() == 0) {
+                    h.connections.erase(std::remove(h.connections.begin(), h.connections.end(), conn),
+                            h.connections.end());
+                }
+            }
+            dispatch(k, h, actions);
+            sweep_later();
+        }
+
+        run(k, actions);
+    }
+
+    // Outside the lock, the sessions call back the pool
+    void run(const std::string& k, std::vector<action>& actions)
+    {
+        for (auto& [w, conn, ec] : actions) {
+            if (!conn) {
+                w->cb(ec, {});
+                continue;
+            }
+
+            // The time spent waiting is taken on the request timeout
+            auto d = w->timeout;
+            if (d.count()) {
+                d = std::max<beauty::duration>(d - (clock::now() - w->since), std::chrono::milliseconds(1));
+            }
+
+            if (w->handle) {
+                w->handle->connection(conn->session.get());
+            }
+
+            conn->session->run(std::move(w->request), w->url, d,
+                    pooled_callback{this->weak_from_this(), k, conn, std::move(w->cb)},
+                    std::move(w->stream), w->handle);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Idle connections eviction
+    // ------------------------------------------------------------------------
+    void sweep_later()
+    {
+        if (_sweeping) {
+            return;
+        }
+
+        std::optional<clock::time_point> next;
+        for (const auto& [key, h] : _hosts) {
+            if (h.connections.size() <= _settings.min_connections_per_host) {
+                continue;
+            }
+            for (const auto& conn : h.connections) {
+                if (!conn->in_use && (!next || conn->idle_since < *next)) {
+                    next = conn->idle_since;
+                }
+            }
+        }
+
+        if (next) {
+            _sweeping = true;
+            _sweep_timer.expires_at(*next + _settings.idle_timeout);
+            _sweep_timer.async_wait([weak = this->weak_from_this()](boost::system::error_code ec) {
+                auto pool = weak.lock();
+                if (!ec && pool) {
+                    pool->sweep();
+                }
+            });
+        }
+    }
+
+    void sweep()
+    {
+        std::vector<session_ptr> evicted;
+        {
+            std::lock_guard guard{_mtx};
+            _sweeping = false;
+
+            const auto expired = clock::now() - _settings.idle_timeout;
+            for (auto& [key, h] : _hosts) {
+                // The least recently used first
+                auto idle = h.connections;
+                idle.erase(std::remove_if(idle.begin(), idle.end(),
+                        [expired](const auto& conn) { return conn->in_use || conn->idle_since > expired; }),
+                        idle.end());
+                std::sort(idle.begin(), idle.end(),
+                        [](const auto& a, const auto& b) { return a->idle_since < b->idle_since; });
+
+                for (auto& conn : idle) {
+                    if (h.connections.size() <= _settings.min_connections_per_host) {
+                        break;
+                    }
+                    h.connections.erase(std::find(h.connections.begin(), h.connections.end(), conn));
+                    evicted.push_back(conn->session);
+                    ++_stats.evictions;
+                }
+            }
+            sweep_later();
+        }
+
+        for (auto& session : evicted) {
+            session->close();
+        }
+    }
+
+private:
+    asio::io_context&       _ioc;
+    client_settings         _settings;
+    session_factory         _make_session;
+
+    // The requests sent, not given to a host yet
+    mpsc_queue<std::shared_ptr<pending_request>> _submitted;
+    asio::strand<asio::io_context::executor_type> _strand;
+
+    mutable std::mutex      _mtx;
+    std::map<std::string, host> _hosts;
+    client_pool_stats       _stats;
+
+    asio::steady_timer      _sweep_timer;
+    bool                    _sweeping{false};
+};
+
+}
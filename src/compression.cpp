@@ -0,0 +1,402 @@
+#include <beauty/compression.hpp>
+
+#include <boost/beast/core/string.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <limits>
+
+#if BEAUTY_HAS_ZLIB
+#include <zlib.h>
+#endif
+#if BEAUTY_HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+#if BEAUTY_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace http = boost::beast::http;
+
+namespace {
+// --------------------------------------------------------------------------
+std::string_view
+view(boost::beast::string_view s) noexcept
+{
+    return {s.data(), s.size()};
+}
+
+// --------------------------------------------------------------------------
+bool
+iequals(std::string_view lhs, std::string_view rhs) noexcept
+{
+    return boost::beast::iequals(boost::beast::string_view{lhs.data(), lhs.size()},
+            boost::beast::string_view{rhs.data(), rhs.size()});
+}
+
+// --------------------------------------------------------------------------
+std::string_view
+trim(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// --------------------------------------------------------------------------
+bool
+icontains(std::string_view s, std::string_view token) noexcept
+{
+    return std::search(s.begin(), s.end(), token.begin(), token.end(),
+            [](char a, char b) { return std::tolower((unsigned char)a) == std::tolower((unsigned char)b); }) != s.end();
+}
+
+// --------------------------------------------------------------------------
+// Quality value in thousandths ("q=0.5" gives 500), 1000 if not set
+// --------------------------------------------------------------------------
+int
+quality(std::string_view params) noexcept
+{
+    auto q = params.find("q=");
+    if (q == std::string_view::npos) {
+        return 1000;
+    }
+
+    auto value = trim(params.substr(q + 2));
+    value = value.substr(0, value.find(';'));
+
+    int result = 0;
+    int digits = 0;
+    bool decimals = false;
+    for (char c : value) {
+        if (c == '.' && !decimals) {
+            decimals = true;
+            continue;
+        }
+        if (!std::isdigit((unsigned char)c) || (decimals && digits == 3)) {
+            break;
+        }
+        result = result * 10 + (c - '0');
+        if (decimals) ++digits;
+    }
+    for (; digits < 3; ++digits) {
+        result *= 10;
+    }
+
+    return std::min(result, 1000);
+}
+
+#if BEAUTY_HAS_ZLIB
+// --------------------------------------------------------------------------
+// Window bits of 15 for the zlib format (deflate), 15 + 16 for gzip
+// --------------------------------------------------------------------------
+std::string
+zlib_compress(std::string_view body, int level, int window_bits)
+{
+    if (body.size() > std::numeric_limits<uInt>::max()) {
+        return {};
+    }
+
+    z_stream zs{};
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {};
+    }
+
+    std::string out;
+    out.resize(deflateBound(&zs, static_cast<uLong>(body.size())));
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    zs.avail_in = static_cast<uInt>(body.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    auto ret = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+
+    if (ret != Z_STREAM_END) {
+        return {};
+    }
+    out.resize(zs.total_out);
+    return out;
+}
+#endif
+
+// --------------------------------------------------------------------------
+// The server preference, the first one wins on the same quality
+// --------------------------------------------------------------------------
+constexpr std::array<beauty::content_coding, 4> preferred_codings = {
+    beauty::content_coding::br,
+    beauty::content_coding::zstd,
+    beauty::content_coding::gzip,
+    beauty::content_coding::deflate
+};
+}
+
+namespace beauty {
+// --------------------------------------------------------------------------
+std::string_view
+to_string(content_coding coding) noexcept
+{
+    switch(coding) {
+        case content_coding::deflate:   return "deflate";
+        case content_coding::gzip:      return "gzip";
+        case content_coding::zstd:      return "zstd";
+        case content_coding::br:        return "br";
+        default:                        return "identity";
+    }
+}
+
+// --------------------------------------------------------------------------
+bool
+is_supported(content_coding coding) noexcept
+{
+    switch(coding) {
+        case content_coding::identity:  return true;
+#if BEAUTY_HAS_ZLIB
+        case content_coding::deflate:   return true;
+        case content_coding::gzip:      return true;
+#endif
+#if BEAUTY_HAS_ZSTD
+        case content_coding::zstd:      return true;
+#endif
+#if BEAUTY_HAS_BROTLI
+        case content_coding::br:        return true;
+#endif
+        default:                        return false;
+    }
+}
+
+// --------------------------------------------------------------------------
+content_coding
+negotiate(std::string_view accept_encoding) noexcept
+{
+    // Quality of each coding, -1 if not listed
+    std::array<int, 5> qualities;
+    qualities.fill(-1);
+    int wildcard = -1;
+
+    while (!accept_encoding.empty()) {
+        auto comma = accept_encoding.find(',');
+        auto item = trim(accept_encoding.substr(0, comma));
+        accept_encoding = (comma == std::string_view::npos ? std::string_view{} : accept_encoding.substr(comma + 1));
+
+        auto semicolon = item.find(';');
+        auto name = trim(item.substr(0, semicolon));
+        auto q = (semicolon == std::string_view::npos ? 1000 : quality(item.substr(semicolon + 1)));
+
+        if (name == "*") {
+            wildcard = q;
+            continue;
+        }
+        for (auto coding : preferred_codings) {
+            if (iequals(name, to_string(coding))
+                    || (coding == content_coding::gzip && iequals(name, "x-gzip"))) {
+                qualities[static_cast<int>(coding)] = q;
+            }
+        }
+    }
+
+    content_coding best = content_coding::identity;
+    int best_quality = 0;
+    for (auto coding : preferred_codings) {
+        if (!is_supported(coding)) {
+            continue;
+        }
+        auto q = qualities[static_cast<int>(coding)];
+        if (q < 0) {
+            q = wildcard;
+        }
+        if (q > best_quality) {
+            best = coding;
+            best_quality = q;
+        }
+    }
+    return best;
+}
+
+// --------------------------------------------------------------------------
+response_compressor::response_compressor(compression_settings settings) :
+        _settings(std::move(settings))
+{}
+
+// --------------------------------------------------------------------------
+bool
+response_compressor::is_eligible(const beauty::response& res) const
+{
+    const auto status = res.result_int();
+    if (status < 200 || status == 204 || status == 206 || status == 304) {
+        return false;
+    }
+
+    if (res.chunked() || res.body().size() < _settings.min_size
+            || res.count(http::field::content_encoding)
+            || icontains(view(res[http::field::cache_control]), "no-transform")) {
+        return false;
+    }
+
+    auto content_type = view(res[http::field::content_type]);
+    content_type = trim(content_type.substr(0, content_type.find(';')));
+    if (content_type.empty()) {
+        return false;
+    }
+
+    return std::any_of(_settings.content_types.begin(), _settings.content_types.end(),
+            [content_type](const std::string& type) {
+                if (!type.empty() && type.back() == '/') {
+                    return content_type.size() > type.size()
+                        && iequals(content_type.substr(0, type.size()), type);
+                }
+                return iequals(content_type, type);
+            });
+}
+
+// --------------------------------------------------------------------------
+content_coding
+response_compressor::compress(const beauty::request& req, beauty::response& res)
+{
+    if (!is_eligible(res)) {
+        return content_coding::identity;
+    }
+
+    // The body depends on the Accept-Encoding from now on, for the caches
+    auto vary = view(res[http::field::vary]);
+    if (vary.empty()) {
+        res.set(http::field::vary, "Accept-Encoding");
+    }
+    else if (vary != "*" && !icontains(vary, "accept-encoding")) {
+        res.set(http::field::vary, std::string(vary) + ", Accept-Encoding");
+    }
+
+    auto coding = negotiate(view(req[http::field::accept_encoding]));
+    if (coding == content_coding::identity) {
+        return coding;
+    }
+
+    const std::string_view body = res.body();
+    const auto cache_control = view(res[http::field::cache_control]);
+    const bool cacheable = _settings.cache_capacity > 0
+            && !icontains(cache_control, "no-store")
+            && (res.count(http::field::etag) || res.count(http::field::last_modified)
+                || icontains(cache_control, "max-age") || icontains(cache_control, "public"));
+
+    std::shared_ptr<const std::string> compressed;
+    cache_key key{coding, body.size(), 0};
+
+    if (cacheable) {
+        key.hash = std::hash<std::string_view>{}(body);
+
+        std::lock_guard guard{_cache_mtx};
+        // A hash collision must never serve the body of another response
+        if (auto found = _cache_index.find(key); found != _cache_index.end() && found->second->body == body) {
+            _cache.splice(_cache.begin(), _cache, found->second);
+            compressed = found->second->compressed;
+            ++_cache_hits;
+        }
+    }
+
+    if (!compressed) {
+        compressed = std::make_shared<const std::string>(compress(body, coding));
+
+        if (cacheable && body.size() + compressed->size() <= _settings.cache_capacity) {
+            std::lock_guard guard{_cache_mtx};
+            if (auto found = _cache_index.find(key); found != _cache_index.end()) {
+                // Compressed by another thread meanwhile, or a collision replaced
+                _cache_bytes -= found->second->bytes();
+                _cache.erase(found->second);
+                _cache_index.erase(found);
+            }
+            _cache.push_front(cache_entry{key, std::string(body), compressed});
+            _cache_index[key] = _cache.begin();
+            _cache_bytes += _cache.front().bytes();
+
+            while (_cache_bytes > _settings.cache_capacity) {
+                _cache_bytes -= _cache.back().bytes();
+                _cache_index.erase(_cache.back().key);
+                _cache.pop_back();
+            }
+        }
+    }
+
+    // Not worth it, or failed
+    if (compressed->empty() || compressed->size() >= body.size()) {
+        return content_coding::identity;
+    }
+
+    res.body().assign(*compressed);
+    auto name = to_string(coding);
+    res.set(http::field::content_encoding, boost::beast::string_view{name.data(), name.size()});
+
+    // A strong ETag identifies the encoded body, not the original one
+    auto etag = view(res[http::field::etag]);
+    if (etag.size() >= 2 && etag.front() == '"' && etag.back() == '"') {
+        std::string tagged{etag.substr(0, etag.size() - 1)};
+        tagged.append("-").append(name).append("\"");
+        res.set(http::field::etag, tagged);
+    }
+
+    return coding;
+}
+
+// --------------------------------------------------------------------------
+std::string
+response_compressor::compress(std::string_view body, content_coding coding) const
+{
+    switch(coding) {
+#if BEAUTY_HAS_ZLIB
+        case content_coding::deflate:
+            return zlib_compress(body, _settings.gzip_level, 15);
+        case content_coding::gzip:
+            return zlib_compress(body, _settings.gzip_level, 15 + 16);
+#endif
+#if BEAUTY_HAS_BROTLI
+        case content_coding::br: {
+            std::string out;
+            std::size_t size = BrotliEncoderMaxCompressedSize(body.size());
+            if (size == 0) {
+                return {};
+            }
+            out.resize(size);
+            if (!BrotliEncoderCompress(_settings.brotli_quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                        body.size(), reinterpret_cast<const uint8_t*>(body.data()),
+                        &size, reinterpret_cast<uint8_t*>(out.data()))) {
+                return {};
+            }
+            out.resize(size);
+            return out;
+        }
+#endif
+#if BEAUTY_HAS_ZSTD
+        case content_coding::zstd: {
+            std::string out;
+            out.resize(ZSTD_compressBound(body.size()));
+            auto size = ZSTD_compress(out.data(), out.size(), body.data(), body.size(), _settings.zstd_level);
+            if (ZSTD_isError(size)) {
+                return {};
+            }
+            out.resize(size);
+            return out;
+        }
+#endif
+        default:
+            return {};
+    }
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+response_compressor::cache_size() const
+{
+    std::lock_guard guard{_cache_mtx};
+    return _cache.size();
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+response_compressor::cache_hits() const
+{
+    std::lock_guard guard{_cache_mtx};
+    return _cache_hits;
+}
+
+}
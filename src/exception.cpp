@@ -1,5 +1,6 @@
 #include <beauty/exception.hpp>
 
+#include <beauty/message_pool.hpp>
 #include <beauty/version.hpp>
 #include <beauty/request.hpp>
 #include <beauty/response.hpp>
@@ -9,7 +10,7 @@ namespace beauty {
 std::shared_ptr<response>
 exception::create_response(const request &req) const
 {
-    auto res = std::make_shared<response>(_error_code, req.version());
+    auto res = make_response(_error_code, req.version());
     res->set(http::field::server, BEAUTY_PROJECT_VERSION);
     res->set(content_type::text_plain);
     res->keep_alive(req.keep_alive());
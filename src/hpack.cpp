@@ -0,0 +1,532 @@
+#include <beauty/hpack.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+// Huffman code of each symbol, and its length in bits (EOS is the last one)
+constexpr std::array<std::uint32_t, 257> huffman_codes = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5,
+    0xfffffe6, 0xfffffe7, 0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9,
+    0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec, 0xfffffed, 0xfffffee,
+    0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9,
+    0xffffffa, 0xffffffb, 0x14, 0x3f8, 0x3f9, 0xffa,
+    0x1ff9, 0x15, 0xf8, 0x7fa, 0x3fa, 0x3fb,
+    0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b,
+    0x1c, 0x1d, 0x1e, 0x1f, 0x5c, 0xfb,
+    0x7ffc, 0x20, 0xffb, 0x3fc, 0x1ffa, 0x21,
+    0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e,
+    0x6f, 0x70, 0x71, 0x72, 0xfc, 0x73,
+    0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5,
+    0x25, 0x26, 0x27, 0x6, 0x74, 0x75,
+    0x28, 0x29, 0x2a, 0x7, 0x2b, 0x76,
+    0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd,
+    0x1ffd, 0xffffffc, 0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8,
+    0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9, 0x3fffd6, 0x7fffda,
+    0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1,
+    0x7fffe2, 0x7fffe3, 0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5,
+    0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef, 0x3fffda, 0x1fffdd,
+    0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf,
+    0x7fffeb, 0x7fffec, 0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2,
+    0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef, 0xfffea, 0x3fffe2,
+    0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2,
+    0x3fffe8, 0x1ffffec, 0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde,
+    0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed, 0x7fff2, 0x1fffe3,
+    0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3,
+    0x7ffffe4, 0x7ffffe5, 0xfffec, 0xfffff3, 0xfffed, 0x1fffe6,
+    0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3, 0x3fffea, 0x3fffeb,
+    0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8,
+    0x7ffffe9, 0x7ffffea, 0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed,
+    0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee, 0x3fffffff
+};
+constexpr std::array<std::uint8_t, 257> huffman_lengths = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+
+// Static table, the index 0 is not used
+constexpr std::array<std::pair<std::string_view, std::string_view>, 62> static_table = {{
+    {"", ""},
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""}
+}};
+
+// --------------------------------------------------------------------------
+// Huffman decoding state machine, 4 bits at a time: a state is an internal
+// node of the code tree, at most one symbol is emitted by transition as the
+// shortest code is 5 bits long
+// --------------------------------------------------------------------------
+struct huffman_transition {
+    std::uint8_t state = 0;
+    std::uint8_t symbol = 0;
+    bool emit = false;
+    bool fail = false;
+};
+
+struct huffman_decoder {
+    std::vector<std::array<huffman_transition, 16>> transitions;
+    // The bits read since the last symbol are a valid padding: up to 7 bits, all set
+    std::vector<bool> accept;
+
+    huffman_decoder()
+    {
+        // Code tree, children 0 and 1 of the internal nodes, a leaf is a negative symbol - 1
+        struct node { int child[2] = {0, 0}; int depth = 0; bool ones = true; };
+        std::vector<node> tree(1);
+
+        for (int symbol = 0; symbol < 257; ++symbol) {
+            int n = 0;
+            for (int i = huffman_lengths[symbol] - 1; i >= 0; --i) {
+                int bit = (huffman_codes[symbol] >> i) & 1;
+                if (i == 0) {
+                    tree[n].child[bit] = -symbol - 1;
+                    break;
+                }
+                if (tree[n].child[bit] == 0) {
+                    tree[n].child[bit] = static_cast<int>(tree.size());
+                    node next;
+                    next.depth = tree[n].depth + 1;
+                    next.ones = tree[n].ones && bit;
+                    tree.push_back(next);
+                }
+                n = tree[n].child[bit];
+            }
+        }
+
+        transitions.resize(tree.size());
+        accept.resize(tree.size());
+        for (std::size_t state = 0; state < tree.size(); ++state) {
+            accept[state] = tree[state].ones && tree[state].depth <= 7;
+
+            for (int nibble = 0; nibble < 16; ++nibble) {
+                auto& t = transitions[state][nibble];
+                int n = static_cast<int>(state);
+                for (int i = 3; i >= 0; --i) {
+                    int next = tree[n].child[(nibble >> i) & 1];
+                    if (next >= 0) {
+                        n = next;
+                        continue;
+                    }
+
+                    int symbol = -next - 1;
+                    if (symbol == 256) {
+                        t.fail = true; // EOS in the string
+                        break;
+                    }
+                    t.emit = true;
+                    t.symbol = static_cast<std::uint8_t>(symbol);
+                    n = 0;
+                }
+                t.state = static_cast<std::uint8_t>(n);
+            }
+        }
+    }
+};
+
+// --------------------------------------------------------------------------
+// Index of the first static table entry of each name
+// --------------------------------------------------------------------------
+const std::unordered_map<std::string_view, std::size_t>&
+static_names()
+{
+    static const auto names = [] {
+        std::unordered_map<std::string_view, std::size_t> n;
+        for (std::size_t i = static_table.size() - 1; i > 0; --i) {
+            n[static_table[i].first] = i;
+        }
+        return n;
+    }();
+    return names;
+}
+
+// --------------------------------------------------------------------------
+void
+encode_integer(std::string& out, std::uint8_t flags, int prefix, std::uint64_t value)
+{
+    const std::uint64_t max = (1u << prefix) - 1;
+    if (value < max) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+
+    out.push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 128) {
+        out.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// --------------------------------------------------------------------------
+bool
+decode_integer(const std::uint8_t*& p, const std::uint8_t* end, int prefix, std::uint64_t& value)
+{
+    if (p == end) {
+        return false;
+    }
+
+    const std::uint64_t max = (1u << prefix) - 1;
+    value = *p++ & max;
+    if (value < max) {
+        return true;
+    }
+
+    for (int shift = 0; p != end && shift <= 28; shift += 7) {
+        auto b = *p++;
+        value += static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false; // Truncated, or too large for any sane use
+}
+
+// --------------------------------------------------------------------------
+void
+encode_string(std::string& out, std::string_view s)
+{
+    auto size = beauty::hpack::huffman_size(s);
+    if (size < s.size()) {
+        encode_integer(out, 0x80, 7, size);
+        beauty::hpack::huffman_encode(s, out);
+    } else {
+        encode_integer(out, 0x00, 7, s.size());
+        out.append(s);
+    }
+}
+
+// --------------------------------------------------------------------------
+bool
+decode_string(const std::uint8_t*& p, const std::uint8_t* end, std::string& s)
+{
+    if (p == end) {
+        return false;
+    }
+
+    const bool huffman = (*p & 0x80);
+    std::uint64_t size = 0;
+    if (!decode_integer(p, end, 7, size) || size > static_cast<std::uint64_t>(end - p)) {
+        return false;
+    }
+
+    s.clear();
+    if (huffman) {
+        if (!beauty::hpack::huffman_decode(p, size, s)) {
+            return false;
+        }
+    } else {
+        s.assign(reinterpret_cast<const char*>(p), size);
+    }
+    p += size;
+    return true;
+}
+}
+
+namespace beauty::hpack {
+// --------------------------------------------------------------------------
+std::size_t
+huffman_size(std::string_view s) noexcept
+{
+    std::size_t bits = 0;
+    for (unsigned char c : s) {
+        bits += huffman_lengths[c];
+    }
+    return (bits + 7) / 8;
+}
+
+// --------------------------------------------------------------------------
+void
+huffman_encode(std::string_view s, std::string& out)
+{
+    std::uint64_t bits = 0;
+    int count = 0;
+    for (unsigned char c : s) {
+        bits = (bits << huffman_lengths[c]) | huffman_codes[c];
+        count += huffman_lengths[c];
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(bits >> count));
+        }
+    }
+
+    // Padding with the most significant bits of EOS
+    if (count > 0) {
+        bits = (bits << (8 - count)) | (0xff >> count);
+        out.push_back(static_cast<char>(bits));
+    }
+}
+
+// --------------------------------------------------------------------------
+bool
+huffman_decode(const std::uint8_t* data, std::size_t size, std::string& out)
+{
+    static const huffman_decoder decoder;
+
+    std::uint8_t state = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        for (int nibble : {data[i] >> 4, data[i] & 0x0f}) {
+            const auto& t = decoder.transitions[state][nibble];
+            if (t.fail) {
+                return false;
+            }
+            if (t.emit) {
+                out.push_back(static_cast<char>(t.symbol));
+            }
+            state = t.state;
+        }
+    }
+    return decoder.accept[state];
+}
+
+// --------------------------------------------------------------------------
+void
+encode(std::string& out, std::string_view name, std::string_view value)
+{
+    std::string lower;
+    if (std::any_of(name.begin(), name.end(), [](unsigned char c) { return std::isupper(c); })) {
+        lower.assign(name);
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        name = lower;
+    }
+
+    const auto& names = static_names();
+    auto found = names.find(name);
+    if (found == names.end()) {
+        // Literal header field without indexing, new name
+        out.push_back(0x00);
+        encode_string(out, name);
+        encode_string(out, value);
+        return;
+    }
+
+    for (auto i = found->second; i < static_table.size() && static_table[i].first == name; ++i) {
+        if (static_table[i].second == value) {
+            // Indexed header field
+            encode_integer(out, 0x80, 7, i);
+            return;
+        }
+    }
+
+    // Literal header field without indexing, indexed name
+    encode_integer(out, 0x00, 4, found->second);
+    encode_string(out, value);
+}
+
+// --------------------------------------------------------------------------
+decoder::decoder(std::size_t max_table_size) :
+        _max_table_size(max_table_size),
+        _settings_table_size(max_table_size)
+{}
+
+// --------------------------------------------------------------------------
+bool
+decoder::decode(const std::uint8_t* data, std::size_t size, std::vector<field>& fields,
+                std::size_t max_list_size)
+{
+    const auto* p = data;
+    const auto* end = data + size;
+    bool first = true;
+    std::size_t list_size = 0;
+
+    // Counted before the field is copied
+    auto fits = [&](const field& f) {
+        list_size += 32 + f.name.size() + f.value.size();
+        return list_size <= max_list_size;
+    };
+
+    while (p != end) {
+        const auto b = *p;
+        std::uint64_t index = 0;
+
+        if (b & 0x80) {
+            // Indexed header field
+            if (!decode_integer(p, end, 7, index)) {
+                return false;
+            }
+            const auto* f = find(index);
+            if (!f || !fits(*f)) {
+                return false;
+            }
+            fields.push_back(*f);
+        }
+        else if ((b & 0xe0) == 0x20) {
+            // Dynamic table size update, only at the beginning of a block
+            if (!first || !decode_integer(p, end, 5, index) || index > _settings_table_size) {
+                return false;
+            }
+            _max_table_size = static_cast<std::size_t>(index);
+            evict(_max_table_size);
+            continue;
+        }
+        else {
+            // Literal header field, with incremental indexing (01), without
+            // indexing (0000) or never indexed (0001)
+            const bool indexing = ((b & 0xc0) == 0x40);
+            if (!decode_integer(p, end, (indexing ? 6 : 4), index)) {
+                return false;
+            }
+
+            field f;
+            if (index) {
+                const auto* named = find(index);
+                if (!named) {
+                    return false;
+                }
+                f.name = named->name;
+            }
+            else if (!decode_string(p, end, f.name)) {
+                return false;
+            }
+            if (!decode_string(p, end, f.value) || !fits(f)) {
+                return false;
+            }
+
+            if (indexing) {
+                insert(f);
+            }
+            fields.push_back(std::move(f));
+        }
+        first = false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+const field*
+decoder::find(std::uint64_t index) const noexcept
+{
+    static const auto table = [] {
+        std::array<field, static_table.size()> t;
+        for (std::size_t i = 0; i < static_table.size(); ++i) {
+            t[i] = {std::string(static_table[i].first), std::string(static_table[i].second)};
+        }
+        return t;
+    }();
+
+    if (index == 0) {
+        return nullptr;
+    }
+    if (index < table.size()) {
+        return &table[index];
+    }
+    index -= table.size();
+    return (index < _table.size() ? &_table[index] : nullptr);
+}
+
+// --------------------------------------------------------------------------
+void
+decoder::insert(field f)
+{
+    const std::size_t size = 32 + f.name.size() + f.value.size();
+    if (size > _max_table_size) {
+        // Larger than the table, which is emptied
+        evict(0);
+        return;
+    }
+
+    evict(_max_table_size - size);
+    _table_size += size;
+    _table.push_front(std::move(f));
+}
+
+// --------------------------------------------------------------------------
+void
+decoder::evict(std::size_t max_size)
+{
+    while (_table_size > max_size) {
+        _table_size -= 32 + _table.back().name.size() + _table.back().value.size();
+        _table.pop_back();
+    }
+}
+
+}
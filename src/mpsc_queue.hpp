@@ -0,0 +1,80 @@
+#pragma once
+
+// Only there for the client sessions and pools, should be included by
+// session_client.hpp and client_pool.hpp
+
+#include <atomic>
+#include <utility>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Lock-free queue with many producers and one consumer. The values are pushed
+// on a stack, the consumer takes all of them at once and gives them back in
+// the order they were pushed.
+// --------------------------------------------------------------------------
+template<typename T>
+class mpsc_queue
+{
+public:
+    mpsc_queue() = default;
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    ~mpsc_queue()
+    {
+        drain([](T&&) {});
+    }
+
+    // Any thread, true if the queue was empty: the consumer is to be woken up
+    bool push(T value)
+    {
+        auto* n = new node{std::move(value), _head.load(std::memory_order_relaxed)};
+        while (!_head.compare_exchange_weak(n->next, n,
+                    std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        return (n->next == nullptr);
+    }
+
+    // The consumer only, the values pushed so far given to f in order
+    template<typename F>
+    void drain(F&& f)
+    {
+        node* n = _head.exchange(nullptr, std::memory_order_acquire);
+
+        node* first = nullptr;
+        while (n) {
+            auto* next = n->next;
+            n->next = first;
+            first = n;
+            n = next;
+        }
+
+        // The values not given yet are dropped if f throws
+        struct dropper {
+            node* n;
+            ~dropper() {
+                while (n) {
+                    delete std::exchange(n, n->next);
+                }
+            }
+        } rest{first};
+
+        while (rest.n) {
+            auto* current = std::exchange(rest.n, rest.n->next);
+            T value = std::move(current->value);
+            delete current;
+            f(std::move(value));
+        }
+    }
+
+private:
+    struct node {
+        T       value;
+        node*   next;
+    };
+
+    std::atomic<node*> _head{nullptr};
+};
+
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+// Only there to split the client.cpp file
+// Should be included only there, after session_client.hpp
+
+#include <beauty/client_settings.hpp>
+#include <beauty/request.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+// Hedged and retried requests of a client. A request is sent by attempts,
+// each one with its handle: a hedge is sent if there is no response after
+// the hedge delay, a retry after a failure, and the first response (or the
+// last failure) is given. The other attempts are cancelled. The hedges and
+// the retries are bounded by a token bucket, the retry budget.
+// --------------------------------------------------------------------------
+class request_policy : public std::enable_shared_from_this<request_policy>
+{
+public:
+    using clock = std::chrono::steady_clock;
+    // Send one attempt, the callback may be called from the call
+    using attempt_fn = std::function<void(beauty::request&&, const beauty::duration&,
+            completion_handler&&, std::shared_ptr<request_handle>)>;
+
+private:
+    // Recent response times of a host
+    static constexpr std::size_t WINDOW_SIZE = 128;
+    static constexpr std::size_t MIN_SAMPLES = 10;
+
+    struct latencies {
+        std::vector<beauty::duration> samples;
+        std::size_t         next = 0;
+    };
+
+    struct call {
+        explicit call(asio::io_context& ioc) : hedge_timer(ioc) {}
+
+        std::mutex          mtx;
+        beauty::request     request;            // Copied for each attempt
+        std::string         host;
+        clock::time_point   deadline = clock::time_point::max();
+        clock::time_point   sent;               // First attempt, or the retry
+        completion_handler  cb;
+        attempt_fn          attempt;
+
+        std::vector<std::shared_ptr<request_handle>> attempts; // In flight, the first one sent first
+        std::size_t         hedges = 0;
+        std::size_t         retries = 0;
+        asio::steady_timer  hedge_timer;
+        bool                done = false;
+    };
+
+public:
+    request_policy(asio::io_context& ioc, client_settings settings) :
+            _ioc(ioc),
+            _settings(std::move(settings)),
+            _tokens(_settings.retry_budget_tokens)
+    {}
+
+    // Only the idempotent requests can be sent more than once
+    bool applies(const beauty::request& req) const
+    {
+        if (!_settings.hedging && !_settings.max_retries) {
+            return false;
+        }
+
+        switch (req.method()) {
+            case beast::http::verb::get:
+            case beast::http::verb::head:
+            case beast::http::verb::options:
+            case beast::http::verb::put:
+            case beast::http::verb::delete_:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void send(beauty::request&& req, const std::string& host, const beauty::duration& d,
+            completion_handler&& cb, attempt_fn&& attempt)
+    {
+        auto c = std::make_shared<call>(_ioc);
+        c->request = std::move(req);
+        c->host = host;
+        if (d.count()) {
+            c->deadline = clock::now() + d;
+        }
+        c->cb = std::move(cb);
+        c->attempt = std::move(attempt);
+
+        deposit();
+        launch(c, false);
+    }
+
+    client_request_stats stats() const
+    {
+        std::lock_guard guard{_mtx};
+        return _stats;
+    }
+
+private:
+    // Outside the lock of the call, the callback may be called at once
+    void launch(const std::shared_ptr<call>& c, bool hedge)
+    {
+        auto handle = std::make_shared<request_handle>();
+        beauty::request req;
+        beauty::duration d{0};
+        {
+            std::lock_guard guard{c->mtx};
+            if (c->done) {
+                return;
+            }
+            if (hedge && !c->attempts.empty()) {
+                handle->avoid = c->attempts.front()->connection();
+            }
+            c->attempts.push_back(handle);
+            if (!hedge) {
+                c->sent = clock::now();
+            }
+            req = c->request;
+            if (c->deadline != clock::time_point::max()) {
+                d = std::max<beauty::duration>(c->deadline - clock::now(), std::chrono::milliseconds(1));
+            }
+        }
+
+        c->attempt(std::move(req), d,
+                [me = shared_from_this(), c, handle, hedge](
+                        boost::system::error_code ec, beauty::response&& response) {
+                    me->on_response(c, handle, hedge, ec, std::move(response));
+                },
+                handle);
+
+        hedge_later(c);
+    }
+
+    // The hedge delay starts with each attempt sent, a hedge sent at most once by delay
+    void hedge_later(const std::shared_ptr<call>& c)
+    {
+        if (!_settings.hedging) {
+            return;
+        }
+
+        const auto delay = hedge_delay(c->host);
+
+        std::lock_guard guard{c->mtx};
+        if (c->done || c->hedges >= _settings.max_hedges || clock::now() + delay >= c->deadline) {
+            return;
+        }
+
+        c->hedge_timer.expires_after(delay);
+        c->hedge_timer.async_wait([weak = weak_from_this(), c](boost::system::error_code ec) {
+            auto me = weak.lock();
+            if (!ec && me) {
+                me->on_hedge_timer(c);
+            }
+        });
+    }
+
+    void on_hedge_timer(const std::shared_ptr<call>& c)
+    {
+        {
+            std::lock_guard guard{c->mtx};
+            if (c->done || c->hedges >= _settings.max_hedges) {
+                return;
+            }
+            if (!withdraw()) {
+                return;
+            }
+            ++c->hedges;
+        }
+
+        {
+            std::lock_guard guard{_mtx};
+            ++_stats.hedges;
+        }
+        launch(c, true);
+    }
+
+    void on_response(const std::shared_ptr<call>& c, const std::shared_ptr<request_handle>& handle,
+            bool hedge, boost::system::error_code ec, beauty::response&& response)
+    {
+        completion_handler cb;
+        clock::time_point sent;
+        std::vector<std::shared_ptr<request_handle>> losers;
+        bool retry = false;
+        {
+            std::lock_guard guard{c->mtx};
+            c->attempts.erase(std::remove(c->attempts.begin(), c->attempts.end(), handle), c->attempts.end());
+            if (c->done) {
+                return; // Another attempt answered first, or this one was cancelled
+            }
+
+            if (retryable(ec, response)) {
+                if (!c->attempts.empty()) {
+                    return; // The other attempts may still succeed
+                }
+                if (c->retries < _settings.max_retries && clock::now() < c->deadline && withdraw()) {
+                    ++c->retries;
+                    retry = true;
+                }
+            }
+
+            if (!retry) {
+                c->done = true;
+                c->hedge_timer.cancel();
+                losers = std::move(c->attempts);
+                c->attempts.clear();
+                cb = std::move(c->cb);
+                sent = c->sent;
+            }
+        }
+
+        if (retry) {
+            {
+                std::lock_guard guard{_mtx};
+                ++_stats.retries;
+            }
+            launch(c, false);
+            return;
+        }
+
+        // From the first attempt, not the winning one: the slow attempts
+        // cancelled by a hedge are counted, the delay does not drift down
+        if (!ec) {
+            response_time(c->host, clock::now() - sent, hedge);
+        }
+
+        for (auto& loser : losers) {
+            loser->cancel();
+        }
+        cb(ec, std::move(response));
+    }
+
+    // A connection failure, or a server or a proxy not able to answer for now
+    static bool retryable(boost::system::error_code ec, const beauty::response& response)
+    {
+        if (!ec) {
+            return (response.result() == beast::http::status::bad_gateway
+                    || response.result() == beast::http::status::service_unavailable
+                    || response.result() == beast::http::status::gateway_timeout);
+        }
+
+        return (ec == asio::error::connection_refused
+                || ec == asio::error::connection_reset
+                || ec == asio::error::connection_aborted
+                || ec == asio::error::broken_pipe
+                || ec == asio::error::not_connected
+                || ec == asio::error::eof
+                || ec == beast::http::error::end_of_stream);
+    }
+
+    // ------------------------------------------------------------------------
+    // Hedge delay, from the response times of the host
+    // ------------------------------------------------------------------------
+    beauty::duration hedge_delay(const std::string& host) const
+    {
+        std::vector<beauty::duration> samples;
+        {
+            std::lock_guard guard{_mtx};
+            auto found = _latencies.find(host);
+            if (found == _latencies.end() || found->second.samples.size() < MIN_SAMPLES) {
+                return _settings.hedge_delay;
+            }
+            samples = found->second.samples;
+        }
+
+        // Nearest rank
+        const auto p = std::clamp(_settings.hedge_percentile, 0.0, 1.0);
+        const auto rank = static_cast<std::size_t>(std::ceil(p * samples.size()));
+        auto nth = samples.begin() + std::clamp<std::size_t>(rank, 1, samples.size()) - 1;
+        std::nth_element(samples.begin(), nth, samples.end());
+        return std::max<beauty::duration>(*nth, _settings.hedge_min_delay);
+    }
+
+    void response_time(const std::string& host, beauty::duration d, bool hedge)
+    {
+        std::lock_guard guard{_mtx};
+        if (hedge) {
+            ++_stats.hedge_wins;
+        }
+
+        auto& l = _latencies[host];
+        if (l.samples.size() < WINDOW_SIZE) {
+            l.samples.push_back(d);
+        } else {
+            l.samples[l.next] = d;
+        }
+        l.next = (l.next + 1) % WINDOW_SIZE;
+    }
+
+    // ------------------------------------------------------------------------
+    // Retry budget
+    // ------------------------------------------------------------------------
+    void deposit()
+    {
+        std::lock_guard guard{_mtx};
+        _tokens = std::min(_tokens + _settings.retry_budget_ratio, _settings.retry_budget_tokens);
+    }
+
+    bool withdraw()
+    {
+        std::lock_guard guard{_mtx};
+        if (_tokens < 1) {
+            ++_stats.throttled;
+            return false;
+        }
+        _tokens -= 1;
+        return true;
+    }
+
+private:
+    asio::io_context&       _ioc;
+    client_settings         _settings;
+
+    mutable std::mutex      _mtx;
+    double                  _tokens;
+    std::unordered_map<std::string, latencies> _latencies;
+    client_request_stats    _stats;
+};
+
+}
@@ -0,0 +1,239 @@
+#include <beauty/resolver_cache.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+resolver_cache&
+resolver_cache::Instance()
+{
+    static resolver_cache cache;
+    return cache;
+}
+
+// --------------------------------------------------------------------------
+resolver_cache::resolver_cache(resolver_cache_settings settings) :
+        _settings(std::move(settings))
+{}
+
+// --------------------------------------------------------------------------
+resolver_cache::~resolver_cache()
+{
+    // The lookups not started are given up, the running ones are waited for
+    if (_pool) {
+        _pool->stop();
+        _pool->join();
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::settings(resolver_cache_settings settings)
+{
+    std::lock_guard guard{_mtx};
+    _settings = std::move(settings);
+}
+
+// --------------------------------------------------------------------------
+resolver_cache_settings
+resolver_cache::settings() const
+{
+    std::lock_guard guard{_mtx};
+    return _settings;
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::async_resolve(const asio::any_io_executor& executor,
+        const std::string& host, const std::string& port, resolve_cb cb)
+{
+    auto key = host + ":" + port;
+    auto now = clock::now();
+
+    boost::system::error_code ec;
+    endpoints addresses;
+    bool hit = false;
+    bool refresh = false;
+    {
+        std::lock_guard guard{_mtx};
+        auto& e = _entries[key];
+        e.last_used = now;
+
+        const bool cached = (_settings.ttl.count() && (e.ec || !e.addresses.empty()));
+        const bool fresh = (now < e.expiry);
+        const bool stale = (!e.ec && !e.addresses.empty() && _settings.background_refresh);
+
+        if (cached && (fresh || stale)) {
+            ++_hits;
+            hit = true;
+            ec = e.ec;
+            addresses = rotate(e);
+            refresh = (!fresh && !e.resolving);
+            e.resolving |= refresh;
+        } else {
+            // Waits for the lookup, only one by host at a time
+            e.waiters.push_back({asio::prefer(executor, asio::execution::outstanding_work.tracked), std::move(cb)});
+            if (e.resolving) {
+                return;
+            }
+            e.resolving = true;
+            refresh = true;
+        }
+        evict();
+    }
+
+    if (hit) {
+        asio::post(executor, [cb = std::move(cb), ec, addresses = std::move(addresses)]() mutable {
+            cb(ec, std::move(addresses));
+        });
+    }
+
+    if (refresh) {
+        lookup(key, host, port);
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::cancel(asio::execution_context& context)
+{
+    std::vector<waiter> cancelled; // Destroyed outside the lock
+    {
+        std::lock_guard guard{_mtx};
+        for (auto& [key, e] : _entries) {
+            auto of_context = std::stable_partition(e.waiters.begin(), e.waiters.end(),
+                    [&context](const waiter& w) {
+                        return &asio::query(w.executor, asio::execution::context_as<asio::execution_context&>) != &context;
+                    });
+            std::move(of_context, e.waiters.end(), std::back_inserter(cancelled));
+            e.waiters.erase(of_context, e.waiters.end());
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::lookup(const std::string& key, const std::string& host, const std::string& port)
+{
+    asio::thread_pool* pool = nullptr;
+    {
+        std::lock_guard guard{_mtx};
+        ++_lookups;
+        if (!_pool) {
+            _pool = std::make_unique<asio::thread_pool>(LOOKUP_THREADS);
+        }
+        pool = _pool.get();
+    }
+
+    asio::post(*pool, [this, pool, key, host, port] {
+        asio::ip::tcp::resolver resolver(*pool);
+        boost::system::error_code ec;
+        auto results = resolver.resolve(host, port, ec);
+        on_lookup(key, ec, results);
+    });
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::on_lookup(const std::string& key, boost::system::error_code ec,
+        const asio::ip::tcp::resolver::results_type& results)
+{
+    std::vector<std::pair<waiter, endpoints>> waiters;
+    {
+        std::lock_guard guard{_mtx};
+        auto& e = _entries[key];
+        e.resolving = false;
+
+        // Not a failure of the host, the previous result is kept
+        if (ec != asio::error::operation_aborted) {
+            e.ec = ec;
+            e.addresses.clear();
+            for (const auto& result : results) {
+                e.addresses.push_back(result.endpoint());
+            }
+            e.next = 0;
+            e.expiry = clock::now() + (ec ? _settings.negative_ttl : _settings.ttl);
+        }
+
+        for (auto& w : e.waiters) {
+            waiters.emplace_back(std::move(w), rotate(e));
+        }
+        e.waiters.clear();
+    }
+
+    for (auto& [w, addresses] : waiters) {
+        asio::post(w.executor, [cb = std::move(w.cb), ec, addresses = std::move(addresses)]() mutable {
+            cb(ec, std::move(addresses));
+        });
+    }
+}
+
+// --------------------------------------------------------------------------
+resolver_cache::endpoints
+resolver_cache::rotate(entry& e)
+{
+    endpoints addresses = e.addresses;
+    if (!addresses.empty()) {
+        std::rotate(addresses.begin(), addresses.begin() + e.next % addresses.size(), addresses.end());
+        e.next = (e.next + 1) % addresses.size();
+    }
+    return addresses;
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::evict()
+{
+    while (_entries.size() > _settings.max_entries) {
+        auto oldest = _entries.end();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (!it->second.resolving && (oldest == _entries.end()
+                    || it->second.last_used < oldest->second.last_used)) {
+                oldest = it;
+            }
+        }
+        if (oldest == _entries.end()) {
+            return; // All being resolved
+        }
+        _entries.erase(oldest);
+    }
+}
+
+// --------------------------------------------------------------------------
+void
+resolver_cache::clear()
+{
+    std::lock_guard guard{_mtx};
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        it = (it->second.resolving ? std::next(it) : _entries.erase(it));
+    }
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+resolver_cache::size() const
+{
+    std::lock_guard guard{_mtx};
+    return _entries.size();
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+resolver_cache::hits() const
+{
+    std::lock_guard guard{_mtx};
+    return _hits;
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+resolver_cache::lookups() const
+{
+    std::lock_guard guard{_mtx};
+    return _lookups;
+}
+
+}
@@ -1,6 +1,8 @@
 #include <beauty/route.hpp>
 #include <beauty/utils.hpp>
 
+#include <algorithm>
+
 namespace beauty {
 // --------------------------------------------------------------------------
 route::route(const std::string& path, route_cb&& cb) :
@@ -33,6 +35,23 @@ route::route(const std::string& path, ws_handler&& handler) :
     _ws_handler = std::move(handler);
 }
 
+// --------------------------------------------------------------------------
+route::route(const std::string& path, const beauty::route_info& route_info, beauty::stream_handler&& handler) :
+        route(path, route_info, std::move(handler.on_complete))
+{
+    _is_streaming = true;
+    _stream_handler = std::move(handler);
+}
+
+#if BEAUTY_ENABLE_COROUTINES
+// --------------------------------------------------------------------------
+route::route(const std::string& path, const beauty::route_info& route_info, route_awaitable_cb&& cb) :
+        route(path, route_info)
+{
+    _awaitable_cb = std::move(cb);
+}
+#endif
+
 // --------------------------------------------------------------------------
 // Try to extract a maximum of information from the route path
 // --------------------------------------------------------------------------
@@ -89,36 +108,67 @@ route::match(beauty::request& req, bool is_websocket) const noexcept
         return false;
     }
 
-    // Remove attributes and target split
-    auto target_split = split(std::string_view{req.target().data(), req.target().size()}, '?');
-    auto request_paths = split(target_split[0], '/');
-
-    if (_segments.size() != request_paths.size()) {
-        return false;
-    }
+    // Remove attributes from the target
+    auto target = std::string_view{req.target().data(), req.target().size()};
+    auto path = target.substr(0, target.find('?'));
 
-    std::string attrs = (target_split.size() > 1 ? std::string(target_split[1]) : "");
+    std::size_t begin = 0;
+    for (const auto& segment : _segments) {
+        if (begin > path.size()) {
+            return false; // Not enough segments
+        }
 
-    for (std::size_t i = 0; i < _segments.size(); ++i) {
-        auto& segment = _segments[i];
-        auto& request_segment = request_paths[i];
+        auto end = std::min(path.find('/', begin), path.size());
 
-        if (segment[0] == ':') {
-            attrs += (attrs.empty() ? "" : "&")
-                    + std::string(&segment[1], segment.size() - 1)
-                    + "="
-                    + std::string(request_segment);
-        }
-        else if (segment != request_segment) {
+        if (segment[0] != ':' && segment != path.substr(begin, end - begin)) {
             return false;
         }
+
+        begin = end + 1;
     }
 
-    if (!attrs.empty()) {
-        req.get_attributes() = attributes(attrs);
+    if (begin <= path.size()) {
+        return false; // Too many segments
     }
 
+    extract_attributes(req);
+
     return true;
 }
 
+// --------------------------------------------------------------------------
+void
+route::extract_attributes(beauty::request& req) const
+{
+    auto target = std::string_view{req.target().data(), req.target().size()};
+    auto query_begin = target.find('?');
+    auto path = target.substr(0, query_begin);
+
+    if (query_begin != std::string_view::npos && query_begin + 1 < target.size()) {
+        req.get_attributes() = attributes(std::string(target.substr(query_begin + 1)));
+    }
+    else {
+        req.get_attributes().clear();
+    }
+
+    // Copied again in the attributes on their next use
+    auto& params = req.get_path_params();
+    params.clear();
+
+    std::size_t begin = 0;
+    for (const auto& segment : _segments) {
+        auto end = std::min(path.find('/', begin), path.size());
+
+        if (segment[0] == ':') {
+            std::string_view name{segment.data() + 1, segment.size() - 1};
+            if (!params.push_back(name, begin, end - begin)) {
+                // Too many placeholders, fall back on the attributes
+                req.get_attributes().insert(std::string(name), std::string(path.substr(begin, end - begin)));
+            }
+        }
+
+        begin = end + 1;
+    }
+}
+
 }
@@ -2,31 +2,167 @@
 
 #include <algorithm>
 
+namespace {
+// --------------------------------------------------------------------------
+// Routes with less segments first, then with the less significant
+// placeholders (a placeholder on the first segment costs the most)
+// --------------------------------------------------------------------------
+bool
+route_priority(const beauty::route& lh, const beauty::route& rh)
+{
+    const auto lh_segment_count = lh.segments().size();
+    const auto rh_segment_count = rh.segments().size();
+
+    if (lh_segment_count < rh_segment_count) return true;
+    if (lh_segment_count > rh_segment_count) return false;
+
+    int lh_cost = 0, rh_cost = 0;
+    int power = 1;
+    for (int i = lh_segment_count - 1; i >= 0; --i) {
+        if (lh.segments()[i][0] == ':') lh_cost += power;
+        if (rh.segments()[i][0] == ':') rh_cost += power;
+        power *= 2;
+    }
+
+    return lh_cost < rh_cost;
+}
+}
+
 namespace beauty {
 // --------------------------------------------------------------------------
 void
 router::add_route(beast::http::verb v, route&& r)
 {
-    _routes[v].push_back(std::move(r));
+    auto& routes = _routes[v];
+    auto& tree = _trees[v];
+
+    // Keep the routes sorted by priority, the tree indexes are shifted accordingly
+    auto position = std::upper_bound(routes.begin(), routes.end(), r, route_priority);
+    const auto index = static_cast<std::size_t>(std::distance(routes.begin(), position));
+
+    shift(tree, index);
+
+    node* current = &tree;
+    for (const auto& segment : r.segments()) {
+        if (segment[0] == ':') {
+            if (!current->placeholder) {
+                current->placeholder = std::make_unique<node>();
+            }
+            current = current->placeholder.get();
+        }
+        else {
+            auto& child = current->statics[segment];
+            if (!child) {
+                child = std::make_unique<node>();
+            }
+            current = child.get();
+        }
+    }
+    current->routes.insert(
+            std::upper_bound(current->routes.begin(), current->routes.end(), index),
+            index);
+
+    routes.insert(position, std::move(r));
+}
+
+// --------------------------------------------------------------------------
+const route*
+router::match(beast::http::verb v, beauty::request& req, bool is_websocket) const
+{
+    auto found_tree = _trees.find(v);
+    if (found_tree == _trees.end()) {
+        return nullptr;
+    }
+
+    auto target = std::string_view{req.target().data(), req.target().size()};
+    auto path = target.substr(0, target.find('?'));
 
-    std::sort(_routes[v].begin(), _routes[v].end(),
-            [](const beauty::route& lh, const beauty::route& rh) {
-                const auto lh_segment_count = lh.segments().size();
-                const auto rh_segment_count = rh.segments().size();
+    const auto* found_route = lookup(found_tree->second, path, 0, _routes.at(v), is_websocket);
 
-                if (lh_segment_count < rh_segment_count) return true;
-                if (lh_segment_count > rh_segment_count) return false;
+    if (found_route) {
+        found_route->extract_attributes(req);
+    }
+
+    return found_route;
+}
+
+// --------------------------------------------------------------------------
+void
+router::add_static(const std::string& prefix, const std::string& root_dir)
+{
+    auto files = std::make_unique<static_files>(prefix, root_dir);
 
-                int lh_cost = 0, rh_cost = 0;
-                int power = 1;
-                for (int i = lh_segment_count - 1; i >= 0; --i) {
-                    if (lh.segments()[i][0] == ':') lh_cost += power;
-                    if (rh.segments()[i][0] == ':') rh_cost += power;
-                    power *= 2;
-                }
+    auto position = std::find_if(_static_files.begin(), _static_files.end(),
+            [&files](const auto& f) { return f->prefix().size() < files->prefix().size(); });
 
-                return lh_cost < rh_cost;
-            });
+    _static_files.insert(position, std::move(files));
+}
+
+// --------------------------------------------------------------------------
+static_files*
+router::match_static(std::string_view path) const noexcept
+{
+    for (const auto& files : _static_files) {
+        if (files->match(path)) {
+            return files.get();
+        }
+    }
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------
+void
+router::compression(const compression_settings& settings)
+{
+    _compressor = std::make_unique<response_compressor>(settings);
+}
+
+// --------------------------------------------------------------------------
+// Depth first search, static segments are preferred to placeholders
+// which gives the same result as the first match on the sorted routes
+// --------------------------------------------------------------------------
+const route*
+router::lookup(const node& n, std::string_view path, std::size_t begin,
+        const std::vector<route>& routes, bool is_websocket) noexcept
+{
+    if (begin > path.size()) {
+        // All the segments are consumed
+        for (auto index : n.routes) {
+            if (routes[index].is_websocket() == is_websocket) {
+                return &routes[index];
+            }
+        }
+        return nullptr;
+    }
+
+    auto end = std::min(path.find('/', begin), path.size());
+
+    if (auto found = n.statics.find(path.substr(begin, end - begin)); found != n.statics.end()) {
+        if (auto* r = lookup(*found->second, path, end + 1, routes, is_websocket)) {
+            return r;
+        }
+    }
+
+    if (n.placeholder) {
+        return lookup(*n.placeholder, path, end + 1, routes, is_websocket);
+    }
+
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------
+void
+router::shift(node& n, std::size_t from)
+{
+    for (auto& index : n.routes) {
+        if (index >= from) ++index;
+    }
+    for (auto& [_, child] : n.statics) {
+        shift(*child, from);
+    }
+    if (n.placeholder) {
+        shift(*n.placeholder, from);
+    }
 }
 
 }
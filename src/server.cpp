@@ -34,7 +34,7 @@ server::listen(int port, const std::string& address)
     _endpoint = beauty::endpoint{ip_address, (unsigned short)port};
 
     // Create and launch a listening port
-    _acceptor = std::make_shared<beauty::acceptor>(_app, _endpoint, _router);
+    _acceptor = std::make_shared<beauty::acceptor>(_app, _endpoint, _router, _settings);
     _acceptor->run();
 }
 
@@ -123,6 +123,26 @@ server::post(const std::string& path, const beauty::route_info& route_info, rout
     return *this;
 }
 
+// --------------------------------------------------------------------------
+server&
+server::put(const std::string& path, const beauty::route_info& route_info, stream_handler&& handler)
+{
+    _router.add_route(
+            beast::http::verb::put,
+            beauty::route(path, route_info, std::move(handler)));
+    return *this;
+}
+
+// --------------------------------------------------------------------------
+server&
+server::post(const std::string& path, const beauty::route_info& route_info, stream_handler&& handler)
+{
+    _router.add_route(
+            beast::http::verb::post,
+            beauty::route(path, route_info, std::move(handler)));
+    return *this;
+}
+
 // --------------------------------------------------------------------------
 server&
 server::options(const std::string& path, route_cb&& cb)
@@ -157,6 +177,22 @@ server::del(const std::string& path, const beauty::route_info& route_info, route
     return *this;
 }
 
+// --------------------------------------------------------------------------
+server&
+server::add_static(const std::string& prefix, const std::string& root_dir)
+{
+    _router.add_static(prefix, root_dir);
+    return *this;
+}
+
+// --------------------------------------------------------------------------
+server&
+server::compression(const compression_settings& settings)
+{
+    _router.compression(settings);
+    return *this;
+}
+
 // --------------------------------------------------------------------------
 void
 server::enable_swagger(const char* swagger_entrypoint)
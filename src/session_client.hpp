@@ -3,18 +3,93 @@
 // Only there to split the client.cpp file
 // Should be included only there
 
+#include <beauty/hpack.hpp>
+#include <beauty/http2.hpp>
+#include <beauty/resolver_cache.hpp>
+
+#include "mpsc_queue.hpp"
+
 #include <boost/version.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #if BEAUTY_ENABLE_OPENSSL
 #include <boost/asio/ssl.hpp>
 #endif
 
+#include <algorithm>
+#include <cstdlib>
 #include <deque>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 namespace beauty
 {
+// --------------------------------------------------------------------------
+// Cancellation of an asynchronous request, set by the pool while the request
+// waits for a connection, then by the session sending it. A request cancelled
+// before is cancelled as soon as it is taken.
+// --------------------------------------------------------------------------
+class request_handle
+{
+public:
+    void cancel()
+    {
+        std::function<void()> f;
+        {
+            std::lock_guard guard{_mtx};
+            _cancelled = true;
+            f = std::move(_cancel);
+            _cancel = nullptr;
+        }
+        if (f) {
+            f();
+        }
+    }
+
+    // Not called under a lock, the cancellation may be done at once
+    void on_cancel(std::function<void()> f)
+    {
+        {
+            std::lock_guard guard{_mtx};
+            if (!_cancelled) {
+                _cancel = std::move(f);
+                return;
+            }
+        }
+        f();
+    }
+
+    // The connection (session) the request is sent on
+    void connection(const void* c)
+    {
+        std::lock_guard guard{_mtx};
+        _connection = c;
+    }
+
+    const void* connection() const
+    {
+        std::lock_guard guard{_mtx};
+        return _connection;
+    }
+
+    // A connection not to use if another one is possible: a hedged request
+    const void* avoid = nullptr;
+
+private:
+    mutable std::mutex      _mtx;
+    std::function<void()>   _cancel;
+    const void*             _connection = nullptr;
+    bool                    _cancelled = false;
+};
+
 // --------------------------------------------------------------------------
 template<bool SSL>
 class session_client : public std::enable_shared_from_this<session_client<SSL>>
@@ -43,11 +118,30 @@ private:
         beauty::request         request;
         beast::http::response_parser<beast::http::string_body> response;
 
-        client::client_cb       cb;
+        completion_handler      cb;
+        std::shared_ptr<request_handle> handle;
+
+        // Sent on a HTTP/2 stream
+        std::uint32_t           stream_id{0};
+        std::int64_t            send_window{0};
+        std::int64_t            recv_window{0};
+        std::size_t             sent{0};            // Request body bytes
+        bool                    responded{false};   // Response header received
+        bool                    retried{false};     // Sent again on a new connection
+
+        // Response body streamed to a handler
+        std::shared_ptr<client::response_handler> stream;
+        std::optional<beast::http::response_parser<beast::http::buffer_body>> chunk_parser; // HTTP/1.1
+        std::string             chunk;              // Given to the handler, until resumed
+        std::string             pending;            // HTTP/2, received meanwhile
+        bool                    delivering{false};
+        bool                    ended{false};       // HTTP/2, the whole body received
+        bool                    completed{false};
 
         static
         std::shared_ptr<request_context> Create(asio::io_context& ioc, beauty::request&& req,
-                const beauty::url& url, const beauty::duration& d, std::optional<client::client_cb> cb = {}) {
+                const beauty::url& url, const beauty::duration& d, completion_handler cb = {},
+                std::shared_ptr<client::response_handler> stream = nullptr) {
 
             // Create a request context to pass on each callback
             auto req_ctx = std::make_shared<request_context>(ioc);
@@ -62,9 +156,8 @@ private:
             req_ctx->request.set(beast::http::field::user_agent, BEAUTY_PROJECT_VERSION);
             req_ctx->request.prepare_payload();
 
-            if (cb) {
-                req_ctx->cb = std::move(*cb);
-            }
+            req_ctx->cb = std::move(cb);
+            req_ctx->stream = std::move(stream);
 
             if (d.count()) {
                 req_ctx->timer.expires_after(d);
@@ -74,23 +167,82 @@ private:
         }
     };
 
+    // HTTP/2 streams, and the state of the connection
+    static constexpr std::uint32_t WINDOW_SIZE = 1024 * 1024;           // Per stream, and per connection
+    static constexpr std::size_t HEADER_BLOCK_LIMIT = 64 * 1024;
+    static constexpr std::size_t BODY_LIMIT = 1024 * 1024 * 1024;       // 1Go, as the HTTP/1.1 parser
+    static constexpr std::size_t READ_SIZE = 64 * 1024;
+    static constexpr std::size_t WRITE_HIGH_WATER = 256 * 1024;         // Data frames queued at a time
+
+    struct outgoing {
+        std::string             bytes;
+        asio::const_buffer      payload = {};
+        std::shared_ptr<void>   keep = {};
+    };
+
+    struct http2_connection {
+        std::map<std::uint32_t, std::shared_ptr<request_context>> streams;
+        std::uint32_t           next_id = 1;
+        std::uint32_t           last_sent_id = 0;
+        std::uint32_t           max_streams = 100; // Until the server settings
+
+        beast::flat_buffer      buffer;
+        hpack::decoder          decoder{4096};
+        std::vector<hpack::field> fields;
+        std::string             header_block;
+        std::uint32_t           continuation_id = 0;
+        std::uint8_t            continuation_flags = 0;
+
+        // Flow control
+        std::int64_t            send_window = http2::default_window_size;
+        std::int64_t            recv_window = WINDOW_SIZE;
+        std::int64_t            peer_initial_window = http2::default_window_size;
+        std::uint32_t           peer_max_frame_size = http2::default_max_frame_size;
+
+        // Frames queued, and the ones being written
+        std::vector<outgoing>   out;
+        std::vector<outgoing>   in_flight;
+        std::vector<asio::const_buffer> write_buffers;
+        std::string             write_data;
+        std::size_t             queued = 0;
+
+        boost::system::error_code error; // Protocol error, no retry
+        bool settings_received = false;
+        bool goaway = false;
+        bool reading = false;
+        bool writing = false;
+    };
+
+    using completion = std::pair<std::shared_ptr<request_context>, boost::system::error_code>;
+
 public:
+    // A request not sent, given back to be sent on another connection
+    struct unsent_request {
+        beauty::request         request;
+        beauty::url             url;
+        beauty::duration        timeout{0};     // Left, none if 0
+        completion_handler      cb;
+        std::shared_ptr<client::response_handler> stream;
+        std::shared_ptr<request_handle> handle;
+    };
+    using unsent_handler = std::function<void(unsent_request&&)>;
+
     template<bool U = SSL, typename std::enable_if_t<!U, int> = 0>
-    explicit session_client(asio::io_context& ioc) :
+    explicit session_client(asio::io_context& ioc, client_settings settings = {}) :
             _ioc(ioc),
-            _resolver(_ioc),
             _socket(_ioc),
-          _strand(asio::make_strand(ioc))
+          _strand(asio::make_strand(ioc)),
+          _settings(std::move(settings))
     {}
 
 #if BEAUTY_ENABLE_OPENSSL
     template<bool U = SSL, typename std::enable_if_t<U, int> = 0>
-    session_client(asio::io_context& ioc, asio::ssl::context& ctx) :
+    session_client(asio::io_context& ioc, asio::ssl::context& ctx, client_settings settings = {}) :
             _ioc(ioc),
-            _resolver(_ioc),
             _socket(_ioc),
             _stream(ioc, ctx),
-          _strand(asio::make_strand(ioc))
+          _strand(asio::make_strand(ioc)),
+          _settings(std::move(settings))
     {}
 #endif
 
@@ -119,25 +271,97 @@ public:
 
     // Start the asynchronous request
     void run(beauty::request&& req, const beauty::url& url, const beauty::duration& d,
-            client::client_cb&& cb)
+            completion_handler&& cb, std::shared_ptr<client::response_handler> stream = nullptr,
+            const std::shared_ptr<request_handle>& handle = nullptr)
     {
         // Create a request context to pass on each callback
-        auto req_ctx = request_context::Create(_ioc, std::move(req), url, d, std::move(cb));
+        auto req_ctx = request_context::Create(_ioc, std::move(req), url, d, std::move(cb), std::move(stream));
+        req_ctx->handle = handle;
 
         run(req_ctx);
+
+        if (handle) {
+            handle->on_cancel([weak = this->weak_from_this(), weak_ctx = std::weak_ptr<request_context>(req_ctx)] {
+                auto me = weak.lock();
+                auto req_ctx = weak_ctx.lock();
+                if (me && req_ctx) {
+                    me->cancel(req_ctx);
+                }
+            });
+        }
     }
 
-    // Start the asynchronous request
+    // Start the asynchronous request: queued from any thread, and taken on the
+    // strand, which alone owns the state of the connection
     void run(std::shared_ptr<request_context> req_ctx)
+    {
+        if (_submitted.push(std::move(req_ctx))) {
+            asio::post(_strand, [me = this->shared_from_this()] {
+                me->with_callbacks([&] {
+                    me->_submitted.drain([&](std::shared_ptr<request_context>&& req_ctx) { me->start(req_ctx); });
+                });
+            });
+        }
+    }
+
+    // Requests the connection can take at the same time: the streams of a
+    // HTTP/2 connection, one for HTTP/1.1, none while connecting. As of the
+    // last step on the strand
+    std::size_t capacity() const
+    {
+        return _capacity.load(std::memory_order_acquire);
+    }
+
+    // Called once a connection is made, and the protocol known
+    void on_connected(std::function<void()> handler)
+    {
+        asio::dispatch(_strand, [me = this->shared_from_this(), handler = std::move(handler)]() mutable {
+            me->_on_connected = std::move(handler);
+        });
+    }
+
+    // Called with the requests which cannot be sent on this connection, else
+    // they fail with connection_aborted
+    void on_unsent(unsent_handler handler)
+    {
+        asio::dispatch(_strand, [me = this->shared_from_this(), handler = std::move(handler)]() mutable {
+            me->_on_unsent = std::move(handler);
+        });
+    }
+
+    // The request is abandoned, as on its timeout but with operation_aborted
+    void cancel(const std::shared_ptr<request_context>& req_ctx)
+    {
+        asio::dispatch(_strand, [me = this->shared_from_this(), req_ctx] {
+            me->with_callbacks([&] { me->abandon(req_ctx, asio::error::operation_aborted); });
+        });
+    }
+
+    // Close the connection, the requests still in flight are aborted
+    void close()
+    {
+        asio::dispatch(_strand, [me = this->shared_from_this()] {
+            me->with_callbacks([&] {
+                me->_http2.reset();
+                me->_connecting = false;
+                me->_pending_request = false;
+                boost::system::error_code ec;
+                me->socket().close(ec);
+            });
+        });
+    }
+
+private:
+    void start(const std::shared_ptr<request_context>& req_ctx)
     {
         if (req_ctx->timer.expiry() != asio::steady_timer::time_point()) {
             req_ctx->timer.async_wait(
-                [me = this->shared_from_this(), req_ctx](const boost::system::error_code& ec) {
-                    me->on_timer(ec, req_ctx);
-                });
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this(), req_ctx](const boost::system::error_code& ec) {
+                        me->on_timer(ec, req_ctx);
+                    }));
         }
 
-        std::lock_guard guard{_requests_mtx};
         bool connection_required = false;
         if constexpr(SSL) {
             //std::cout << "session_client:" << __LINE__ << " : Connection required ? " << _requests.empty() << " && " << !_stream.next_layer().is_open() << std::endl;
@@ -151,6 +375,14 @@ public:
         //std::cout << "session_client:" << __LINE__ << " : Start a request, with new connection: " << connection_required << std::endl;
         _requests.push_back(req_ctx);
 
+        if (_http2) {
+            // A new stream on the current HTTP/2 connection
+            h2_open_streams();
+            h2_send();
+            h2_write();
+            return h2_read();
+        }
+
         if (connection_required) {
             do_resolve();
         }
@@ -163,6 +395,8 @@ public:
         }
     }
 
+public:
+
     void do_resolve()
     {
         //std::cout << "session_client:" << __LINE__ << " : Try to resolve the host" << std::endl;
@@ -175,11 +409,17 @@ public:
             {
                 boost::system::error_code ec{static_cast<int>(::ERR_get_error()),
                                              boost::asio::error::get_ssl_category()};
-                return fail(**_requests.begin(), ec, "set_tlsext_hostname");
+                return fail_all(ec);
+            }
+
+            if (_settings.http2) {
+                static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+                SSL_set_alpn_protos(_stream.native_handle(), protocols, sizeof(protocols) - 1);
             }
         }
 #endif
         _pending_request = true;
+        _connecting = true;
 
         // Get port or the default one
         auto port_view = (*_requests.begin())->url.port_view();
@@ -192,23 +432,22 @@ public:
             }
         }
 
-        // Look up the domain name
-        _resolver.async_resolve(
+        // Look up the domain name, or take the addresses in the cache
+        resolver_cache::Instance().async_resolve(
+                _strand,
                 (*_requests.begin())->url.host(),
-                port_view,
+                std::string(port_view),
                 [me = this->shared_from_this()](const boost::system::error_code& ec,
-                                                const asio::ip::tcp::resolver::results_type& results) {
-                    me->on_resolve(ec, results);
+                                                const resolver_cache::endpoints& addresses) {
+                    me->on_resolve(ec, addresses);
                 });
     }
 
-    void on_resolve(const boost::system::error_code& ec,
-            const asio::ip::tcp::resolver::results_type& results)
+    void on_resolve(const boost::system::error_code& ec, const resolver_cache::endpoints& addresses)
     {
         //std::cout << "session_client:" << __LINE__ << " : on_resolve" << std::endl;
         if (ec) {
-            std::lock_guard guard{_requests_mtx};
-            return fail(**_requests.begin(), ec, "resolve");
+            return with_callbacks([&] { fail_all(ec); });
         }
 
         // Make the connection on the IP address we get from a lookup
@@ -217,12 +456,12 @@ public:
             //std::cout << "session_client:" << __LINE__ << " : Try a ssl connection" << std::endl;
             asio::async_connect(
                 _stream.next_layer(),
-                results.begin(),
-                results.end(),
-                [me = this->shared_from_this()](const boost::system::error_code& ec,
-                        const asio::ip::tcp::resolver::iterator& it) {
-                    me->on_connect(ec);
-                }
+                addresses,
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this()](const boost::system::error_code& ec,
+                            const asio::ip::tcp::endpoint&) {
+                        me->on_connect(ec);
+                    })
             );
 #endif
         }
@@ -230,12 +469,12 @@ public:
             //std::cout << "session_client:" << __LINE__ << " : Try a connection" << std::endl;
             asio::async_connect(
                 _socket,
-                results.begin(),
-                results.end(),
-                [me = this->shared_from_this()](const boost::system::error_code& ec,
-                        const asio::ip::tcp::resolver::iterator& it) {
-                    me->on_connect(ec);
-                }
+                addresses,
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this()](const boost::system::error_code& ec,
+                            const asio::ip::tcp::endpoint&) {
+                        me->on_connect(ec);
+                    })
             );
         }
     }
@@ -245,12 +484,7 @@ public:
     {
         //std::cout << "session_client:" << __LINE__ << " : on_connect" << std::endl;
         if (ec) {
-            std::lock_guard guard{_requests_mtx};
-
-            auto req_ctx = *_requests.begin();
-            req_ctx->timer.cancel(); // will call on_timer with operator_cancelled
-
-            return fail(**_requests.begin(), ec, "connect");
+            return with_callbacks([&] { fail_all(ec); });
         }
 
         if constexpr(SSL) {
@@ -258,33 +492,53 @@ public:
             // Perform the SSL handshake
             _stream.async_handshake(
                 asio::ssl::stream_base::client,
-                [me = this->shared_from_this()](boost::system::error_code ec) {
-                    me->on_handshake(ec);
-                });
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this()](boost::system::error_code ec) {
+                        me->on_handshake(ec);
+                    }));
 #endif
         }
         else {
-            std::lock_guard guard{_requests_mtx};
-            do_write();
+            with_callbacks([&] {
+                _connecting = false;
+                if (_settings.http2 && !_http1_only) {
+                    // Prior knowledge, HTTP/1.1 again if the server does not answer the preface
+                    return h2_start();
+                }
+                _protocol_known = true;
+                do_write();
+            });
         }
     }
 
     void
     on_handshake(boost::system::error_code ec) {
         if(ec) {
-            std::lock_guard guard{_requests_mtx};
-            return fail(**_requests.begin(), ec, "handshake");
+            return with_callbacks([&] { fail_all(ec); });
         }
 
-        std::lock_guard guard{_requests_mtx};
-        do_write();
+        with_callbacks([&] {
+            _connecting = false;
+#if BEAUTY_ENABLE_OPENSSL
+            if constexpr(SSL) {
+                const unsigned char* protocol = nullptr;
+                unsigned int length = 0;
+                SSL_get0_alpn_selected(_stream.native_handle(), &protocol, &length);
+                if (std::string_view(reinterpret_cast<const char*>(protocol), length) == "h2") {
+                    return h2_start();
+                }
+            }
+#endif
+            _protocol_known = true;
+            do_write();
+        });
     }
 
     void
     do_write() {
         //std::cout << "session_client:" << __LINE__ << " :do write" << std::endl;
 
-        // No lock here, done before the call of do_write
+        // On the strand, as all the calls of do_write
         if (_requests.empty()) {
             //std::cout << "session_client:" << __LINE__ << " : ... nothing to do" << std::endl;
             _pending_request = false;
@@ -298,115 +552,1182 @@ public:
        if constexpr(SSL) {
            beast::http::async_write(_stream, (*_requests.begin())->request,
                asio::bind_executor(_strand,
-                       [me = this->shared_from_this()](boost::system::error_code ec,
+                       [me = this->shared_from_this(), req_ctx = *_requests.begin()](boost::system::error_code ec,
                                std::size_t bytes_transferred) {
-                           me->on_write(ec, bytes_transferred);
+                           me->on_write(req_ctx, ec, bytes_transferred);
                         })
             );
        }
        else {
            beast::http::async_write(_socket, (*_requests.begin())->request,
                asio::bind_executor(_strand,
-                       [me = this->shared_from_this()](boost::system::error_code ec,
+                       [me = this->shared_from_this(), req_ctx = *_requests.begin()](boost::system::error_code ec,
                                std::size_t bytes_transferred) {
-                           me->on_write(ec, bytes_transferred);
+                           me->on_write(req_ctx, ec, bytes_transferred);
                         })
             );
        }
     }
 
     void
-    on_write(boost::system::error_code ec, std::size_t)
+    on_write(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec, std::size_t)
     {
         //std::cout << "session_client:" << __LINE__ << " : on_write" << std::endl;
-        std::lock_guard guard{_requests_mtx};
+        with_callbacks([&] {
+            if (!current(req_ctx)) {
+                return; // Timed out, the connection closed
+            }
+            if (ec) {
+                return fail_first(ec);
+            }
+
+            if (req_ctx->stream) {
+                return do_read_stream_header(req_ctx);
+            }
+
+            // Receive the HTTP response
+            if constexpr(SSL) {
+                beast::http::async_read(_stream, _buffer, req_ctx->response,
+                        asio::bind_executor(_strand,
+                            [me = this->shared_from_this(), req_ctx](boost::system::error_code ec,
+                                    std::size_t bytes_transferred) {
+                        me->on_read(req_ctx, ec);
+                    })
+                );
+            }
+            else {
+                beast::http::async_read(_socket, _buffer, req_ctx->response,
+                        asio::bind_executor(_strand,
+                            [me = this->shared_from_this(), req_ctx](boost::system::error_code ec,
+                                    std::size_t bytes_transferred) {
+                        me->on_read(req_ctx, ec);
+                    })
+                );
+            }
+        });
+    }
+
+    void
+    on_read(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec)
+    {
+        //std::cout << "session_client:" << __LINE__ << " : on_read" << std::endl;
+        with_callbacks([&] {
+            if (!current(req_ctx)) {
+                return; // Timed out, the connection closed
+            }
+
+            if (ec) {
+                if (ec == beauty::http::error::end_of_stream) {
+                    // This is the only way to get an error on connection close from server
+                    // Like a keep alive which was closed
+                    //std::cout << "session_client:" << __LINE__ << " : on_read - end of stream detected, trying to reconnect" << std::endl;
+
+                    // Try to reconnect
+                    return do_resolve();
+                }
+                return fail_first(ec);
+            }
+
+            _requests.pop_front();
+            _pending_request = false;
+            complete(req_ctx, ec);
+
+            do_write();
+        });
+    }
+
+    // ------------------------------------------------------------------------
+    // HTTP/1.1 streamed response body: read by chunks, the next one once the
+    // handler resumes
+    // ------------------------------------------------------------------------
+    void do_read_stream_header(const std::shared_ptr<request_context>& req_ctx)
+    {
+        req_ctx->chunk_parser.emplace();
+        // No limit, the body is not kept (boost::none is refused by the Content-Length check of Beast 1.74)
+        req_ctx->chunk_parser->body_limit(std::numeric_limits<std::uint64_t>::max());
+
+        beast::http::async_read_header(stream(), _buffer, *req_ctx->chunk_parser,
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this(), req_ctx](boost::system::error_code ec, std::size_t) {
+                        me->on_read_stream_header(req_ctx, ec);
+                    }));
+    }
+
+    void on_read_stream_header(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec)
+    {
+        if (!current(req_ctx)) {
+            return; // Timed out, the connection closed
+        }
 
         if (ec) {
-            return fail(**_requests.begin(), ec, "write");
+            return with_callbacks([&] {
+                if (ec == beauty::http::error::end_of_stream) {
+                    // Keep alive closed by the server, sent again on a new connection
+                    return do_resolve();
+                }
+                fail_first(ec);
+            });
         }
 
-        // Receive the HTTP response
-        if constexpr(SSL) {
-            beast::http::async_read(_stream, _buffer, (*_requests.begin())->response,
-                    asio::bind_executor(_strand,
-                        [me = this->shared_from_this()](boost::system::error_code ec,
-                                std::size_t bytes_transferred) {
-                    me->on_read(ec);
-                })
-            );
+        // The header only, the body is given to the handler
+        auto& header = req_ctx->response.get();
+        header.base() = req_ctx->chunk_parser->get().base();
+        if (!req_ctx->too_late) {
+            beauty::response res;
+            res = header;
+            req_ctx->stream->on_header(res);
         }
-        else {
-            beast::http::async_read(_socket, _buffer, (*_requests.begin())->response,
-                    asio::bind_executor(_strand,
-                        [me = this->shared_from_this()](boost::system::error_code ec,
-                                std::size_t bytes_transferred) {
-                    me->on_read(ec);
-                })
-            );
+
+        req_ctx->chunk.resize(READ_SIZE);
+        do_read_chunk(req_ctx);
+    }
+
+    void do_read_chunk(const std::shared_ptr<request_context>& req_ctx)
+    {
+        auto& body = req_ctx->chunk_parser->get().body();
+        body.data = req_ctx->chunk.data();
+        body.size = req_ctx->chunk.size();
+
+        if (req_ctx->chunk_parser->is_done()) {
+            return on_read_chunk(req_ctx, {});
         }
+
+        beast::http::async_read(stream(), _buffer, *req_ctx->chunk_parser,
+                asio::bind_executor(_strand,
+                    [me = this->shared_from_this(), req_ctx](boost::system::error_code ec, std::size_t) {
+                        me->on_read_chunk(req_ctx, ec);
+                    }));
+    }
+
+    void on_read_chunk(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec)
+    {
+        if (!current(req_ctx)) {
+            return; // Timed out, the rest of the body is not read
+        }
+
+        // The chunk buffer is full, not an error
+        if (ec == beast::http::error::need_buffer) {
+            ec = {};
+        }
+        if (ec) {
+            return with_callbacks([&] { fail_first(ec); });
+        }
+
+        auto size = req_ctx->chunk.size() - req_ctx->chunk_parser->get().body().size;
+        if (size) {
+            return req_ctx->stream->on_chunk(req_ctx->chunk.data(), size,
+                    [me = this->shared_from_this(), req_ctx] {
+                        asio::post(me->_strand, [me, req_ctx] { me->do_read_chunk(req_ctx); });
+                    });
+        }
+
+        if (!req_ctx->chunk_parser->is_done()) {
+            return do_read_chunk(req_ctx);
+        }
+
+        with_callbacks([&] {
+            req_ctx->chunk_parser.reset();
+            _requests.pop_front();
+            _pending_request = false;
+            complete(req_ctx, ec);
+
+            do_write();
+        });
     }
 
     void
-    on_read(boost::system::error_code ec)
+    on_timer(boost::system::error_code ec, std::shared_ptr<request_context> req_ctx)
     {
-        //std::cout << "session_client:" << __LINE__ << " : on_read" << std::endl;
+        //std::cout << "session_client:" << __LINE__ << " : on_timer" << std::endl;
+        if (ec || req_ctx->too_late) {
+            return;
+        }
+
+        const auto timeout = boost::system::error_code(boost::system::errc::timed_out,
+                boost::system::system_category());
+        if (!req_ctx->cb) {
+            // Synchronous request, its event loop ends with the exception
+            req_ctx->too_late = true;
+            return fail(*req_ctx, timeout, "timeout");
+        }
 
-        std::lock_guard guard{_requests_mtx};
-        auto req_ctx = *_requests.begin();
+        with_callbacks([&] { abandon(req_ctx, timeout); });
+    }
 
-        if (ec) {
-            if (ec == beauty::http::error::end_of_stream) {
-                // This is the only way to get an error on connection close from server
-                // Like a keep alive which was closed
-                //std::cout << "session_client:" << __LINE__ << " : on_read - end of stream detected, trying to reconnect" << std::endl;
+    // On the strand, the request is dropped wherever it is, false if already
+    // completed. A HTTP/2 stream is reset and the other streams go on. A
+    // HTTP/1.1 connection writing or reading it is closed, as its response
+    // may still come: the requests behind are sent on a new connection, or
+    // over TLS (the stream cannot be reused) given back to be sent on another
+    // pooled connection, whatever their method.
+    bool abandon(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec)
+    {
+        auto found = std::find(_requests.begin(), _requests.end(), req_ctx);
+        if (_http2) {
+            if (!h2_cancel(*req_ctx)) {
+                return false;
+            }
+            if (found != _requests.end()) {
+                _requests.erase(found);
+            }
+        }
+        else if (found == _requests.end()) {
+            return false;
+        }
+        else if (found != _requests.begin() || _connecting) {
+            _requests.erase(found); // Not sent yet
+        }
+        else {
+            _requests.pop_front();
+            _aborted = true;
+            _pending_request = false;
+            boost::system::error_code ignored;
+            socket().close(ignored);
+            _buffer.consume(_buffer.size());
 
-                // Try to reconnect
+            if constexpr(SSL) {
+                for (const auto& next : _requests) {
+                    give_back(next);
+                }
+                _requests.clear();
+            }
+            else if (!_requests.empty()) {
                 do_resolve();
+            }
+        }
 
-                return;
+        complete(req_ctx, ec);
+        return true;
+    }
+
+    // A request never written, sent on another connection after the step
+    void give_back(const std::shared_ptr<request_context>& req_ctx)
+    {
+        if (!_on_unsent || !req_ctx->cb) {
+            return complete(req_ctx, asio::error::connection_aborted);
+        }
+
+        req_ctx->timer.cancel();
+        req_ctx->too_late = true;
+
+        unsent_request unsent;
+        if (req_ctx->timer.expiry() != asio::steady_timer::time_point()) {
+            unsent.timeout = std::max<beauty::duration>(req_ctx->timer.expiry() - asio::steady_timer::clock_type::now(),
+                    std::chrono::milliseconds(1));
+        }
+        unsent.request = std::move(req_ctx->request);
+        unsent.url = std::move(req_ctx->url);
+        unsent.cb = std::move(req_ctx->cb);
+        unsent.stream = std::move(req_ctx->stream);
+        unsent.handle = std::move(req_ctx->handle);
+        req_ctx->cb = nullptr;
+
+        // Shared, a deferred call is copyable and the callback is move only
+        _deferred.push_back([handler = _on_unsent, unsent = std::make_shared<unsent_request>(std::move(unsent))] {
+            handler(std::move(*unsent));
+        });
+    }
+
+    // On the strand, false if the request was abandoned meanwhile: the
+    // handlers of its connection are called, with an error or not
+    bool current(const std::shared_ptr<request_context>& req_ctx) const
+    {
+        return (!_requests.empty() && _requests.front() == req_ctx);
+    }
+
+    beauty::response& response() { return _response; }
+
+private:
+    // ------------------------------------------------------------------------
+    // HTTP/2: the requests are multiplexed as streams on the connection
+    // ------------------------------------------------------------------------
+    void h2_start()
+    {
+        _pending_request = false;
+        _http2 = std::make_shared<http2_connection>();
+
+        // Small frames are not delayed, the requests are already gathered
+        boost::system::error_code ec;
+        socket().set_option(asio::ip::tcp::no_delay(true), ec);
+
+        // No server push, a larger window for the responses
+        std::string frame(http2::client_preface);
+        http2::append_frame_header(frame, 2 * 6, http2::frame_type::settings, 0, 0);
+        http2::append_setting(frame, http2::setting::enable_push, 0);
+        http2::append_setting(frame, http2::setting::initial_window_size, WINDOW_SIZE);
+        http2::append_frame_header(frame, 4, http2::frame_type::window_update, 0, 0);
+        http2::append_uint32(frame, WINDOW_SIZE - http2::default_window_size);
+        _http2->out.push_back({std::move(frame)});
+
+        h2_open_streams();
+        h2_send();
+        h2_write();
+        h2_read();
+    }
+
+    // Waiting requests sent, within the streams allowed by the server
+    void h2_open_streams()
+    {
+        auto& conn = *_http2;
+        while (!conn.goaway && !_requests.empty() && conn.streams.size() < conn.max_streams) {
+            auto req_ctx = _requests.front();
+            _requests.pop_front();
+            if (req_ctx->too_late) {
+                continue;
+            }
+
+            const auto id = conn.next_id;
+            conn.next_id += 2;
+            if (conn.next_id > http2::max_window_size) {
+                conn.goaway = true; // Stream identifiers exhausted, a new connection will be made
+            }
+
+            req_ctx->stream_id = id;
+            req_ctx->send_window = conn.peer_initial_window;
+            req_ctx->recv_window = WINDOW_SIZE;
+            req_ctx->sent = 0;
+            conn.streams[id] = req_ctx;
+
+            auto& req = req_ctx->request;
+            auto target = view(req.target());
+            std::string block;
+            hpack::encode(block, ":method", view(req.method_string()));
+            hpack::encode(block, ":scheme", SSL ? "https" : "http");
+            hpack::encode(block, ":authority", view(req[beast::http::field::host]));
+            hpack::encode(block, ":path", target.empty() ? "/" : target);
+            for (const auto& field : req) {
+                auto name = field.name();
+                if (name == beast::http::field::host || name == beast::http::field::connection
+                        || name == beast::http::field::keep_alive || name == beast::http::field::proxy_connection
+                        || name == beast::http::field::transfer_encoding || name == beast::http::field::upgrade
+                        || name == beast::http::field::te) {
+                    continue; // Connection-specific fields are not allowed
+                }
+                hpack::encode(block, view(field.name_string()), view(field.value()));
+            }
+
+            // Split in CONTINUATION frames above the frame size of the server
+            std::string frame;
+            std::string_view rest = block;
+            bool first = true;
+            do {
+                auto size = std::min<std::size_t>(rest.size(), conn.peer_max_frame_size);
+                std::uint8_t flags = (size == rest.size() ? http2::flags::end_headers : 0);
+                if (first && req.body().empty()) {
+                    flags |= http2::flags::end_stream;
+                }
+                http2::append_frame_header(frame,
+                        size, (first ? http2::frame_type::headers : http2::frame_type::continuation), flags, id);
+                frame.append(rest.substr(0, size));
+                rest.remove_prefix(size);
+                first = false;
+            } while (!rest.empty());
+
+            conn.out.push_back({std::move(frame)});
+        }
+    }
+
+    // Queue the request bodies DATA frames allowed by the flow control, the streams in turn
+    void h2_send()
+    {
+        auto& conn = *_http2;
+        auto sendable = [](const request_context& req_ctx) {
+            return req_ctx.sent < req_ctx.request.body().size() && req_ctx.send_window > 0;
+        };
+
+        while (conn.send_window > 0 && conn.queued < WRITE_HIGH_WATER) {
+            auto it = conn.streams.upper_bound(conn.last_sent_id);
+            while (it != conn.streams.end() && !sendable(*it->second)) ++it;
+            if (it == conn.streams.end()) {
+                it = conn.streams.begin();
+                while (it != conn.streams.end() && it->first <= conn.last_sent_id && !sendable(*it->second)) ++it;
+                if (it == conn.streams.end() || !sendable(*it->second)) {
+                    break;
+                }
+            }
+
+            auto& req_ctx = it->second;
+            conn.last_sent_id = it->first;
+
+            const auto& body = req_ctx->request.body();
+            auto size = static_cast<std::size_t>(std::min<std::int64_t>({
+                    static_cast<std::int64_t>(body.size() - req_ctx->sent), conn.peer_max_frame_size,
+                    conn.send_window, req_ctx->send_window}));
+            const bool last = (req_ctx->sent + size == body.size());
+
+            outgoing frame;
+            http2::append_frame_header(frame.bytes, size, http2::frame_type::data,
+                    (last ? http2::flags::end_stream : 0), it->first);
+            frame.payload = asio::buffer(body.data() + req_ctx->sent, size);
+            frame.keep = req_ctx;
+
+            req_ctx->sent += size;
+            req_ctx->send_window -= size;
+            conn.send_window -= size;
+            conn.queued += size;
+            conn.out.push_back(std::move(frame));
+        }
+    }
+
+    void h2_write()
+    {
+        auto conn = _http2;
+        if (!conn || conn->writing || conn->out.empty()) {
+            return;
+        }
+
+        conn->writing = true;
+        std::swap(conn->out, conn->in_flight);
+        conn->write_buffers.clear();
+        conn->write_data.clear();
+        for (const auto& frame : conn->in_flight) {
+            if constexpr(!SSL) {
+                conn->write_buffers.push_back(asio::buffer(frame.bytes));
+                if (frame.payload.size()) {
+                    conn->write_buffers.push_back(frame.payload);
+                }
+            } else {
+                // A TLS record for each buffer otherwise, the frames are copied in one
+                conn->write_data.append(frame.bytes);
+                conn->write_data.append(static_cast<const char*>(frame.payload.data()), frame.payload.size());
+            }
+        }
+        if (!conn->write_data.empty()) {
+            conn->write_buffers.push_back(asio::buffer(conn->write_data));
+        }
+        conn->queued = 0;
+
+        asio::async_write(stream(), beast::buffers_range_ref(conn->write_buffers),
+            asio::bind_executor(_strand,
+                    [me = this->shared_from_this(), conn](boost::system::error_code ec, std::size_t) {
+                        me->on_h2_write(conn, ec);
+                    }));
+    }
+
+    void on_h2_write(const std::shared_ptr<http2_connection>& conn, boost::system::error_code ec)
+    {
+        with_callbacks([&] {
+            if (conn != _http2) {
+                return; // Closed meanwhile
+            }
+
+            conn->writing = false;
+            conn->in_flight.clear();
+
+            if (ec) {
+                h2_close(ec);
+            }
+            else if (conn->error && conn->out.empty()) {
+                h2_close(conn->error); // GOAWAY sent
             }
             else {
-                return fail(**_requests.begin(), ec, "read");
+                if (!conn->error) {
+                    h2_send();
+                }
+                h2_write();
             }
+        });
+    }
+
+    // Reading while streams are open, the server preface is expected first
+    void h2_read()
+    {
+        auto conn = _http2;
+        if (!conn || conn->reading || conn->error
+                || (conn->settings_received && conn->streams.empty())) {
+            return;
         }
 
-        _requests.pop_front();
-        _pending_request = false;
+        conn->reading = true;
+        stream().async_read_some(conn->buffer.prepare(READ_SIZE),
+            asio::bind_executor(_strand,
+                    [me = this->shared_from_this(), conn](boost::system::error_code ec, std::size_t bytes_transferred) {
+                        me->on_h2_read(conn, ec, bytes_transferred);
+                    }));
+    }
+
+    void on_h2_read(const std::shared_ptr<http2_connection>& conn,
+            boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        with_callbacks([&] {
+            if (conn != _http2) {
+                return; // Closed meanwhile
+            }
+            conn->reading = false;
+
+            if (ec) {
+                h2_close(ec);
+            }
+            else {
+                conn->buffer.commit(bytes_transferred);
+                h2_process();
+
+                if (_http2 == conn) {
+                    if (conn->goaway && conn->streams.empty() && !conn->error) {
+                        h2_close(asio::error::connection_reset);
+                    } else {
+                        h2_open_streams();
+                        h2_send();
+                        h2_write();
+                        h2_read();
+                    }
+                }
+            }
+        });
+    }
+
+    // Handle the complete frames read
+    void h2_process()
+    {
+        auto conn = _http2;
+        while (!conn->error && _http2 == conn && conn->buffer.size() >= http2::frame_header_size) {
+            const auto* p = static_cast<const std::uint8_t*>(conn->buffer.data().data());
+            const std::size_t length = (std::size_t(p[0]) << 16) | (std::size_t(p[1]) << 8) | p[2];
+            const auto type = static_cast<http2::frame_type>(p[3]);
+            const std::uint8_t flags = p[4];
+            const std::uint32_t id = http2::read_uint32(p + 5) & 0x7fffffff;
+
+            // The server preface is a SETTINGS frame, not an HTTP/1.1 response
+            if (!conn->settings_received && type != http2::frame_type::settings) {
+                return h2_close(beast::http::error::bad_version);
+            }
+            if (length > http2::default_max_frame_size) {
+                return h2_connection_error(http2::error_code::frame_size_error);
+            }
+            if (conn->buffer.size() < http2::frame_header_size + length) {
+                return;
+            }
+
+            h2_frame(type, flags, id, p + http2::frame_header_size, length);
+            conn->buffer.consume(http2::frame_header_size + length);
+        }
+    }
+
+    void h2_frame(http2::frame_type type, std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+
+        // A header block is not interrupted
+        if (conn.continuation_id && (type != http2::frame_type::continuation || id != conn.continuation_id)) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+
+        switch(type) {
+            case http2::frame_type::data:           return h2_data(flags, id, payload, length);
+            case http2::frame_type::headers:        return h2_headers(flags, id, payload, length);
+            case http2::frame_type::continuation:   return h2_continuation(flags, id, payload, length);
+            case http2::frame_type::rst_stream:     return h2_rst_stream(id, payload, length);
+            case http2::frame_type::settings:       return h2_settings(flags, id, payload, length);
+            case http2::frame_type::ping:           return h2_ping(flags, id, payload, length);
+            case http2::frame_type::goaway:         return h2_goaway(id, payload, length);
+            case http2::frame_type::window_update:  return h2_window_update(id, payload, length);
+            case http2::frame_type::push_promise:   return h2_connection_error(http2::error_code::protocol_error);
+            default:
+                return; // Priorities and unknown frames are ignored
+        }
+    }
+
+    void h2_headers(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (id == 0 || !http2::unpad(flags, payload, length)) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+        if (flags & http2::flags::priority) {
+            if (length < 5) {
+                return h2_connection_error(http2::error_code::frame_size_error);
+            }
+            payload += 5;
+            length -= 5;
+        }
+
+        conn.header_block.assign(reinterpret_cast<const char*>(payload), length);
+        if (flags & http2::flags::end_headers) {
+            return h2_header_block(flags, id);
+        }
+        conn.continuation_id = id;
+        conn.continuation_flags = flags;
+    }
+
+    void h2_continuation(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (!conn.continuation_id) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+        if (conn.header_block.size() + length > HEADER_BLOCK_LIMIT) {
+            return h2_connection_error(http2::error_code::enhance_your_calm);
+        }
+
+        conn.header_block.append(reinterpret_cast<const char*>(payload), length);
+        if (flags & http2::flags::end_headers) {
+            conn.continuation_id = 0;
+            h2_header_block(conn.continuation_flags, id);
+        }
+    }
+
+    void h2_header_block(std::uint8_t flags, std::uint32_t id)
+    {
+        auto& conn = *_http2;
+
+        // Always decoded, the dynamic table is shared by the streams
+        conn.fields.clear();
+        if (!conn.decoder.decode(reinterpret_cast<const std::uint8_t*>(conn.header_block.data()),
+                    conn.header_block.size(), conn.fields)) {
+            return h2_connection_error(http2::error_code::compression_error);
+        }
+
+        auto found = conn.streams.find(id);
+        if (found == conn.streams.end()) {
+            return; // Reset meanwhile
+        }
+        auto req_ctx = found->second;
+        auto& res = req_ctx->response.get();
+
+        if (req_ctx->responded) {
+            // Trailer fields, ending the stream
+            if (!(flags & http2::flags::end_stream)) {
+                return h2_stream_error(id, http2::error_code::protocol_error);
+            }
+            for (const auto& f : conn.fields) {
+                if (!f.name.empty() && f.name[0] != ':') {
+                    res.insert(f.name, f.value);
+                }
+            }
+            return h2_end_stream(id);
+        }
+
+        int status = 0;
+        for (const auto& f : conn.fields) {
+            if (f.name == ":status") {
+                status = std::atoi(f.value.c_str());
+            }
+        }
+        if (status < 100 || status > 999) {
+            return h2_stream_error(id, http2::error_code::protocol_error);
+        }
+        if (status < 200) {
+            return; // Informational response, the final one follows
+        }
+
+        res.result(status);
+        res.version(20);
+        for (const auto& f : conn.fields) {
+            if (!f.name.empty() && f.name[0] != ':') {
+                res.insert(f.name, f.value);
+            }
+        }
+        req_ctx->responded = true;
+
+        if (req_ctx->stream) {
+            beauty::response header;
+            header = res;
+            _deferred.push_back([req_ctx, header = std::move(header)] {
+                if (!req_ctx->too_late) {
+                    req_ctx->stream->on_header(header);
+                }
+            });
+        }
+
+        if (flags & http2::flags::end_stream) {
+            h2_end_stream(id);
+        }
+    }
+
+    void h2_data(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (id == 0) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+
+        // The whole frame counts for the flow control, padding included
+        if (static_cast<std::int64_t>(length) > conn.recv_window) {
+            return h2_connection_error(http2::error_code::flow_control_error);
+        }
+        conn.recv_window -= length;
+        if (WINDOW_SIZE - conn.recv_window >= WINDOW_SIZE / 2) {
+            h2_window_update_frame(0, static_cast<std::uint32_t>(WINDOW_SIZE - conn.recv_window));
+            conn.recv_window = WINDOW_SIZE;
+        }
+
+        auto found = conn.streams.find(id);
+        if (found == conn.streams.end()) {
+            return; // Reset meanwhile
+        }
+        auto& req_ctx = *found->second;
+        if (!req_ctx.responded || static_cast<std::int64_t>(length) > req_ctx.recv_window) {
+            return h2_stream_error(id, http2::error_code::protocol_error);
+        }
+        req_ctx.recv_window -= length;
+
+        if (!http2::unpad(flags, payload, length)) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+
+        if (req_ctx.stream) {
+            // Given to the handler, the window is given back once it resumes
+            req_ctx.pending.append(reinterpret_cast<const char*>(payload), length);
+            if (flags & http2::flags::end_stream) {
+                h2_end_stream(id);
+            } else if (!req_ctx.delivering) {
+                h2_deliver(found->second);
+            }
+            return;
+        }
+
+        auto& body = req_ctx.response.get().body();
+        if (body.size() + length > BODY_LIMIT) {
+            return h2_stream_error(id, http2::error_code::cancel, beast::http::error::body_limit);
+        }
+        body.append(reinterpret_cast<const char*>(payload), length);
+
+        if (flags & http2::flags::end_stream) {
+            return h2_end_stream(id);
+        }
+
+        // Consumed at once, the window is given back by halves
+        if (WINDOW_SIZE - req_ctx.recv_window >= WINDOW_SIZE / 2) {
+            h2_window_update_frame(id, static_cast<std::uint32_t>(WINDOW_SIZE - req_ctx.recv_window));
+            req_ctx.recv_window = WINDOW_SIZE;
+        }
+    }
+
+    // The response is complete, a request body still being sent is not needed anymore
+    void h2_end_stream(std::uint32_t id)
+    {
+        auto& conn = *_http2;
+        auto found = conn.streams.find(id);
+        auto req_ctx = found->second;
+        if (req_ctx->sent < req_ctx->request.body().size()) {
+            h2_rst_stream_frame(id, http2::error_code::no_error);
+        }
+        conn.streams.erase(found);
+
+        if (req_ctx->stream) {
+            // Completed once the handler has all the body
+            req_ctx->ended = true;
+            if (!req_ctx->delivering) {
+                h2_deliver(req_ctx);
+            }
+            return;
+        }
+        complete(req_ctx, {});
+    }
+
+    // The data received given to the handler, once the step is done
+    void h2_deliver(const std::shared_ptr<request_context>& req_ctx)
+    {
+        if (req_ctx->completed) {
+            return;
+        }
+        if (req_ctx->too_late) {
+            req_ctx->pending.clear(); // Timed out, not wanted anymore
+        }
+        if (req_ctx->pending.empty()) {
+            if (req_ctx->ended) {
+                complete(req_ctx, {});
+            }
+            return;
+        }
+
+        req_ctx->delivering = true;
+        req_ctx->chunk.swap(req_ctx->pending);
+        req_ctx->pending.clear();
+
+        _deferred.push_back([me = this->shared_from_this(), req_ctx] {
+            req_ctx->stream->on_chunk(req_ctx->chunk.data(), req_ctx->chunk.size(),
+                    [me, req_ctx] {
+                        asio::post(me->_strand, [me, req_ctx] { me->h2_resume(req_ctx); });
+                    });
+        });
+    }
+
+    void h2_resume(const std::shared_ptr<request_context>& req_ctx)
+    {
+        with_callbacks([&] {
+            req_ctx->delivering = false;
+
+            // The stream window given back by halves, as the data is consumed
+            if (_http2 && !req_ctx->ended && _http2->streams.count(req_ctx->stream_id)
+                    && WINDOW_SIZE - req_ctx->recv_window >= WINDOW_SIZE / 2) {
+                h2_window_update_frame(req_ctx->stream_id,
+                        static_cast<std::uint32_t>(WINDOW_SIZE - req_ctx->recv_window));
+                req_ctx->recv_window = WINDOW_SIZE;
+                h2_write();
+            }
+
+            h2_deliver(req_ctx);
+        });
+    }
+
+    void h2_rst_stream(std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (id == 0) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+        if (length != 4) {
+            return h2_connection_error(http2::error_code::frame_size_error);
+        }
+
+        auto found = conn.streams.find(id);
+        if (found == conn.streams.end()) {
+            return;
+        }
+        auto req_ctx = found->second;
+        conn.streams.erase(found);
+
+        // Not processed by the server, sent again once a stream is available
+        if (static_cast<http2::error_code>(http2::read_uint32(payload)) == http2::error_code::refused_stream
+                && !req_ctx->responded) {
+            _requests.push_front(req_ctx);
+            return;
+        }
+        complete(req_ctx, asio::error::connection_reset);
+    }
+
+    void h2_settings(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (id != 0) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+        if (flags & http2::flags::ack) {
+            return;
+        }
+        if (length % 6 != 0) {
+            return h2_connection_error(http2::error_code::frame_size_error);
+        }
+
+        for (std::size_t i = 0; i < length; i += 6) {
+            auto setting = static_cast<http2::setting>((payload[i] << 8) | payload[i + 1]);
+            auto value = http2::read_uint32(payload + i + 2);
+
+            switch(setting) {
+                case http2::setting::max_concurrent_streams:
+                    conn.max_streams = value;
+                    break;
+                case http2::setting::initial_window_size: {
+                    if (value > http2::max_window_size) {
+                        return h2_connection_error(http2::error_code::flow_control_error);
+                    }
+                    // Applies to the open streams too
+                    auto delta = static_cast<std::int64_t>(value) - conn.peer_initial_window;
+                    for (auto& [sid, req_ctx] : conn.streams) {
+                        req_ctx->send_window += delta;
+                    }
+                    conn.peer_initial_window = value;
+                    break;
+                }
+                case http2::setting::max_frame_size:
+                    if (value < http2::default_max_frame_size || value > 0xffffff) {
+                        return h2_connection_error(http2::error_code::protocol_error);
+                    }
+                    conn.peer_max_frame_size = value;
+                    break;
+                default:
+                    break; // The header table is not used by the encoder
+            }
+        }
+        if (!conn.settings_received) {
+            conn.settings_received = true;
+            _protocol_known = true;
+        }
+
+        std::string frame;
+        http2::append_frame_header(frame, 0, http2::frame_type::settings, http2::flags::ack, 0);
+        conn.out.push_back({std::move(frame)});
+    }
+
+    void h2_ping(std::uint8_t flags, std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        if (id != 0) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+        if (length != 8) {
+            return h2_connection_error(http2::error_code::frame_size_error);
+        }
+        if (flags & http2::flags::ack) {
+            return;
+        }
+
+        std::string frame;
+        http2::append_frame_header(frame, 8, http2::frame_type::ping, http2::flags::ack, 0);
+        frame.append(reinterpret_cast<const char*>(payload), 8);
+        _http2->out.push_back({std::move(frame)});
+    }
+
+    // No new stream on this connection, the ones not processed are sent on the next one
+    void h2_goaway(std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (id != 0 || length < 8) {
+            return h2_connection_error(http2::error_code::protocol_error);
+        }
+
+        conn.goaway = true;
+        const auto last_id = http2::read_uint32(payload) & 0x7fffffff;
+        for (auto it = conn.streams.upper_bound(last_id); it != conn.streams.end();) {
+            _requests.push_back(it->second);
+            it = conn.streams.erase(it);
+        }
+    }
+
+    void h2_window_update(std::uint32_t id, const std::uint8_t* payload, std::size_t length)
+    {
+        auto& conn = *_http2;
+        if (length != 4) {
+            return h2_connection_error(http2::error_code::frame_size_error);
+        }
+
+        const std::int64_t increment = http2::read_uint32(payload) & 0x7fffffff;
+        if (id == 0) {
+            conn.send_window += increment;
+            if (increment == 0 || conn.send_window > http2::max_window_size) {
+                return h2_connection_error(http2::error_code::flow_control_error);
+            }
+            return;
+        }
+
+        auto found = conn.streams.find(id);
+        if (found == conn.streams.end()) {
+            return; // Closed meanwhile
+        }
+        found->second->send_window += increment;
+        if (increment == 0 || found->second->send_window > http2::max_window_size) {
+            return h2_stream_error(id, http2::error_code::flow_control_error);
+        }
+    }
+
+    void h2_window_update_frame(std::uint32_t id, std::uint32_t increment)
+    {
+        std::string frame;
+        http2::append_frame_header(frame, 4, http2::frame_type::window_update, 0, id);
+        http2::append_uint32(frame, increment);
+        _http2->out.push_back({std::move(frame)});
+    }
+
+    void h2_rst_stream_frame(std::uint32_t id, http2::error_code code)
+    {
+        std::string frame;
+        http2::append_frame_header(frame, 4, http2::frame_type::rst_stream, 0, id);
+        http2::append_uint32(frame, static_cast<std::uint32_t>(code));
+        _http2->out.push_back({std::move(frame)});
+    }
+
+    void h2_stream_error(std::uint32_t id, http2::error_code code,
+            boost::system::error_code ec = boost::system::error_code(boost::system::errc::protocol_error,
+                    boost::system::system_category()))
+    {
+        auto& conn = *_http2;
+        h2_rst_stream_frame(id, code);
+
+        auto found = conn.streams.find(id);
+        if (found != conn.streams.end()) {
+            auto req_ctx = found->second;
+            conn.streams.erase(found);
+            complete(req_ctx, ec);
+        }
+    }
+
+    // The GOAWAY is sent, the connection is closed after
+    void h2_connection_error(http2::error_code code)
+    {
+        auto& conn = *_http2;
+        conn.goaway = true;
+        conn.error = boost::system::error_code(boost::system::errc::protocol_error, boost::system::system_category());
+
+        std::string frame;
+        http2::append_frame_header(frame, 8, http2::frame_type::goaway, 0, 0);
+        http2::append_uint32(frame, 0);
+        http2::append_uint32(frame, static_cast<std::uint32_t>(code));
+        conn.out.push_back({std::move(frame)});
+        h2_write();
+    }
+
+    // A stream timed out, false if already completed
+    bool h2_cancel(const request_context& req_ctx)
+    {
+        if (_http2) {
+            auto found = _http2->streams.find(req_ctx.stream_id);
+            if (found != _http2->streams.end() && found->second.get() == &req_ctx) {
+                h2_rst_stream_frame(req_ctx.stream_id, http2::error_code::cancel);
+                _http2->streams.erase(found);
+                h2_open_streams();
+                h2_write();
+                return true;
+            }
+        }
+
+        // Still waiting for a stream
+        return std::any_of(_requests.begin(), _requests.end(),
+                [&req_ctx](const auto& waiting) { return waiting.get() == &req_ctx; });
+    }
+
+    // The streams without response are sent again on a new connection
+    void h2_close(boost::system::error_code ec)
+    {
+        auto conn = std::move(_http2);
+
+        boost::system::error_code ignored;
+        socket().close(ignored);
 
+        // Prior knowledge not understood, the server only speaks HTTP/1.1
+        const bool refused = (!SSL && !conn->settings_received);
+        if (refused) {
+            _http1_only = true;
+        }
+
+        std::vector<std::shared_ptr<request_context>> retry;
+        for (auto& [id, req_ctx] : conn->streams) {
+            if (refused || (!conn->error && !req_ctx->responded && !req_ctx->retried)) {
+                req_ctx->retried = !refused;
+                req_ctx->responded = false;
+                req_ctx->response.get().body().clear();
+                req_ctx->pending.clear();
+                retry.push_back(req_ctx);
+            } else {
+                complete(req_ctx, conn->error ? conn->error : ec);
+            }
+        }
+        _requests.insert(_requests.begin(), retry.begin(), retry.end());
+
+        if (!_requests.empty()) {
+            do_resolve();
+        }
+    }
+
+    void complete(const std::shared_ptr<request_context>& req_ctx, boost::system::error_code ec)
+    {
+        if (req_ctx->stream && std::exchange(req_ctx->completed, true)) {
+            return; // Failed while the body was given to the handler
+        }
         req_ctx->timer.cancel(); // will call on_timer with operator_cancelled
+        _completed.emplace_back(req_ctx, ec);
+    }
+
+    // A step run on the strand, the callbacks are called after: a new request can be sent from them,
+    // and the pool sees the capacity left by the step
+    template<typename F>
+    void with_callbacks(F&& f)
+    {
+        std::vector<completion> completed;
+        std::vector<std::function<void()>> deferred;
+        std::function<void()> connected;
+
+        f();
+        completed.swap(_completed);
+        deferred.swap(_deferred);
+        if (std::exchange(_protocol_known, false)) {
+            connected = _on_connected;
+        }
+        _capacity.store(available(), std::memory_order_release);
 
-        if (req_ctx->cb) {
-            if (!req_ctx->too_late) {
-                _response = req_ctx->response.release();
-                req_ctx->cb(ec, std::move(_response));
+        if (connected) {
+            connected();
+        }
+        for (auto& fct : deferred) {
+            fct();
+        }
+        notify(completed);
+    }
+
+    std::size_t available() const
+    {
+        if (_http2) {
+            const bool usable = _http2->settings_received && !_http2->goaway && !_http2->error;
+            return (usable ? _http2->max_streams : 0);
+        }
+        return (_connecting || _aborted ? 0 : 1);
+    }
+
+    void notify(std::vector<completion>& completed)
+    {
+        for (auto& [req_ctx, ec] : completed) {
+            if (!req_ctx->cb) {
+                // Synchronous request
+                if (!ec) {
+                    _response = req_ctx->response.release();
+                }
+            }
+            else if (!req_ctx->too_late) {
+                auto cb = std::move(req_ctx->cb);
                 req_ctx->cb = nullptr;
+                beauty::response response;
+                if (!ec) {
+                    response = req_ctx->response.release();
+                }
+                cb(ec, std::move(response));
             }
         }
-        else {
-            _response = req_ctx->response.release();
+    }
+
+    // The connection cannot be made, the requests waiting for it fail
+    void fail_all(boost::system::error_code ec)
+    {
+        _pending_request = false;
+        _connecting = false;
+        boost::system::error_code ignored;
+        socket().close(ignored);
+
+        auto requests = std::move(_requests);
+        _requests.clear();
+        for (const auto& req_ctx : requests) {
+            if (!req_ctx->cb && !req_ctx->too_late) {
+                throw boost::system::system_error(ec); // Synchronous request
+            }
+            complete(req_ctx, ec);
+        }
+    }
+
+    // The request sent failed, the next ones are sent on a new connection
+    void fail_first(boost::system::error_code ec)
+    {
+        auto req_ctx = _requests.front();
+        if (!req_ctx->cb && !req_ctx->too_late) {
+            throw boost::system::system_error(ec); // Synchronous request
         }
 
-        do_write();
+        _requests.pop_front();
+        _pending_request = false;
+        boost::system::error_code ignored;
+        socket().close(ignored);
+        complete(req_ctx, ec);
+
+        if (!_requests.empty()) {
+            do_resolve();
+        }
     }
 
-    void
-    on_timer(boost::system::error_code ec, std::shared_ptr<request_context> req_ctx)
+    // The TCP socket, and the stream read and written
+    asio::ip::tcp::socket& socket()
     {
-        //std::cout << "session_client:" << __LINE__ << " : on_timer" << std::endl;
-        if (!ec && !req_ctx->too_late) {
-            fail(*req_ctx, boost::system::error_code(boost::system::errc::timed_out,
-                    boost::system::system_category()),
-                    "timeout");
+        if constexpr(SSL) {
+#if BEAUTY_ENABLE_OPENSSL
+            return _stream.next_layer();
+#endif
+        } else {
+            return _socket;
+        }
+    }
 
-            req_ctx->too_late = true;
+    decltype(auto) stream()
+    {
+        if constexpr(SSL) {
+            return (_stream);
+        } else {
+            return (_socket);
         }
     }
 
-    beauty::response& response() { return _response; }
+    static std::string_view view(beast::string_view s) noexcept
+    {
+        return {s.data(), s.size()};
+    }
 
 private:
     asio::io_context&       _ioc;
-    asio::ip::tcp::resolver _resolver;
     asio::ip::tcp::socket   _socket;
     stream_type                                   _stream = {};
     asio::strand<asio::io_context::executor_type> _strand;
@@ -416,10 +1737,25 @@ private:
     // Synchronous response
     beauty::response        _response;
 
-    // Asynchronous request - wait for connection
-    std::mutex              _requests_mtx;
+    // Asynchronous request - queued by any thread, then waiting for the connection
+    mpsc_queue<std::shared_ptr<request_context>> _submitted;
     std::deque<std::shared_ptr<request_context>> _requests;
-    std::atomic_bool        _pending_request{false};
+    bool                    _pending_request{false};
+    std::atomic<std::size_t> _capacity{1};
+
+    // HTTP/2 connection, negotiated with ALPN or with prior knowledge
+    client_settings         _settings;
+    std::shared_ptr<http2_connection> _http2;
+    bool                    _http1_only{false}; // Prior knowledge refused by the server
+
+    // Callbacks to call once the step is done
+    std::vector<completion> _completed;
+    std::vector<std::function<void()>> _deferred; // Streamed bodies
+    std::function<void()>   _on_connected;
+    unsent_handler          _on_unsent;
+    bool                    _protocol_known{false};
+    bool                    _connecting{false};
+    bool                    _aborted{false};    // Closed on a timeout, not reused by the pool
 
 private:
     void fail(request_context& req_ctx, boost::system::error_code ec, const char* msg /* not used */) {
@@ -0,0 +1,452 @@
+#include <beauty/static_files.hpp>
+
+#include <beauty/version.hpp>
+#include <beauty/utils.hpp>
+
+#if BOOST_BEAST_USE_POSIX_FILE
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace http = boost::beast::http;
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const DAYS[]   = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+const char* const MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+//---------------------------------------------------------------------------
+// Days since 1970-01-01 for a civil date, and the opposite
+//---------------------------------------------------------------------------
+std::int64_t
+days_from_civil(std::int64_t y, unsigned m, unsigned d)
+{
+    y -= (m <= 2);
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const auto yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+void
+civil_from_days(std::int64_t z, std::int64_t& y, unsigned& m, unsigned& d)
+{
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = (mp < 10 ? mp + 3 : mp - 9);
+    y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+//---------------------------------------------------------------------------
+// IMF-fixdate (RFC 7231): Sun, 06 Nov 1994 08:49:37 GMT
+//---------------------------------------------------------------------------
+std::string
+format_http_date(std::int64_t t)
+{
+    std::int64_t days = (t >= 0 ? t / 86400 : (t - 86399) / 86400);
+    std::int64_t secs = t - days * 86400;
+
+    std::int64_t y; unsigned m, d;
+    civil_from_days(days, y, m, d);
+
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%s, %02u %s %04lld %02d:%02d:%02d GMT",
+            DAYS[((days % 7) + 11) % 7], d, MONTHS[m - 1], (long long)y,
+            (int)(secs / 3600), (int)(secs % 3600 / 60), (int)(secs % 60));
+    return buffer;
+}
+
+bool
+parse_http_date(std::string_view s, std::int64_t& t)
+{
+    char month[4] = {};
+    int d, y, hh, mm, ss;
+    std::string str(s);
+    if (std::sscanf(str.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &d, month, &y, &hh, &mm, &ss) != 6) {
+        return false;
+    }
+
+    for (unsigned m = 0; m < 12; ++m) {
+        if (std::strcmp(month, MONTHS[m]) == 0) {
+            t = days_from_civil(y, m + 1, d) * 86400 + hh * 3600 + mm * 60 + ss;
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// The etag could be in a list: "xyz", W/"xyz" or *
+//---------------------------------------------------------------------------
+bool
+etag_match(std::string_view list, std::string_view etag)
+{
+    for (auto tag : beauty::split(list, ',')) {
+        while (!tag.empty() && tag.front() == ' ') tag.remove_prefix(1);
+        while (!tag.empty() && tag.back() == ' ') tag.remove_suffix(1);
+        if (tag.substr(0, 2) == "W/") tag.remove_prefix(2);
+
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// Single range only "bytes=first-last", "bytes=first-" or "bytes=-suffix".
+// Returns false if the range is malformed (or multiple), so to be ignored,
+// satisfiable is false if the range is outside the file
+//---------------------------------------------------------------------------
+bool
+parse_range(std::string_view range, std::uint64_t size,
+        std::uint64_t& first, std::uint64_t& last, bool& satisfiable)
+{
+    if (range.substr(0, 6) != "bytes=" || range.find(',') != std::string_view::npos) {
+        return false;
+    }
+    range.remove_prefix(6);
+
+    auto dash = range.find('-');
+    if (dash == std::string_view::npos) {
+        return false;
+    }
+
+    auto to_number = [](std::string_view s, std::uint64_t& n) {
+        if (s.empty() || s.size() > 19) return false;
+        n = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9') return false;
+            n = n * 10 + (c - '0');
+        }
+        return true;
+    };
+
+    auto first_view = range.substr(0, dash);
+    auto last_view = range.substr(dash + 1);
+
+    if (first_view.empty()) {
+        // Suffix range, the last bytes
+        std::uint64_t suffix;
+        if (!to_number(last_view, suffix)) return false;
+        satisfiable = (suffix > 0 && size > 0);
+        first = (suffix < size ? size - suffix : 0);
+        last = size - 1;
+        return true;
+    }
+
+    if (!to_number(first_view, first)) return false;
+    if (last_view.empty()) {
+        last = size - 1;
+    }
+    else if (!to_number(last_view, last) || last < first) {
+        return false;
+    }
+
+    satisfiable = (first < size);
+    last = std::min(last, size - 1);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Only the %XX are decoded, a '+' is a valid file name character
+//---------------------------------------------------------------------------
+std::string
+percent_decode(std::string_view s)
+{
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    std::string decoded;
+    decoded.reserve(s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size() && hex(s[i + 1]) >= 0 && hex(s[i + 2]) >= 0) {
+            decoded += static_cast<char>(hex(s[i + 1]) << 4 | hex(s[i + 2]));
+            i += 2;
+        }
+        else {
+            decoded += s[i];
+        }
+    }
+    return decoded;
+}
+
+//---------------------------------------------------------------------------
+const char*
+mime_type(const fs::path& path)
+{
+    static const std::unordered_map<std::string, const char*> types = {
+        {".htm", "text/html"}, {".html", "text/html"}, {".css", "text/css"},
+        {".txt", "text/plain"}, {".csv", "text/csv"}, {".xml", "application/xml"},
+        {".js", "application/javascript"}, {".json", "application/json"},
+        {".wasm", "application/wasm"}, {".pdf", "application/pdf"},
+        {".zip", "application/zip"}, {".gz", "application/gzip"}, {".tar", "application/x-tar"},
+        {".png", "image/png"}, {".jpe", "image/jpeg"}, {".jpeg", "image/jpeg"},
+        {".jpg", "image/jpeg"}, {".gif", "image/gif"}, {".bmp", "image/bmp"},
+        {".ico", "image/x-icon"}, {".svg", "image/svg+xml"}, {".webp", "image/webp"},
+        {".mp4", "video/mp4"}, {".webm", "video/webm"}, {".mp3", "audio/mpeg"}
+    };
+
+    std::string ext = path.extension().string();
+    for (auto& c : ext) c = (char)std::tolower((unsigned char)c);
+
+    auto found = types.find(ext);
+    return (found != types.end() ? found->second : "application/octet-stream");
+}
+
+}
+
+namespace beauty
+{
+// --------------------------------------------------------------------------
+static_file::static_file(beast::file&& file, std::uint64_t size, fs::file_time_type write_time) :
+        _file(std::move(file)),
+        _size(size),
+        _write_time(write_time)
+{
+    using namespace std::chrono;
+    // No clock_cast in C++17, the write time is moved on the system clock
+    auto system_time = system_clock::now() + duration_cast<system_clock::duration>(
+            write_time - fs::file_time_type::clock::now());
+    _last_modified_time = duration_cast<seconds>(system_time.time_since_epoch()).count();
+    _last_modified = format_http_date(_last_modified_time);
+
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+            (unsigned long long)_size,
+            (unsigned long long)write_time.time_since_epoch().count());
+    _etag = etag;
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+static_file::read(std::uint64_t offset, char* buffer, std::size_t size, boost::system::error_code& ec)
+{
+#if BOOST_BEAST_USE_POSIX_FILE
+    auto result = ::pread(_file.native_handle(), buffer, size, static_cast<off_t>(offset));
+    if (result < 0) {
+        ec = {errno, boost::system::system_category()};
+        return 0;
+    }
+    ec = {};
+    return static_cast<std::size_t>(result);
+#else
+    std::lock_guard guard{_mtx};
+    _file.seek(offset, ec);
+    if (ec) {
+        return 0;
+    }
+    return _file.read(buffer, size, ec);
+#endif
+}
+
+// --------------------------------------------------------------------------
+static_files::static_files(const std::string& prefix, fs::path root, std::size_t cache_capacity) :
+        _prefix(prefix),
+        _root(std::move(root)),
+        _cache_capacity(std::max<std::size_t>(1, cache_capacity))
+{
+    if (_prefix.empty() || _prefix[0] != '/') {
+        throw std::runtime_error("Static prefix [" + prefix + "] must begin with '/'.");
+    }
+
+    // No trailing '/', except for the root
+    while (_prefix.size() > 1 && _prefix.back() == '/') {
+        _prefix.pop_back();
+    }
+}
+
+// --------------------------------------------------------------------------
+bool
+static_files::match(std::string_view path) const noexcept
+{
+    if (_prefix.size() == 1) {
+        return true;
+    }
+
+    return path.substr(0, _prefix.size()) == _prefix
+        && (path.size() == _prefix.size() || path[_prefix.size()] == '/');
+}
+
+// --------------------------------------------------------------------------
+std::shared_ptr<static_file_response>
+static_files::serve(const beauty::request& req)
+{
+    auto target = std::string_view{req.target().data(), req.target().size()};
+    auto path = target.substr(0, target.find('?'));
+    if (!match(path)) {
+        return nullptr;
+    }
+    path.remove_prefix(_prefix.size() == 1 ? 0 : _prefix.size());
+
+    // No way to go outside the root directory
+    auto relative = percent_decode(path);
+    for (auto segment : split(relative, '/')) {
+        if (segment == "..") {
+            return nullptr;
+        }
+    }
+    if (relative.find('\0') != std::string::npos || relative.find('\\') != std::string::npos) {
+        return nullptr;
+    }
+
+    auto file_path = _root / fs::path(relative).relative_path();
+    if (std::error_code fs_ec; fs::is_directory(file_path, fs_ec)) {
+        file_path /= "index.html";
+    }
+
+    auto file = open(file_path);
+    if (!file) {
+        return nullptr;
+    }
+
+    auto res = std::make_shared<static_file_response>(http::status::ok, req.version());
+    res->set(http::field::server, BEAUTY_PROJECT_VERSION);
+    res->set(http::field::content_type, mime_type(file_path));
+    res->set(http::field::accept_ranges, "bytes");
+    res->set(http::field::etag, file->etag());
+    res->set(http::field::last_modified, file->last_modified());
+    res->keep_alive(req.keep_alive());
+
+    // Conditional request, If-None-Match has precedence
+    bool not_modified = false;
+    if (auto inm = req.find(http::field::if_none_match); inm != req.end()) {
+        not_modified = etag_match({inm->value().data(), inm->value().size()}, file->etag());
+    }
+    else if (auto ims = req.find(http::field::if_modified_since); ims != req.end()) {
+        std::int64_t since;
+        not_modified = parse_http_date({ims->value().data(), ims->value().size()}, since)
+                && file->last_modified_time() <= since;
+    }
+
+    if (not_modified) {
+        res->result(http::status::not_modified);
+        res->erase(http::field::content_type);
+        return res;
+    }
+
+    std::uint64_t first = 0;
+    std::uint64_t size = file->size();
+
+    // Range only if the representation is the same (If-Range)
+    if (auto range = req.find(http::field::range); range != req.end()) {
+        bool same_representation = true;
+        if (auto if_range = req.find(http::field::if_range); if_range != req.end()) {
+            auto value = std::string_view{if_range->value().data(), if_range->value().size()};
+            same_representation = (value == file->etag() || value == file->last_modified());
+        }
+
+        std::uint64_t last;
+        bool satisfiable = false;
+        if (same_representation
+                && parse_range({range->value().data(), range->value().size()}, file->size(), first, last, satisfiable)) {
+            if (!satisfiable) {
+                res->result(http::status::range_not_satisfiable);
+                res->set(http::field::content_range, "bytes */" + std::to_string(file->size()));
+                res->content_length(0);
+                return res;
+            }
+
+            size = last - first + 1;
+            res->result(http::status::partial_content);
+            res->set(http::field::content_range, "bytes " + std::to_string(first) + "-"
+                    + std::to_string(last) + "/" + std::to_string(file->size()));
+        }
+        else {
+            first = 0;
+        }
+    }
+
+    res->content_length(size);
+    if (req.method() != http::verb::head) {
+        res->body().file = std::move(file);
+        res->body().offset = first;
+        res->body().size = size;
+    }
+
+    return res;
+}
+
+// --------------------------------------------------------------------------
+std::size_t
+static_files::cache_size() const
+{
+    std::lock_guard guard{_cache_mtx};
+    return _cache.size();
+}
+
+// --------------------------------------------------------------------------
+// Get the opened file from the cache, if still the same on disk
+// --------------------------------------------------------------------------
+std::shared_ptr<static_file>
+static_files::open(const fs::path& path)
+{
+    std::error_code fs_ec;
+    auto size = fs::file_size(path, fs_ec);
+    if (fs_ec) {
+        return nullptr;
+    }
+    auto write_time = fs::last_write_time(path, fs_ec);
+    if (fs_ec) {
+        return nullptr;
+    }
+
+    auto key = path.string();
+    {
+        std::lock_guard guard{_cache_mtx};
+        if (auto found = _cache_index.find(key); found != _cache_index.end()) {
+            const auto& file = found->second->second;
+            if (file->size() == size && file->write_time() == write_time) {
+                _cache.splice(_cache.begin(), _cache, found->second);
+                return file;
+            }
+            // Modified, the old file is still kept by the pending responses
+            _cache.erase(found->second);
+            _cache_index.erase(found);
+        }
+    }
+
+    beast::file opened;
+    boost::system::error_code ec;
+    opened.open(key.c_str(), beast::file_mode::scan, ec);
+    if (ec) {
+        return nullptr;
+    }
+
+    auto file = std::make_shared<static_file>(std::move(opened), size, write_time);
+
+    std::lock_guard guard{_cache_mtx};
+    if (auto found = _cache_index.find(key); found != _cache_index.end()) {
+        // Opened by another thread in the meantime
+        _cache.erase(found->second);
+        _cache_index.erase(found);
+    }
+    _cache.emplace_front(key, file);
+    _cache_index[key] = _cache.begin();
+
+    while (_cache.size() > _cache_capacity) {
+        _cache_index.erase(_cache.back().first);
+        _cache.pop_back();
+    }
+
+    return file;
+}
+
+}
@@ -95,6 +95,42 @@ url::url(std::string u) : _url(std::move(u))
     }
 }
 
+// --------------------------------------------------------------------------
+url::url(const url& other) : _url(other._url), _port(other._port)
+{
+    rebase(other);
+}
+
+// --------------------------------------------------------------------------
+url&
+url::operator=(const url& other)
+{
+    if (this != &other) {
+        _url = other._url;
+        _port = other._port;
+        rebase(other);
+    }
+    return *this;
+}
+
+// --------------------------------------------------------------------------
+void
+url::rebase(const url& other)
+{
+    auto move_view = [this, &other](std::string_view v) {
+        return v.empty() ? std::string_view{}
+                         : std::string_view(_url.data() + (v.data() - other._url.data()), v.size());
+    };
+
+    _scheme = move_view(other._scheme);
+    _login = move_view(other._login);
+    _password = move_view(other._password);
+    _host = move_view(other._host);
+    _port_view = move_view(other._port_view);
+    _path = move_view(other._path);
+    _query = move_view(other._query);
+}
+
 // --------------------------------------------------------------------------
 std::string
 url::strip_login_password() const {
@@ -1,16 +1,27 @@
 #include <beauty/utils.hpp>
 
 #include <beauty/header.hpp>
+#include <beauty/message_pool.hpp>
 #include <beauty/version.hpp>
 #include <beauty/request.hpp>
 #include <beauty/response.hpp>
 
 #include <boost/beast/http.hpp>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <regex>
 #include <random>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEAUTY_HAS_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 namespace http = boost::beast::http;
 
 namespace {
@@ -36,10 +47,99 @@ split(const T& str, char sep)
     return columns;
 }
 
+//---------------------------------------------------------------------------
+// Characters kept as is by escape: A-Z a-z 0-9 - . _ ~
+constexpr std::array<bool, 256> unreserved = [] {
+    std::array<bool, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        table[c] = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                || c == '-' || c == '.' || c == '_' || c == '~';
+    }
+    return table;
+}();
+
+// Value of a hexadecimal digit, -1 if not one
+constexpr std::array<std::int8_t, 256> hex_value = [] {
+    std::array<std::int8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        table[c] = (c >= '0' && c <= '9' ? c - '0'
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : -1);
+    }
+    return table;
+}();
+
+#if BEAUTY_HAS_SSE2
+inline
+unsigned
+first_bit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
 inline
-unsigned char
-hexdigit_to_num(unsigned char c)
-{ return (c < 'A' ? c - '0' : toupper(c) - 'A' + 10); }
+__m128i
+in_range(__m128i v, char low, char high)
+{
+    // Signed comparisons, the bytes above 0x7F are never in the ranges used
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(high + 1)));
+}
+#endif
+
+//---------------------------------------------------------------------------
+// Length of the leading characters kept as is, 16 at a time with SSE2
+std::size_t
+unreserved_prefix(const char* p, std::size_t size)
+{
+    std::size_t i = 0;
+#if BEAUTY_HAS_SSE2
+    for (; i + 16 <= size; i += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        auto kept = _mm_or_si128(
+                _mm_or_si128(in_range(v, '0', '9'), in_range(v, 'A', 'Z')),
+                _mm_or_si128(
+                    _mm_or_si128(in_range(v, 'a', 'z'), in_range(v, '-', '.')),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~')))));
+        unsigned escaped = ~static_cast<unsigned>(_mm_movemask_epi8(kept)) & 0xFFFF;
+        if (escaped) {
+            return i + first_bit(escaped);
+        }
+    }
+#endif
+    while (i < size && unreserved[static_cast<unsigned char>(p[i])]) {
+        ++i;
+    }
+    return i;
+}
+
+//---------------------------------------------------------------------------
+// Length of the leading characters without '%' or '+', 16 at a time with SSE2
+std::size_t
+unescaped_prefix(const char* p, std::size_t size)
+{
+    std::size_t i = 0;
+#if BEAUTY_HAS_SSE2
+    for (; i + 16 <= size; i += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        auto special = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('%')), _mm_cmpeq_epi8(v, _mm_set1_epi8('+')));
+        unsigned found = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (found) {
+            return i + first_bit(found);
+        }
+    }
+#endif
+    while (i < size && p[i] != '%' && p[i] != '+') {
+        ++i;
+    }
+    return i;
+}
 
 }
 
@@ -49,7 +149,7 @@ namespace helper {
 //---------------------------------------------------------------------------
 std::shared_ptr<response>
 bad_request(const request& req, const char* message) {
-    auto res = std::make_shared<response>(http::status::bad_request, req.version());
+    auto res = make_response(http::status::bad_request, req.version());
     res->set(http::field::server, BEAUTY_PROJECT_VERSION);
     res->set(content_type::text_plain);
     res->keep_alive(req.keep_alive());
@@ -60,7 +160,7 @@ bad_request(const request& req, const char* message) {
 //---------------------------------------------------------------------------
 std::shared_ptr<response>
 not_found(const request& req) {
-    auto res = std::make_shared<response>(http::status::not_found, req.version());
+    auto res = make_response(http::status::not_found, req.version());
     res->set(http::field::server, BEAUTY_PROJECT_VERSION);
     res->set(content_type::text_plain);
     res->keep_alive(req.keep_alive());
@@ -72,7 +172,7 @@ not_found(const request& req) {
 //---------------------------------------------------------------------------
 std::shared_ptr<response>
 server_error(const request& req, const char* message) {
-    auto res = std::make_shared<response>(http::status::internal_server_error, req.version());
+    auto res = make_response(http::status::internal_server_error, req.version());
     res->set(http::field::server, BEAUTY_PROJECT_VERSION);
     res->set(content_type::text_plain);
     res->keep_alive(req.keep_alive());
@@ -103,72 +203,81 @@ split(const std::string_view& str_view, char sep)
 }
 
 //---------------------------------------------------------------------------
-std::string
-escape(const std::string& s)
+std::size_t
+escape(std::string_view s, char* out)
 {
-    static const char* dec2hex = "0123456789ABCDEF";
-    static std::regex unsafe("[^A-Za-z0-9\\-\\._~]");
+    static constexpr char dec2hex[] = "0123456789ABCDEF";
 
-    std::string escaped;
-    auto cur = std::sregex_token_iterator(s.begin(), s.end(), unsafe);
-    auto end = std::sregex_token_iterator();
-    auto vbegin = s.begin();
-
-    for ( ; cur != end; ++cur) {
+    char* o = out;
+    std::size_t i = 0;
+    while (i < s.size()) {
         // Append valid chars
-        escaped.append(vbegin, cur->first);
-
-        for (auto it = cur->first; it != cur->second; ++it) {
-            auto c = (unsigned char) ::toupper(*it);
-
-            escaped += '%';
-            escaped += dec2hex[c >> 4];
-            escaped += dec2hex[c & 0x0F];
+        auto kept = unreserved_prefix(s.data() + i, s.size() - i);
+        std::memcpy(o, s.data() + i, kept);
+        o += kept;
+        i += kept;
+
+        if (i < s.size()) {
+            auto c = static_cast<unsigned char>(s[i++]);
+            *o++ = '%';
+            *o++ = dec2hex[c >> 4];
+            *o++ = dec2hex[c & 0x0F];
         }
-
-        vbegin = cur->second;
     }
-
-    escaped.append(vbegin, s.end());
-
-    return escaped;
+    return o - out;
 }
 
 //---------------------------------------------------------------------------
 std::string
-unescape(const std::string& s)
+escape(std::string_view s)
 {
-    static std::regex escaped("%([0-9A-Fa-f]{2})");
-
-    // Support urlencoded '+' --> ' '
-    std::string t = std::regex_replace(s,
-                                       std::regex("\\+"),
-                                       " ");
-
-    std::string unescaped;
-    auto cur = std::sregex_token_iterator(t.begin(), t.end(), escaped);
-    auto end = std::sregex_token_iterator();
-    auto vbegin = t.cbegin();
-
-    for ( ; cur != end; ++cur) {
-        auto it = cur->first;
-
-        // Append unescaped chars
-        unescaped.append(vbegin, it);
-
-        // Skip percent
-        ++it;
+    std::string escaped(3 * s.size(), '\0');
+    escaped.resize(escape(s, escaped.data()));
+    return escaped;
+}
 
-        auto c = hexdigit_to_num(*it++) << 4;
-        c |= hexdigit_to_num(*it++);
+//---------------------------------------------------------------------------
+std::size_t
+unescape(std::string_view s, char* out)
+{
+    char* o = out;
+    std::size_t i = 0;
+    while (i < s.size()) {
+        // Append unescaped chars, moved as out may be s
+        auto kept = unescaped_prefix(s.data() + i, s.size() - i);
+        std::memmove(o, s.data() + i, kept);
+        o += kept;
+        i += kept;
+
+        if (i == s.size()) {
+            break;
+        }
 
-        unescaped += c;
+        if (s[i] == '+') {
+            // Support urlencoded '+' --> ' '
+            *o++ = ' ';
+            ++i;
+            continue;
+        }
 
-        vbegin = cur->second;
+        int high = (i + 2 < s.size() ? hex_value[static_cast<unsigned char>(s[i + 1])] : -1);
+        int low = (high >= 0 ? hex_value[static_cast<unsigned char>(s[i + 2])] : -1);
+        if (low >= 0) {
+            *o++ = static_cast<char>((high << 4) | low);
+            i += 3;
+        } else {
+            *o++ = s[i++]; // Not an escaped char, kept as is
+        }
     }
+    return o - out;
+}
 
-    unescaped.append(vbegin, t.cend());
-
+//---------------------------------------------------------------------------
+std::string
+unescape(std::string_view s)
+{
+    std::string unescaped(s.size(), '\0');
+    unescaped.resize(unescape(s, unescaped.data()));
     return unescaped;
 }
 
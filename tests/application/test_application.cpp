@@ -4,6 +4,8 @@
 #include <beauty/application.hpp>
 #include <beauty/timer.hpp>
 
+#include <future>
+
 // --------------------------------------------------------------------------
 TEST_CASE("Run and stop")
 {
@@ -60,3 +62,20 @@ TEST_CASE("Asynchronous post")
 
     CHECK_EQ(was_called, 1);
 }
+
+// --------------------------------------------------------------------------
+TEST_CASE("Stopped from an offloaded work")
+{
+    beauty::application app;
+    app.start();
+
+    // The compute pool thread does not join itself
+    std::promise<void> stopped;
+    app.offload([&] {
+        app.stop();
+        stopped.set_value();
+    });
+
+    CHECK_EQ(stopped.get_future().wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    CHECK(app.is_stopped());
+}
@@ -5,6 +5,7 @@
 #include <beauty/client.hpp>
 
 #include <chrono>
+#include <future>
 
 using namespace std::chrono_literals;
 
@@ -126,6 +127,28 @@ TEST_CASE_FIXTURE(ClientFixture, "Get Asynchronous")
     CHECK(called);
 }
 
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientFixture, "Completion token")
+{
+    beauty::client client;
+    auto url = "http://127.0.0.1:" + std::to_string(port) + "/index.html";
+
+    std::future<beauty::response> get = client.async_get(url, asio::use_future);
+    std::future<beauty::response> post = client.async_post(url + "?with_body=true", "Body", asio::use_future);
+    CHECK_EQ(get.get().body(), "GET VERB");
+    CHECK_EQ(post.get().body(), "POST VERB - BODY SIZE=4:Body");
+
+    // The error given by an exception
+    auto timeout = client.async_get_before(100ms, url + "?delay=0.500", asio::use_future);
+    CHECK_THROWS_AS(timeout.get(), boost::system::system_error);
+
+    // Or to a callback
+    std::promise<boost::system::error_code> result;
+    client.async_del_before(100ms, url + "?delay=0.500",
+            [&result](boost::system::error_code ec, beauty::response&&) { result.set_value(ec); });
+    CHECK_EQ(result.get_future().get(), boost::system::errc::timed_out);
+}
+
 // --------------------------------------------------------------------------
 TEST_CASE_FIXTURE(ClientFixture, "Get Synchronous Timeout ")
 {
@@ -0,0 +1,78 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+#include <beauty/coroutine.hpp>
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct ClientCoroutineFixture
+{
+    ClientCoroutineFixture()
+    {
+        server.concurrency(2);
+        server.get("/hello", [](const beauty::request& req, beauty::response& res) {
+            res.body() = "Hello";
+        });
+        server.add_route("/slow")
+            .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+                co_await beauty::sleep_for(500ms);
+            });
+        server.post("/echo", [](const beauty::request& req, beauty::response& res) {
+            res.body() = req.body();
+        });
+
+        // Both sent from the handler, the session is not blocked meanwhile
+        server.add_route("/proxy")
+            .get([this](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+                auto hello = co_await client.async_get(url + "/hello");
+                auto echo = co_await client.async_post(url + "/echo", " World");
+                res.body() = hello.body() + echo.body();
+            });
+
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port());
+    }
+
+    ~ClientCoroutineFixture() {
+        server.stop();
+    }
+
+    beauty::server server;
+    beauty::client client;
+    std::string url;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientCoroutineFixture, "Requests from a coroutine handler")
+{
+    auto [ec, response] = beauty::client().get(url + "/proxy");
+    CHECK_EQ(ec, boost::system::errc::success);
+    CHECK_EQ(response.body(), "Hello World");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientCoroutineFixture, "Coroutine on another event loop")
+{
+    asio::io_context ioc;
+    std::string body;
+    boost::system::error_code timeout;
+
+    asio::co_spawn(ioc, [&]() -> asio::awaitable<void> {
+        auto response = co_await client.async_get(url + "/hello");
+        body = response.body();
+
+        // The error code instead of an exception
+        co_await client.async_get_before(100ms, url + "/slow", asio::redirect_error(asio::use_awaitable, timeout));
+    }, asio::detached);
+
+    // Kept running while waiting for the responses
+    ioc.run();
+
+    CHECK_EQ(body, "Hello");
+    CHECK_EQ(timeout, boost::system::errc::timed_out);
+}
@@ -0,0 +1,168 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct HedgingFixture
+{
+    HedgingFixture()
+    {
+        server.concurrency(4); // The slow handlers are run at the same time
+
+        // The first one is slow, the next ones are fast
+        server.get("/slow-once", [this](const beauty::request& req, beauty::response& res) {
+            auto n = ++calls;
+            if (n == 1) {
+                std::this_thread::sleep_for(500ms);
+            }
+            res.body() = std::to_string(n);
+        });
+        server.get("/slow/:ms", [this](const beauty::request& req, beauty::response& res) {
+            ++calls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(req.a("ms").as_integer()));
+        });
+        // Not available for the first ones
+        auto unavailable = [this](const beauty::request& req, beauty::response& res) {
+            if (++calls <= 2) {
+                res.result(beauty::http::status::service_unavailable);
+            }
+        };
+        server.get("/flaky", unavailable);
+        server.post("/flaky", unavailable);
+        server.get("/down", [this](const beauty::request& req, beauty::response& res) {
+            ++calls;
+            res.result(beauty::http::status::service_unavailable);
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port());
+    }
+
+    ~HedgingFixture() {
+        server.stop();
+    }
+
+    static beauty::client_settings hedging(bool http2)
+    {
+        beauty::client_settings settings;
+        settings.http2 = http2;
+        settings.hedging = true;
+        settings.hedge_delay = 50ms;
+        return settings;
+    }
+
+    static beauty::client_settings retries(std::size_t max_retries)
+    {
+        beauty::client_settings settings;
+        settings.http2 = false;
+        settings.max_retries = max_retries;
+        return settings;
+    }
+
+    beauty::server server;
+    std::string url;
+    std::atomic<int> calls{0};
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Hedged request answered first")
+{
+    for (bool http2 : {false, true}) {
+        CAPTURE(http2);
+        calls = 0;
+        beauty::client client(hedging(http2));
+
+        auto start = std::chrono::steady_clock::now();
+        auto [ec, response] = client.get_before(2s, url + "/slow-once");
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.body(), "2");
+        CHECK_LT(elapsed, 400ms);
+
+        auto stats = client.request_stats();
+        CHECK_EQ(stats.hedges, 1);
+        CHECK_EQ(stats.hedge_wins, 1);
+        // Sent on another connection
+        CHECK_EQ(client.pool_stats().connects, 2);
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Hedge delay from the response times")
+{
+    auto settings = hedging(false);
+    settings.hedge_delay = 1s; // Until the response times are known
+    settings.hedge_min_delay = 100ms; // Not a warm-up request of a loaded machine
+    beauty::client client(settings);
+
+    for (int i = 0; i < 20; ++i) {
+        auto [ec, response] = client.get_before(2s, url + "/slow/0");
+        REQUIRE_EQ(ec, boost::system::errc::success);
+    }
+    CHECK_EQ(client.request_stats().hedges, 0);
+
+    // Far above the usual response time
+    auto [ec, response] = client.get_before(2s, url + "/slow/300");
+    CHECK_EQ(ec, boost::system::errc::success);
+    CHECK_EQ(client.request_stats().hedges, 1);
+    CHECK_EQ(client.request_stats().hedge_wins, 0);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Retried until available")
+{
+    beauty::client client(retries(2));
+
+    auto [ec, response] = client.get_before(2s, url + "/flaky");
+    CHECK_EQ(ec, boost::system::errc::success);
+    CHECK_EQ(response.result(), beauty::http::status::ok);
+    CHECK_EQ(calls, 3);
+    CHECK_EQ(client.request_stats().retries, 2);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Retries within the budget")
+{
+    auto settings = retries(3);
+    settings.retry_budget_tokens = 1;
+    settings.retry_budget_ratio = 0;
+    beauty::client client(settings);
+
+    auto [ec, response] = client.get_before(2s, url + "/down");
+    CHECK_EQ(response.result(), beauty::http::status::service_unavailable);
+    CHECK_EQ(calls, 2);
+
+    auto stats = client.request_stats();
+    CHECK_EQ(stats.retries, 1);
+    CHECK_EQ(stats.throttled, 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Not idempotent, sent once")
+{
+    beauty::client client(retries(2));
+
+    auto [ec, response] = client.post_before(2s, url + "/flaky", "body");
+    CHECK_EQ(response.result(), beauty::http::status::service_unavailable);
+    CHECK_EQ(calls, 1);
+    CHECK_EQ(client.request_stats().retries, 0);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(HedgingFixture, "Connection refused retried")
+{
+    auto settings = retries(1);
+    beauty::client client(settings);
+
+    // Nothing listening there
+    auto [ec, response] = client.get_before(2s, "http://127.0.0.1:1/");
+    CHECK(ec);
+    CHECK_EQ(client.request_stats().retries, 1);
+}
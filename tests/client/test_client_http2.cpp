@@ -0,0 +1,205 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct ClientHttp2Fixture
+{
+    explicit ClientHttp2Fixture(bool http2 = true)
+    {
+        beauty::server_settings settings;
+        settings.http2 = http2;
+        server.settings(settings);
+        server.concurrency(2); // The slow handler must not block the client
+
+        // The HTTP version and the client port, to check the connection used
+        server.get("/who", [](const beauty::request& req, beauty::response& res) {
+            res.body() = std::to_string(req.version()) + ":" + std::to_string(req.remote().port());
+        });
+        server.post("/echo", [](const beauty::request& req, beauty::response& res) {
+            res.body() = req.body();
+        });
+        server.get("/slow", [](const beauty::request& req, beauty::response& res) {
+            std::this_thread::sleep_for(300ms);
+            res.body() = "SLOW";
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port());
+    }
+
+    ~ClientHttp2Fixture() {
+        server.stop();
+    }
+
+    // Wait for the asynchronous responses
+    static bool wait_for(const std::atomic<int>& count, int expected)
+    {
+        for (int i = 0; i < 200 && count < expected; ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return count == expected;
+    }
+
+    beauty::server server;
+    std::string url;
+};
+
+// --------------------------------------------------------------------------
+struct ClientHttp1Fixture : ClientHttp2Fixture
+{
+    ClientHttp1Fixture() : ClientHttp2Fixture(false) {}
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientHttp2Fixture, "Concurrent requests multiplexed on one connection")
+{
+    beauty::client client;
+
+    std::mutex mtx;
+    std::set<std::string> bodies;
+    std::atomic<int> count{0};
+
+    for (int i = 0; i < 20; ++i) {
+        client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            CHECK_EQ(response.version(), 20);
+            {
+                std::lock_guard guard{mtx};
+                bodies.insert(response.body());
+            }
+            ++count;
+        });
+    }
+
+    // Larger than the default flow control windows
+    std::string body(300 * 1024, 'x');
+    for (std::size_t i = 0; i < body.size(); i += 7) body[i] = static_cast<char>('a' + i % 26);
+    client.post(url + "/echo", std::string(body), [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.result(), beauty::http::status::ok);
+        CHECK_EQ(response.body().size(), body.size());
+        CHECK(response.body() == body);
+        ++count;
+    });
+
+    REQUIRE(wait_for(count, 21));
+
+    // All the streams on the same connection
+    CHECK_EQ(bodies.size(), 1);
+    CHECK_EQ(bodies.begin()->substr(0, 3), "20:");
+
+    // The connection is kept for the next requests
+    client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.body(), *bodies.begin());
+        ++count;
+    });
+    CHECK(wait_for(count, 22));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientHttp2Fixture, "Requests sent from many threads on one connection")
+{
+    beauty::client_settings settings;
+    settings.max_connections_per_host = 1;
+    beauty::client client(settings);
+
+    std::mutex mtx;
+    std::set<std::string> bodies;
+    std::atomic<int> count{0};
+
+    std::vector<std::thread> senders;
+    for (int t = 0; t < 16; ++t) {
+        senders.emplace_back([&] {
+            for (int i = 0; i < 20; ++i) {
+                client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+                    CHECK_EQ(ec, boost::system::errc::success);
+                    {
+                        std::lock_guard guard{mtx};
+                        bodies.insert(response.body());
+                    }
+                    ++count;
+                });
+            }
+        });
+    }
+    for (auto& sender : senders) {
+        sender.join();
+    }
+
+    REQUIRE(wait_for(count, 16 * 20));
+    CHECK_EQ(bodies.size(), 1);
+    CHECK_EQ(client.pool_stats().connects, 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientHttp2Fixture, "Stream timeout")
+{
+    beauty::client client;
+    std::atomic<int> count{0};
+
+    client.get_before(100ms, url + "/slow", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec.value(), boost::system::errc::timed_out);
+        ++count;
+    });
+    REQUIRE(wait_for(count, 1));
+
+    // The stream is reset, the connection is still used
+    client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.version(), 20);
+        ++count;
+    });
+    CHECK(wait_for(count, 2));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientHttp2Fixture, "HTTP/2 disabled on the client")
+{
+    beauty::client_settings settings;
+    settings.http2 = false;
+    beauty::client client(settings);
+    std::atomic<int> count{0};
+
+    client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.version(), 11);
+        CHECK_EQ(response.body().substr(0, 3), "11:");
+        ++count;
+    });
+    CHECK(wait_for(count, 1));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientHttp1Fixture, "Fallback to HTTP/1.1")
+{
+    beauty::client client;
+    std::atomic<int> count{0};
+
+    for (int i = 0; i < 3; ++i) {
+        client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            CHECK_EQ(response.version(), 11);
+            CHECK_EQ(response.body().substr(0, 3), "11:");
+            ++count;
+        });
+    }
+    CHECK(wait_for(count, 3));
+
+    client.post(url + "/echo", "after the fallback", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.body(), "after the fallback");
+        ++count;
+    });
+    CHECK(wait_for(count, 4));
+}
@@ -0,0 +1,253 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct ClientPoolFixture
+{
+    ClientPoolFixture()
+    {
+        // HTTP/1.1 only, a connection for each request in flight
+        beauty::server_settings settings;
+        settings.http2 = false;
+        server.settings(settings);
+        server.concurrency(4); // The slow handlers must not block the client
+
+        // The client port, to check the connection used
+        server.get("/who", [](const beauty::request& req, beauty::response& res) {
+            res.body() = std::to_string(req.remote().port());
+        });
+        server.get("/slow", [](const beauty::request& req, beauty::response& res) {
+            std::this_thread::sleep_for(200ms);
+            res.body() = std::to_string(req.remote().port());
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port());
+    }
+
+    ~ClientPoolFixture() {
+        server.stop();
+    }
+
+    // Wait for the asynchronous responses
+    static bool wait_for(const std::atomic<int>& count, int expected)
+    {
+        for (int i = 0; i < 300 && count < expected; ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return count == expected;
+    }
+
+    static beauty::client_settings http1()
+    {
+        beauty::client_settings settings;
+        settings.http2 = false;
+        return settings;
+    }
+
+    beauty::server server;
+    std::string url;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Connection reused")
+{
+    beauty::client client(http1());
+    std::atomic<int> count{0};
+    std::set<std::string> ports;
+
+    for (int i = 0; i < 5; ++i) {
+        client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            ports.insert(response.body());
+            ++count;
+        });
+        REQUIRE(wait_for(count, i + 1));
+    }
+
+    CHECK_EQ(ports.size(), 1);
+
+    auto stats = client.pool_stats();
+    CHECK_EQ(stats.connections, 1);
+    CHECK_EQ(stats.connects, 1);
+    CHECK_EQ(stats.hits, 4);
+    CHECK_EQ(stats.pending, 0);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Connections limited by host")
+{
+    auto settings = http1();
+    settings.max_connections_per_host = 2;
+    beauty::client client(settings);
+
+    std::mutex mtx;
+    std::set<std::string> ports;
+    std::atomic<int> count{0};
+
+    for (int i = 0; i < 6; ++i) {
+        client.get(url + "/slow", [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            {
+                std::lock_guard guard{mtx};
+                ports.insert(response.body());
+            }
+            ++count;
+        });
+    }
+
+    // Two in flight, the other ones waiting for a connection once taken by the pool
+    for (int i = 0; i < 100 && client.pool_stats().pending < 4; ++i) {
+        std::this_thread::sleep_for(1ms);
+    }
+    CHECK_EQ(client.pool_stats().pending, 4);
+
+    REQUIRE(wait_for(count, 6));
+    CHECK_EQ(ports.size(), 2);
+
+    auto stats = client.pool_stats();
+    CHECK_EQ(stats.connections, 2);
+    CHECK_EQ(stats.connects, 2);
+    CHECK_EQ(stats.hits, 4);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Pending requests limited")
+{
+    auto settings = http1();
+    settings.max_connections_per_host = 1;
+    settings.max_pending_requests_per_host = 1;
+    settings.pending_timeout = 100ms;
+    beauty::client client(settings);
+
+    std::atomic<int> count{0};
+    std::atomic<int> refused{0};
+    std::atomic<int> timed_out{0};
+
+    for (int i = 0; i < 3; ++i) {
+        client.get(url + "/slow", [&](boost::system::error_code ec, beauty::response&& response) {
+            if (ec == boost::system::errc::resource_unavailable_try_again) ++refused;
+            if (ec == boost::system::errc::timed_out) ++timed_out;
+            ++count;
+        });
+    }
+
+    // Refused once taken by the pool, the waiting one times out before the connection is free
+    CHECK(wait_for(refused, 1));
+    REQUIRE(wait_for(count, 3));
+    CHECK_EQ(timed_out, 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Idle connections evicted")
+{
+    auto settings = http1();
+    settings.idle_timeout = 100ms;
+    beauty::client client(settings);
+    std::atomic<int> count{0};
+
+    for (int i = 0; i < 3; ++i) {
+        client.get(url + "/slow", [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            ++count;
+        });
+    }
+    REQUIRE(wait_for(count, 3));
+    CHECK_EQ(client.pool_stats().connections, 3);
+
+    std::this_thread::sleep_for(300ms);
+    auto stats = client.pool_stats();
+    CHECK_EQ(stats.connections, 0);
+    CHECK_EQ(stats.evictions, 3);
+
+    // A new connection on the next request
+    client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        ++count;
+    });
+    CHECK(wait_for(count, 4));
+    CHECK_EQ(client.pool_stats().connects, 4);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Synchronous requests on the pooled connections")
+{
+    auto settings = http1();
+    settings.max_connections_per_host = 2;
+    beauty::client client(settings);
+
+    std::mutex mtx;
+    std::set<std::string> ports;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10; ++i) {
+                auto [ec, response] = client.get(url + "/who");
+                CHECK_EQ(ec, boost::system::errc::success);
+                std::lock_guard guard{mtx};
+                ports.insert(response.body());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK_LE(ports.size(), 2);
+    auto stats = client.pool_stats();
+    CHECK_LE(stats.connects, 2);
+    CHECK_GE(stats.hits, 38);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Synchronous request from a callback")
+{
+    beauty::client client(http1());
+
+    // The event loop of the client cannot wait for itself, a connection of its own
+    std::atomic<int> count{0};
+    std::string body;
+    client.get(url + "/who", [&](boost::system::error_code ec, beauty::response&&) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        auto [ec2, response] = client.get_before(1s, url + "/who");
+        CHECK_EQ(ec2, boost::system::errc::success);
+        body = response.body();
+        ++count;
+    });
+
+    REQUIRE(wait_for(count, 1));
+    CHECK_FALSE(body.empty());
+    CHECK_EQ(client.pool_stats().connects, 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(ClientPoolFixture, "Timed out connection not reused")
+{
+    auto settings = http1();
+    settings.max_connections_per_host = 1;
+    beauty::client client(settings);
+
+    auto [ec, response] = client.get_before(50ms, url + "/slow");
+    CHECK_EQ(ec, boost::system::errc::timed_out);
+
+    // Not behind the response still to come, on a new connection
+    auto start = std::chrono::steady_clock::now();
+    auto [ec2, response2] = client.get_before(1s, url + "/who");
+    CHECK_EQ(ec2, boost::system::errc::success);
+    CHECK_LT(std::chrono::steady_clock::now() - start, 100ms);
+
+    auto stats = client.pool_stats();
+    CHECK_EQ(stats.connects, 2);
+    CHECK_EQ(stats.connections, 1);
+}
@@ -0,0 +1,151 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct SendAllFixture
+{
+    SendAllFixture()
+    {
+        server.concurrency(4); // The delayed handlers are run at the same time
+
+        server.get("/delay/:ms", [](const beauty::request& req, beauty::response& res) {
+            auto ms = req.a("ms").as_integer();
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            res.body() = std::to_string(ms);
+        });
+        server.get("/error", [](const beauty::request& req, beauty::response& res) {
+            res.result(beauty::http::status::internal_server_error);
+        });
+        server.post("/echo", [](const beauty::request& req, beauty::response& res) {
+            res.body() = req.body();
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port());
+    }
+
+    ~SendAllFixture() {
+        server.stop();
+    }
+
+    static bool wait_for(const std::atomic<bool>& done)
+    {
+        for (int i = 0; i < 300 && !done; ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return done;
+    }
+
+    static beauty::client_settings http1()
+    {
+        beauty::client_settings settings;
+        settings.http2 = false;
+        return settings;
+    }
+
+    beauty::server server;
+    std::string url;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(SendAllFixture, "All the responses in the requests order")
+{
+    beauty::client client(http1());
+    std::atomic<bool> done{false};
+
+    beauty::request post;
+    post.method(beauty::http::verb::post);
+    post.body() = "posted";
+
+    std::vector<beauty::client::request_spec> requests{
+        {url + "/delay/300"},
+        {url + "/delay/100"},
+        {url + "/echo", std::move(post)},
+        {url + "/delay/200"},
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration elapsed{};
+    client.send_all(std::move(requests), 2s, [&](std::vector<beauty::client::client_response>&& responses) {
+        elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE_EQ(responses.size(), 4);
+        for (const auto& [ec, response] : responses) {
+            CHECK_EQ(ec, boost::system::errc::success);
+        }
+        CHECK_EQ(responses[0].second.body(), "300");
+        CHECK_EQ(responses[1].second.body(), "100");
+        CHECK_EQ(responses[2].second.body(), "posted");
+        CHECK_EQ(responses[3].second.body(), "200");
+        done = true;
+    });
+
+    REQUIRE(wait_for(done));
+    // Close to the slowest one, not to the sum
+    CHECK_LT(elapsed, 550ms);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(SendAllFixture, "First successes")
+{
+    beauty::client client(http1());
+    std::atomic<bool> done{false};
+
+    std::vector<beauty::client::request_spec> requests{
+        {url + "/delay/500"},
+        {url + "/error"},
+        {url + "/delay/50"},
+        {url + "/delay/10"},
+    };
+
+    client.send_all(std::move(requests), 2s, [&](std::vector<beauty::client::client_response>&& responses) {
+        REQUIRE_EQ(responses.size(), 4);
+        CHECK_EQ(responses[0].first, boost::asio::error::operation_aborted);
+        CHECK_EQ(responses[1].second.result(), beauty::http::status::internal_server_error);
+        CHECK_EQ(responses[2].second.body(), "50");
+        CHECK_EQ(responses[3].second.body(), "10");
+        done = true;
+    }, 2);
+
+    // Without waiting for the slowest one
+    CHECK(wait_for(done));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(SendAllFixture, "Deadline")
+{
+    beauty::client client(http1());
+    std::atomic<bool> done{false};
+
+    std::vector<beauty::client::request_spec> requests{
+        {url + "/delay/10"},
+        {url + "/delay/500"},
+    };
+
+    client.send_all(std::move(requests), 200ms, [&](std::vector<beauty::client::client_response>&& responses) {
+        REQUIRE_EQ(responses.size(), 2);
+        CHECK_EQ(responses[0].first, boost::system::errc::success);
+        CHECK_EQ(responses[1].first, boost::system::errc::timed_out);
+        done = true;
+    });
+
+    CHECK(wait_for(done));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Empty batch")
+{
+    beauty::client client;
+    bool done = false;
+    client.send_all({}, 0s, [&](std::vector<beauty::client::client_response>&& responses) {
+        CHECK(responses.empty());
+        done = true;
+    });
+    CHECK(done);
+}
@@ -0,0 +1,199 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+// --------------------------------------------------------------------------
+std::string
+big_body()
+{
+    std::string body(4 * 1024 * 1024, 'x');
+    for (std::size_t i = 0; i < body.size(); i += 13) body[i] = static_cast<char>('a' + i % 26);
+    return body;
+}
+}
+
+// --------------------------------------------------------------------------
+struct StreamResponseFixture
+{
+    StreamResponseFixture()
+    {
+        server.concurrency(2);
+        server.get("/big", [](const beauty::request& req, beauty::response& res) {
+            res.set(beauty::content_type::text_plain);
+            res.body() = big_body();
+        });
+        server.listen(0, "127.0.0.1");
+        url = "http://127.0.0.1:" + std::to_string(server.port()) + "/big";
+    }
+
+    ~StreamResponseFixture() {
+        server.stop();
+    }
+
+    static bool wait_for(const std::atomic<bool>& done)
+    {
+        for (int i = 0; i < 500 && !done; ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return done;
+    }
+
+    static beauty::client_settings with_http2(bool http2)
+    {
+        beauty::client_settings settings;
+        settings.http2 = http2;
+        return settings;
+    }
+
+    beauty::server server;
+    std::string url;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamResponseFixture, "Response body by chunks")
+{
+    for (bool http2 : {false, true}) {
+        CAPTURE(http2);
+        beauty::client client(with_http2(http2));
+
+        std::mutex mtx;
+        std::string body;
+        std::string content_type;
+        std::size_t chunks = 0;
+        std::atomic<bool> done{false};
+
+        beauty::client::response_handler handler;
+        handler.on_header = [&](const beauty::response& header) {
+            std::lock_guard guard{mtx};
+            CHECK(body.empty());
+            content_type = std::string(header[beauty::http::field::content_type]);
+        };
+        handler.on_chunk = [&](const char* data, std::size_t size, beauty::client::resume_cb&& resume) {
+            {
+                std::lock_guard guard{mtx};
+                body.append(data, size);
+                ++chunks;
+            }
+            resume();
+        };
+        handler.on_complete = [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            CHECK_EQ(response.version(), http2 ? 20 : 11);
+            CHECK(response.body().empty());
+            done = true;
+        };
+
+        client.get_stream(url, std::move(handler));
+        REQUIRE(wait_for(done));
+
+        std::lock_guard guard{mtx};
+        CHECK_EQ(content_type, "text/plain");
+        CHECK_GT(chunks, 1);
+        CHECK_EQ(body.size(), big_body().size());
+        CHECK((body == big_body()));
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamResponseFixture, "Not read until resumed")
+{
+    for (bool http2 : {false, true}) {
+        CAPTURE(http2);
+        beauty::client client(with_http2(http2));
+
+        std::mutex mtx;
+        std::size_t received = 0;
+        beauty::client::resume_cb paused;
+        std::atomic<bool> done{false};
+
+        beauty::client::response_handler handler;
+        handler.on_chunk = [&](const char* data, std::size_t size, beauty::client::resume_cb&& resume) {
+            std::lock_guard guard{mtx};
+            received += size;
+            paused = std::move(resume);
+        };
+        handler.on_complete = [&](boost::system::error_code ec, beauty::response&& response) {
+            CHECK_EQ(ec, boost::system::errc::success);
+            done = true;
+        };
+
+        client.get_stream(url, std::move(handler));
+
+        // One chunk given, the next ones wait for the handler
+        std::this_thread::sleep_for(200ms);
+        {
+            std::lock_guard guard{mtx};
+            CHECK_GT(received, 0);
+            CHECK_LT(received, big_body().size());
+        }
+
+        std::size_t before = 0;
+        {
+            std::lock_guard guard{mtx};
+            before = received;
+        }
+        std::this_thread::sleep_for(100ms);
+        {
+            std::lock_guard guard{mtx};
+            CHECK_EQ(received, before);
+        }
+
+        // Resumed until the end
+        for (int i = 0; i < 2000 && !done; ++i) {
+            beauty::client::resume_cb resume;
+            {
+                std::lock_guard guard{mtx};
+                resume = std::move(paused);
+                paused = nullptr;
+            }
+            if (resume) {
+                resume();
+            } else {
+                std::this_thread::sleep_for(1ms);
+            }
+        }
+        REQUIRE(done);
+        CHECK_EQ(received, big_body().size());
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamResponseFixture, "Response body in a file")
+{
+    auto path = (std::filesystem::temp_directory_path() / "beauty_test_download.txt").string();
+
+    beauty::client client;
+    std::atomic<bool> done{false};
+
+    client.get_file(url, path, [&](boost::system::error_code ec, beauty::response&& response) {
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.result(), beauty::http::status::ok);
+        done = true;
+    });
+    REQUIRE(wait_for(done));
+
+    std::ifstream file{path, std::ios::binary};
+    std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    CHECK((content == big_body()));
+    std::filesystem::remove(path);
+
+    // Not a file which can be written
+    done = false;
+    client.get_file(url, "/no/such/directory/file.txt", [&](boost::system::error_code ec, beauty::response&&) {
+        CHECK(ec);
+        done = true;
+    });
+    CHECK(done);
+}
@@ -0,0 +1,182 @@
+#include <doctest/doctest.h>
+
+#include <beauty/resolver_cache.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// --------------------------------------------------------------------------
+struct result {
+    boost::system::error_code ec;
+    beauty::resolver_cache::endpoints addresses;
+    bool called = false;
+};
+
+void
+resolve(asio::io_context& ioc, beauty::resolver_cache& cache, const std::string& host,
+        const std::string& port, result& r)
+{
+    cache.async_resolve(ioc.get_executor(), host, port,
+            [&r](boost::system::error_code ec, beauty::resolver_cache::endpoints addresses) {
+                r.ec = ec;
+                r.addresses = std::move(addresses);
+                r.called = true;
+            });
+}
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Addresses kept for the TTL")
+{
+    asio::io_context ioc;
+    beauty::resolver_cache cache;
+
+    result first, second, third;
+    resolve(ioc, cache, "127.0.0.1", "8085", first);
+    resolve(ioc, cache, "127.0.0.1", "8085", second); // Waits for the same lookup
+    CHECK_FALSE(first.called);
+    ioc.run();
+
+    REQUIRE(first.called);
+    REQUIRE(second.called);
+    CHECK_FALSE(first.ec);
+    REQUIRE_EQ(first.addresses.size(), 1);
+    CHECK_EQ(first.addresses[0].port(), 8085);
+    CHECK_EQ(second.addresses, first.addresses);
+    CHECK_EQ(cache.lookups(), 1);
+
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "8085", third);
+    CHECK_FALSE(third.called); // Never from the call
+    ioc.run();
+    CHECK(third.called);
+    CHECK_EQ(third.addresses, first.addresses);
+    CHECK_EQ(cache.lookups(), 1);
+    CHECK_EQ(cache.hits(), 1);
+    CHECK_EQ(cache.size(), 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Failed lookups kept for the negative TTL")
+{
+    asio::io_context ioc;
+    beauty::resolver_cache_settings settings;
+    settings.negative_ttl = 100ms;
+    beauty::resolver_cache cache(settings);
+
+    result first, second, third;
+    resolve(ioc, cache, "127.0.0.1", "no-such-service", first);
+    ioc.run();
+    CHECK(first.ec);
+
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "no-such-service", second);
+    ioc.run();
+    CHECK_EQ(second.ec, first.ec);
+    CHECK_EQ(cache.lookups(), 1);
+
+    std::this_thread::sleep_for(150ms);
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "no-such-service", third);
+    ioc.run();
+    CHECK(third.ec);
+    CHECK_EQ(cache.lookups(), 2);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Background refresh of the expired addresses")
+{
+    asio::io_context ioc;
+    beauty::resolver_cache_settings settings;
+    settings.ttl = 50ms;
+    settings.background_refresh = true;
+    beauty::resolver_cache cache(settings);
+
+    result first, second;
+    resolve(ioc, cache, "127.0.0.1", "80", first);
+    ioc.run();
+    REQUIRE_FALSE(first.ec);
+
+    std::this_thread::sleep_for(100ms);
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "80", second);
+    ioc.run();
+
+    // Given at once, and looked up again
+    CHECK_EQ(second.addresses, first.addresses);
+    CHECK_EQ(cache.hits(), 1);
+    CHECK_EQ(cache.lookups(), 2);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Lookup not bound to the event loop of the first client")
+{
+    beauty::resolver_cache cache;
+
+    // The first client never runs its event loop, and gives up
+    auto stopped = std::make_unique<asio::io_context>();
+    result first, second;
+    resolve(*stopped, cache, "127.0.0.1", "84", first);
+    cache.cancel(*stopped);
+    stopped.reset();
+
+    asio::io_context ioc;
+    resolve(ioc, cache, "127.0.0.1", "84", second);
+    ioc.run();
+
+    CHECK_FALSE(first.called);
+    REQUIRE(second.called);
+    CHECK_FALSE(second.ec);
+    CHECK_EQ(cache.lookups(), 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Least recently used hosts removed")
+{
+    asio::io_context ioc;
+    beauty::resolver_cache_settings settings;
+    settings.max_entries = 2;
+    beauty::resolver_cache cache(settings);
+
+    result r1, r2, r3;
+    resolve(ioc, cache, "127.0.0.1", "81", r1);
+    ioc.run();
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "82", r2);
+    ioc.run();
+    ioc.restart();
+    resolve(ioc, cache, "127.0.0.1", "83", r3);
+    ioc.run();
+
+    CHECK_EQ(cache.size(), 2);
+
+    cache.clear();
+    CHECK_EQ(cache.size(), 0);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Hosts resolved at the same time")
+{
+    asio::io_context ioc;
+    beauty::resolver_cache cache;
+
+    // More hosts than lookup threads, each one resolved on its own
+    std::vector<result> results(10);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        resolve(ioc, cache, "127.0.0.1", std::to_string(8000 + i), results[i]);
+    }
+    ioc.run();
+
+    for (const auto& r : results) {
+        REQUIRE(r.called);
+        CHECK_FALSE(r.ec);
+        CHECK_EQ(r.addresses.size(), 1);
+    }
+    CHECK_EQ(cache.lookups(), results.size());
+}
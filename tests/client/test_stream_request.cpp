@@ -0,0 +1,142 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// --------------------------------------------------------------------------
+struct StreamRequestFixture
+{
+    StreamRequestFixture()
+    {
+        server.concurrency(2);  // 2 threads are needed here because of synchronous get
+
+        server.add_route("/chunks")
+            .post(beauty::stream_handler{
+                [this](const beauty::request& req, const char* data, std::size_t size) {
+                    chunk_count++;
+                    chunk_total += size;
+                },
+                [this](const beauty::request& req, beauty::response& res) {
+                    res.body() = "CHUNKS BODY SIZE=" + std::to_string(chunk_total.load())
+                            + " IN MEMORY=" + std::to_string(req.body().size());
+                }});
+
+        server.add_route("/spool")
+            .put(beauty::stream_handler{
+                {},
+                [this](const beauty::request& req, beauty::response& res) {
+                    spooled_file = req.body_file();
+                    std::string body = req.body();
+                    if (!spooled_file.empty()) {
+                        std::ifstream file{spooled_file, std::ios::binary};
+                        body.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                    }
+                    res.body() = "SPOOL BODY SIZE=" + std::to_string(body.size())
+                            + " IN FILE=" + std::to_string(!spooled_file.empty());
+                },
+                1024 * 1024, // body limit
+                16 * 1024    // spool threshold
+            });
+
+        server.add_route("/trailer")
+            .put(beauty::stream_handler{
+                {},
+                [](const beauty::request& req, beauty::response& res) {
+                    auto checksum = req["X-Checksum"];
+                    res.body() = "TRAILER=" + std::string(checksum.data(), checksum.size())
+                            + " IN FILE=" + std::to_string(!req.body_file().empty());
+                },
+                1024 * 1024, // body limit
+                4            // spool threshold
+            });
+
+        server.listen();
+        url = "http://127.0.0.1:" + std::to_string(server.endpoint().port());
+    }
+
+    ~StreamRequestFixture() {
+        server.stop();
+    }
+
+    beauty::server server;
+    std::string url;
+
+    std::atomic<int> chunk_count{0};
+    std::atomic<std::size_t> chunk_total{0};
+    std::string spooled_file;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamRequestFixture, "Streamed body in chunks")
+{
+    auto[ec, response] = beauty::client().post(url + "/chunks", std::string(512 * 1024, '!'));
+
+    CHECK_EQ(ec, boost::system::errc::success);
+    CHECK_EQ(response.body(), "CHUNKS BODY SIZE=524288 IN MEMORY=0");
+    CHECK_GT(chunk_count.load(), 1);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamRequestFixture, "Streamed empty body")
+{
+    auto[ec, response] = beauty::client().post(url + "/chunks", "");
+
+    CHECK_EQ(ec, boost::system::errc::success);
+    CHECK_EQ(response.body(), "CHUNKS BODY SIZE=0 IN MEMORY=0");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamRequestFixture, "Spooled body")
+{
+    SUBCASE("Below the threshold") {
+        auto[ec, response] = beauty::client().put(url + "/spool", std::string(1024, '!'));
+
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.body(), "SPOOL BODY SIZE=1024 IN FILE=0");
+    }
+
+    SUBCASE("Above the threshold") {
+        auto[ec, response] = beauty::client().put(url + "/spool", std::string(100 * 1024, '!'));
+
+        CHECK_EQ(ec, boost::system::errc::success);
+        CHECK_EQ(response.body(), "SPOOL BODY SIZE=102400 IN FILE=1");
+
+        // Removed once the response is sent
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK_FALSE(std::filesystem::exists(spooled_file));
+    }
+
+    SUBCASE("Above the body limit") {
+        auto[ec, response] = beauty::client().put(url + "/spool", std::string(2 * 1024 * 1024, '!'));
+
+        // A 413 on a HTTP/2 stream, the connection closed with HTTP/1.1
+        CHECK((ec || response.result() == beauty::http::status::payload_too_large));
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StreamRequestFixture, "Streamed body trailer")
+{
+    namespace http = boost::beast::http;
+
+    boost::asio::io_context ioc;
+    boost::beast::tcp_stream stream(ioc);
+    stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.endpoint().port()});
+
+    // A chunked body spooled in a file, with a trailer field
+    std::string req = "PUT /trailer HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+            "Transfer-Encoding: chunked\r\nTrailer: X-Checksum\r\n\r\n"
+            "5\r\nHello\r\n6\r\n World\r\n0\r\nX-Checksum: 1234\r\n\r\n";
+    boost::asio::write(stream, boost::asio::buffer(req));
+
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+
+    CHECK_EQ(res.body(), "TRAILER=1234 IN FILE=1");
+}
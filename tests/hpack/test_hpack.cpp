@@ -0,0 +1,166 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <beauty/hpack.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+// --------------------------------------------------------------------------
+std::vector<std::uint8_t>
+from_hex(std::string_view hex)
+{
+    std::vector<std::uint8_t> bytes;
+    std::string digits;
+    for (char c : hex) {
+        if (c != ' ') digits.push_back(c);
+    }
+    for (std::size_t i = 0; i + 1 < digits.size(); i += 2) {
+        bytes.push_back(static_cast<std::uint8_t>(std::stoi(digits.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+// --------------------------------------------------------------------------
+std::vector<beauty::hpack::field>
+decode(beauty::hpack::decoder& decoder, std::string_view hex)
+{
+    auto bytes = from_hex(hex);
+    std::vector<beauty::hpack::field> fields;
+    REQUIRE(decoder.decode(bytes.data(), bytes.size(), fields));
+    return fields;
+}
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Requests without Huffman coding (RFC 7541 C.3)")
+{
+    beauty::hpack::decoder decoder;
+
+    auto fields = decode(decoder, "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d");
+    REQUIRE_EQ(fields.size(), 4);
+    CHECK_EQ(fields[0].name, ":method");
+    CHECK_EQ(fields[0].value, "GET");
+    CHECK_EQ(fields[2].value, "/");
+    CHECK_EQ(fields[3].name, ":authority");
+    CHECK_EQ(fields[3].value, "www.example.com");
+    CHECK_EQ(decoder.table_size(), 57);
+
+    fields = decode(decoder, "8286 84be 5808 6e6f 2d63 6163 6865");
+    REQUIRE_EQ(fields.size(), 5);
+    CHECK_EQ(fields[3].value, "www.example.com"); // From the dynamic table
+    CHECK_EQ(fields[4].name, "cache-control");
+    CHECK_EQ(fields[4].value, "no-cache");
+    CHECK_EQ(decoder.table_size(), 110);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Requests with Huffman coding (RFC 7541 C.4)")
+{
+    beauty::hpack::decoder decoder;
+
+    auto fields = decode(decoder, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff");
+    REQUIRE_EQ(fields.size(), 4);
+    CHECK_EQ(fields[3].value, "www.example.com");
+
+    fields = decode(decoder, "8286 84be 5886 a8eb 1064 9cbf");
+    REQUIRE_EQ(fields.size(), 5);
+    CHECK_EQ(fields[4].value, "no-cache");
+
+    fields = decode(decoder, "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf");
+    REQUIRE_EQ(fields.size(), 5);
+    CHECK_EQ(fields[1].value, "https");
+    CHECK_EQ(fields[2].value, "/index.html");
+    CHECK_EQ(fields[3].value, "www.example.com");
+    CHECK_EQ(fields[4].name, "custom-key");
+    CHECK_EQ(fields[4].value, "custom-value");
+    CHECK_EQ(decoder.table_size(), 164);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Huffman round trip")
+{
+    std::string all;
+    for (int c = 0; c < 256; ++c) {
+        all.push_back(static_cast<char>(c));
+    }
+
+    for (std::string s : {std::string(), std::string("a"), std::string("www.example.com"), all}) {
+        std::string encoded;
+        beauty::hpack::huffman_encode(s, encoded);
+        CHECK_EQ(encoded.size(), beauty::hpack::huffman_size(s));
+
+        std::string decoded;
+        CHECK(beauty::hpack::huffman_decode(
+                reinterpret_cast<const std::uint8_t*>(encoded.data()), encoded.size(), decoded));
+        CHECK_EQ(decoded, s);
+    }
+
+    std::string decoded;
+    auto padding = from_hex("ffff"); // More than 7 bits of padding
+    CHECK_FALSE(beauty::hpack::huffman_decode(padding.data(), padding.size(), decoded));
+    auto eos = from_hex("ffff fffc"); // EOS symbol
+    CHECK_FALSE(beauty::hpack::huffman_decode(eos.data(), eos.size(), decoded));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Encode")
+{
+    std::string block;
+    beauty::hpack::encode(block, ":status", "200");
+    CHECK_EQ(block, "\x88"); // Static table entry 8
+
+    beauty::hpack::encode(block, "Content-Type", "text/plain");
+    beauty::hpack::encode(block, "x-request-id", "0123456789");
+
+    beauty::hpack::decoder decoder;
+    std::vector<beauty::hpack::field> fields;
+    REQUIRE(decoder.decode(reinterpret_cast<const std::uint8_t*>(block.data()), block.size(), fields));
+    REQUIRE_EQ(fields.size(), 3);
+    CHECK_EQ(fields[0].value, "200");
+    CHECK_EQ(fields[1].name, "content-type");
+    CHECK_EQ(fields[1].value, "text/plain");
+    CHECK_EQ(fields[2].name, "x-request-id");
+    CHECK_EQ(fields[2].value, "0123456789");
+    CHECK_EQ(decoder.table_size(), 0); // Never indexed by the encoder
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Decoding errors")
+{
+    beauty::hpack::decoder decoder(256);
+    std::vector<beauty::hpack::field> fields;
+
+    auto index = from_hex("be"); // Dynamic table empty
+    CHECK_FALSE(decoder.decode(index.data(), index.size(), fields));
+
+    auto truncated = from_hex("410f 7777"); // String longer than the block
+    CHECK_FALSE(decoder.decode(truncated.data(), truncated.size(), fields));
+
+    auto resize = from_hex("3fe1 1f"); // Table size update of 4096, above the settings
+    CHECK_FALSE(decoder.decode(resize.data(), resize.size(), fields));
+
+    auto late_resize = from_hex("8220"); // Table size update after a field
+    CHECK_FALSE(decoder.decode(late_resize.data(), late_resize.size(), fields));
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Header list size limit")
+{
+    beauty::hpack::decoder decoder;
+    std::vector<beauty::hpack::field> fields;
+
+    // An entry of 32 + 1 + 100 bytes, then indexed 9 times
+    auto block = from_hex("4001 7864");
+    block.insert(block.end(), 100, 'a');
+    block.insert(block.end(), 9, 0xbe);
+
+    CHECK(decoder.decode(block.data(), block.size(), fields, 10 * 133));
+    CHECK_EQ(fields.size(), 10);
+
+    fields.clear();
+    beauty::hpack::decoder limited;
+    CHECK_FALSE(limited.decode(block.data(), block.size(), fields, 10 * 133 - 1));
+    CHECK_LT(fields.size(), 10);
+}
@@ -3,7 +3,12 @@
 
 #include <beauty/router.hpp>
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 namespace {
+std::atomic<std::size_t> allocation_count{0};
 auto route_matcher = [](const beauty::router& router, beauty::request& req) {
     for (const auto&[_, routes]: router) {
         for (const auto& r: routes) {
@@ -16,6 +21,19 @@ auto route_matcher = [](const beauty::router& router, beauty::request& req) {
 };
 }
 
+// --------------------------------------------------------------------------
+void* operator new(std::size_t size)
+{
+    ++allocation_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
 // --------------------------------------------------------------------------
 TEST_CASE("Route priority")
 {
@@ -162,3 +180,155 @@ TEST_CASE("Route priority")
         }
     }
 }
+
+// --------------------------------------------------------------------------
+TEST_CASE("Router match")
+{
+    beauty::router router;
+    std::vector<int> matched_routes;
+
+    auto cb = [&matched_routes](int idx) {
+        return [&matched_routes, idx](const beauty::request&, beauty::response&) {
+            matched_routes.push_back(idx);
+        };
+    };
+
+    auto execute = [&router](beauty::request& req) {
+        if (auto* r = router.match(beast::http::verb::get, req)) {
+            beauty::response res;
+            r->execute(req, res);
+        }
+    };
+
+    router.add_route(beast::http::verb::get, beauty::route("/:A/:B/:C", cb(7)));
+    router.add_route(beast::http::verb::get, beauty::route("/:A/:B/ccc", cb(6)));
+    router.add_route(beast::http::verb::get, beauty::route("/:A/bbb/ccc", cb(4)));
+    router.add_route(beast::http::verb::get, beauty::route("/:A/bbb/:C", cb(5)));
+    router.add_route(beast::http::verb::get, beauty::route("/aaa/bbb/:C", cb(1)));
+    router.add_route(beast::http::verb::get, beauty::route("/aaa/:B/:C", cb(3)));
+    router.add_route(beast::http::verb::get, beauty::route("/aaa/:B/ccc", cb(2)));
+    router.add_route(beast::http::verb::get, beauty::route("/aaa/bbb/ccc", cb(0)));
+    router.add_route(beast::http::verb::get, beauty::route("/", cb(8)));
+    router.add_route(beast::http::verb::get, beauty::route("/aaa/bbb", cb(9)));
+
+    beauty::request req;
+
+    SUBCASE("Priority") {
+        const std::vector<std::pair<std::string, int>> expected = {
+            {"/aaa/bbb/ccc", 0}, {"/aaa/bbb/thing", 1}, {"/aaa/other/ccc", 2},
+            {"/aaa/other/thing", 3}, {"/any/bbb/ccc", 4}, {"/any/bbb/thing", 5},
+            {"/any/other/ccc", 6}, {"/any/other/thing", 7}, {"/", 8}, {"/aaa/bbb", 9}
+        };
+
+        for (const auto& [target, idx] : expected) {
+            matched_routes.clear();
+            req.target(target);
+            execute(req);
+            REQUIRE_EQ(matched_routes.size(), 1);
+            CHECK_EQ(matched_routes[0], idx);
+        }
+    }
+
+    SUBCASE("Backtracking on static segment") {
+        // "/aaa/bbb/ccc" static path has no deeper segment, must fall back to "/:A"
+        router.add_route(beast::http::verb::get, beauty::route("/:A/bbb/ccc/:D", cb(10)));
+
+        matched_routes.clear();
+        req.target("/aaa/bbb/ccc/ddd");
+        execute(req);
+        REQUIRE_EQ(matched_routes.size(), 1);
+        CHECK_EQ(matched_routes[0], 10);
+        CHECK_EQ(req.a("A"), "aaa");
+        CHECK_EQ(req.a("D"), "ddd");
+    }
+
+    SUBCASE("Attributes") {
+        req.target("/any/other/thing?key=value");
+        CHECK(router.match(beast::http::verb::get, req));
+        CHECK_EQ(req.a("A"), "any");
+        CHECK_EQ(req.a("B"), "other");
+        CHECK_EQ(req.a("C"), "thing");
+        CHECK_EQ(req.a("key"), "value");
+    }
+
+    SUBCASE("Not found") {
+        req.target("/aaa/bbb/ccc/ddd");
+        CHECK_FALSE(router.match(beast::http::verb::get, req));
+
+        req.target("/aaa");
+        CHECK_FALSE(router.match(beast::http::verb::get, req));
+
+        req.target("/aaa/bbb/ccc");
+        CHECK_FALSE(router.match(beast::http::verb::post, req));
+    }
+
+    SUBCASE("Websocket") {
+        router.add_route(beast::http::verb::get, beauty::route("/aaa/bbb", beauty::ws_handler{}));
+
+        req.target("/aaa/bbb");
+        auto* r = router.match(beast::http::verb::get, req, true);
+        REQUIRE(r);
+        CHECK(r->is_websocket());
+
+        r = router.match(beast::http::verb::get, req);
+        REQUIRE(r);
+        CHECK_FALSE(r->is_websocket());
+
+        req.target("/aaa/bbb/ccc");
+        CHECK_FALSE(router.match(beast::http::verb::get, req, true));
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Router match path placeholders without allocation")
+{
+    beauty::router router;
+    router.add_route(beast::http::verb::get, beauty::route("/users/:id"));
+    router.add_route(beast::http::verb::get, beauty::route("/users/:id/orders/:oid"));
+    router.add_route(beast::http::verb::get, beauty::route("/users/:id/orders"));
+
+    beauty::request req;
+    req.target("/users/123/orders/my%20order");
+
+    auto before = allocation_count.load();
+    auto* r = router.match(beast::http::verb::get, req);
+    auto allocations = allocation_count.load() - before;
+
+    REQUIRE(r);
+    CHECK_EQ(r->path(), "/users/:id/orders/:oid");
+    CHECK_EQ(allocations, 0);
+
+    CHECK_EQ(req.get_path_params().size(), 2);
+    CHECK_EQ(req.path_param("id"), "123");
+    CHECK_EQ(req.path_param("oid"), "my%20order");
+    CHECK_EQ(req.a("id").as_integer(), 123);
+    CHECK_EQ(req.a("oid"), "my order");
+    CHECK_EQ(req.a("unknown"), "");
+
+    // Still given with the attributes, unescaped
+    const auto& attributes = req.get_attributes();
+    CHECK_EQ(attributes["id"], "123");
+    CHECK_EQ(attributes["oid"], "my order");
+
+    // Copied once
+    before = allocation_count.load();
+    CHECK_EQ(&req.get_attributes(), &attributes);
+    CHECK_EQ(allocation_count.load() - before, 0);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Router match more placeholders than the path params capacity")
+{
+    beauty::router router;
+    router.add_route(beast::http::verb::get, beauty::route("/:a/:b/:c/:d/:e/:f/:g/:h/:i/:j"));
+
+    beauty::request req;
+    req.target("/0/1/2/3/4/5/6/7/8/9");
+
+    REQUIRE(router.match(beast::http::verb::get, req));
+    CHECK_EQ(req.get_path_params().size(), beauty::path_params::capacity);
+    CHECK_EQ(req.a("a"), "0");
+    CHECK_EQ(req.a("h"), "7");
+    CHECK_EQ(req.a("i"), "8");
+    CHECK_EQ(req.a("j"), "9");
+}
@@ -0,0 +1,216 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/compression.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <zlib.h>
+
+#include <string>
+
+namespace http = boost::beast::http;
+
+namespace {
+// --------------------------------------------------------------------------
+std::string
+gunzip(const std::string& data)
+{
+    z_stream zs{};
+    REQUIRE_EQ(inflateInit2(&zs, 15 + 32), Z_OK); // zlib or gzip header
+
+    std::string out(64 * 1024, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    auto ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    CHECK_EQ(ret, Z_STREAM_END);
+
+    out.resize(zs.total_out);
+    return out;
+}
+
+// --------------------------------------------------------------------------
+std::string
+json_body()
+{
+    std::string body = "[";
+    for (int i = 0; i < 200; ++i) {
+        body += R"({"id":)" + std::to_string(i) + R"(,"name":"item","enabled":true},)";
+    }
+    body.back() = ']';
+    return body;
+}
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Accept-Encoding negotiation")
+{
+    CHECK_EQ(beauty::negotiate(""), beauty::content_coding::identity);
+    CHECK_EQ(beauty::negotiate("identity"), beauty::content_coding::identity);
+    CHECK_EQ(beauty::negotiate("gzip"), beauty::content_coding::gzip);
+    CHECK_EQ(beauty::negotiate("x-gzip"), beauty::content_coding::gzip);
+    CHECK_EQ(beauty::negotiate("deflate"), beauty::content_coding::deflate);
+    CHECK_EQ(beauty::negotiate("GZIP;q=0.5, deflate"), beauty::content_coding::deflate);
+    CHECK_EQ(beauty::negotiate("gzip;q=0, deflate;q=0"), beauty::content_coding::identity);
+    CHECK_EQ(beauty::negotiate("deflate, gzip"), beauty::content_coding::gzip); // Server preference
+    CHECK_EQ(beauty::negotiate("unknown, deflate;q=0.1"), beauty::content_coding::deflate);
+
+    if (beauty::is_supported(beauty::content_coding::br)) {
+        CHECK_EQ(beauty::negotiate("gzip, deflate, br"), beauty::content_coding::br);
+        CHECK_EQ(beauty::negotiate("*"), beauty::content_coding::br);
+    } else {
+        CHECK_EQ(beauty::negotiate("gzip, deflate, br"), beauty::content_coding::gzip);
+        CHECK_EQ(beauty::negotiate("br"), beauty::content_coding::identity);
+    }
+    CHECK_EQ(beauty::negotiate("*, br;q=0, zstd;q=0"), beauty::content_coding::gzip);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Response compression policy")
+{
+    beauty::compression_settings settings;
+    settings.min_size = 100;
+    beauty::response_compressor compressor(settings);
+
+    beauty::request req;
+    req.set(http::field::accept_encoding, "gzip");
+
+    auto make_response = [](const std::string& content_type, std::string body) {
+        beauty::response res;
+        res.set(http::field::content_type, content_type);
+        res.body() = std::move(body);
+        return res;
+    };
+
+    SUBCASE("Compressed") {
+        auto res = make_response("application/json; charset=utf-8", json_body());
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::gzip);
+        CHECK_EQ(res[http::field::content_encoding], "gzip");
+        CHECK_EQ(res[http::field::vary], "Accept-Encoding");
+        CHECK_EQ(gunzip(res.body()), json_body());
+    }
+
+    SUBCASE("Not accepted") {
+        beauty::request identity;
+        auto res = make_response("text/plain", json_body());
+        CHECK_EQ(compressor.compress(identity, res), beauty::content_coding::identity);
+        CHECK_EQ(res.body(), json_body());
+        CHECK_EQ(res[http::field::vary], "Accept-Encoding");
+    }
+
+    SUBCASE("Too small") {
+        auto res = make_response("text/plain", "Hello");
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::identity);
+        CHECK_FALSE(res.count(http::field::vary));
+    }
+
+    SUBCASE("Content type not compressed") {
+        auto res = make_response("image/png", json_body());
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::identity);
+        CHECK_EQ(res.body(), json_body());
+    }
+
+    SUBCASE("Not modified") {
+        auto res = make_response("text/plain", json_body());
+        res.result(http::status::not_modified);
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::identity);
+    }
+
+    SUBCASE("Strong ETag of the encoded body") {
+        auto res = make_response("text/html", json_body());
+        res.set(http::field::etag, "\"v1\"");
+        res.set(http::field::vary, "Origin");
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::gzip);
+        CHECK_EQ(res[http::field::etag], "\"v1-gzip\"");
+        CHECK_EQ(res[http::field::vary], "Origin, Accept-Encoding");
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Compressed variants cache")
+{
+    beauty::response_compressor compressor;
+
+    beauty::request req;
+    req.set(http::field::accept_encoding, "deflate");
+
+    for (int i = 0; i < 3; ++i) {
+        beauty::response res;
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "public, max-age=60");
+        res.body() = json_body();
+
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::deflate);
+        CHECK_EQ(gunzip(res.body()), json_body());
+    }
+    CHECK_EQ(compressor.cache_size(), 1);
+    CHECK_EQ(compressor.cache_hits(), 2);
+
+    // Same size, another body: never the compressed variant of the first one
+    for (int i = 0; i < 2; ++i) {
+        auto other = json_body();
+        other.replace(other.find("item"), 4, "meti");
+
+        beauty::response res;
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "public, max-age=60");
+        res.body() = other;
+
+        CHECK_EQ(compressor.compress(req, res), beauty::content_coding::deflate);
+        CHECK_EQ(gunzip(res.body()), other);
+    }
+    CHECK_EQ(compressor.cache_size(), 2);
+    CHECK_EQ(compressor.cache_hits(), 3);
+
+    // Not cacheable
+    beauty::response res;
+    res.set(http::field::content_type, "application/json");
+    res.set(http::field::cache_control, "no-store");
+    res.body() = json_body() + " ";
+    CHECK_EQ(compressor.compress(req, res), beauty::content_coding::deflate);
+    CHECK_EQ(compressor.cache_size(), 2);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Server compression")
+{
+    beauty::server server;
+    server.compression();
+    server.add_route("/items").get([](const auto& req, auto& res) {
+        res.set(beauty::content_type::application_json);
+        res.body() = json_body();
+    });
+    server.listen(0, "127.0.0.1");
+
+    boost::asio::io_context ioc;
+    boost::beast::tcp_stream stream(ioc);
+    stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+    boost::beast::flat_buffer buffer;
+
+    auto get = [&](const char* accept_encoding) {
+        http::request<http::empty_body> req{http::verb::get, "/items", 11};
+        req.set(http::field::host, "127.0.0.1");
+        if (accept_encoding) {
+            req.set(http::field::accept_encoding, accept_encoding);
+        }
+        http::write(stream, req);
+
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        return res;
+    };
+
+    auto res = get("gzip, deflate");
+    CHECK_EQ(res[http::field::content_encoding], "gzip");
+    CHECK_LT(res.body().size(), json_body().size() / 5);
+    CHECK_EQ(gunzip(res.body()), json_body());
+
+    res = get(nullptr);
+    CHECK_FALSE(res.count(http::field::content_encoding));
+    CHECK_EQ(res.body(), json_body());
+}
@@ -0,0 +1,116 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/client.hpp>
+#include <beauty/coroutine.hpp>
+#include <beauty/exception.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+TEST_CASE("Coroutine route handlers")
+{
+    beauty::server server;
+
+    server.add_route("/hello")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            co_await beauty::sleep_for(10ms);
+            res.body() = "Hello";
+        })
+        .post([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            res.body() = req.body();
+            co_return;
+        });
+
+    server.add_route("/compute")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            res.body() = std::to_string(co_await beauty::offload([] { return 6 * 7; }));
+        });
+
+    server.add_route("/not-found")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            co_await beauty::sleep_for(1ms);
+            throw beauty::http_error::client::not_found("Nothing here");
+        });
+
+    server.add_route("/error")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            co_await beauty::offload([] { throw std::runtime_error("Failure"); });
+        });
+
+    // A plain handler still works next to the coroutines
+    server.add_route("/plain")
+        .get([](const auto& req, auto& res) { res.body() = "Plain"; });
+
+    server.listen();
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port());
+
+    beauty::client client;
+
+    auto [ec, res] = client.get(url + "/hello");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.result(), beast::http::status::ok);
+    CHECK_EQ(res.body(), "Hello");
+
+    std::tie(ec, res) = client.post(url + "/hello", "Echo");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.body(), "Echo");
+
+    std::tie(ec, res) = client.get(url + "/compute");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.body(), "42");
+
+    std::tie(ec, res) = client.get(url + "/not-found");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.result(), beast::http::status::not_found);
+
+    std::tie(ec, res) = client.get(url + "/error");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.result(), beast::http::status::internal_server_error);
+
+    std::tie(ec, res) = client.get(url + "/plain");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.body(), "Plain");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Suspended coroutines do not block the I/O thread")
+{
+    beauty::server server;
+
+    server.add_route("/slow")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            co_await beauty::sleep_for(300ms);
+            res.body() = "Slow";
+        });
+    server.add_route("/fast")
+        .get([](const beauty::request& req, beauty::response& res) -> asio::awaitable<void> {
+            res.body() = "Fast";
+            co_return;
+        });
+
+    // A single I/O thread for both connections
+    server.concurrency(1).listen();
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port());
+
+    std::atomic_bool slow_done = false;
+    beauty::client slow_client;
+    slow_client.get(url + "/slow", [&](auto ec, auto&& res) { slow_done = true; });
+
+    std::this_thread::sleep_for(50ms);
+
+    beauty::client fast_client;
+    auto [ec, res] = fast_client.get(url + "/fast");
+    REQUIRE_FALSE(ec);
+    CHECK_EQ(res.body(), "Fast");
+    CHECK_FALSE(slow_done.load());
+
+    while (!slow_done.load()) {
+        std::this_thread::sleep_for(10ms);
+    }
+}
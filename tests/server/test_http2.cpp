@@ -0,0 +1,393 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/http2_session.hpp>
+
+#include <boost/asio.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace http2 = beauty::http2;
+
+namespace {
+// --------------------------------------------------------------------------
+// A minimal HTTP/2 client on a blocking socket
+// --------------------------------------------------------------------------
+struct frame {
+    http2::frame_type type;
+    std::uint8_t flags;
+    std::uint32_t id;
+    std::string payload;
+};
+
+struct client {
+    boost::asio::io_context ioc;
+    boost::asio::ip::tcp::socket socket{ioc};
+    beauty::hpack::decoder decoder;
+    std::string leftover; // Read after the HTTP/1.1 response of an upgrade
+    std::map<std::uint32_t, std::vector<frame>> others; // Frames of the other streams
+
+    // A large flow control window, or the default one
+    explicit client(unsigned short port, bool preface = true, bool large_window = true) {
+        socket.connect({boost::asio::ip::make_address("127.0.0.1"), port});
+        if (preface) {
+            start(large_window);
+        }
+    }
+
+    void start(bool large_window = true) {
+        write(std::string(http2::client_preface));
+        if (!large_window) {
+            send(http2::frame_type::settings, 0, 0);
+            return;
+        }
+
+        std::string settings = {0, 4}; // SETTINGS_INITIAL_WINDOW_SIZE
+        http2::append_uint32(settings, http2::max_window_size);
+        send(http2::frame_type::settings, 0, 0, settings);
+
+        std::string increment;
+        http2::append_uint32(increment, http2::max_window_size - http2::default_window_size);
+        send(http2::frame_type::window_update, 0, 0, increment);
+    }
+
+    void read(char* data, std::size_t size) {
+        auto n = std::min(size, leftover.size());
+        std::copy_n(leftover.begin(), n, data);
+        leftover.erase(0, n);
+        boost::asio::read(socket, boost::asio::buffer(data + n, size - n));
+    }
+
+    void write(const std::string& data) {
+        boost::asio::write(socket, boost::asio::buffer(data));
+    }
+
+    void send(http2::frame_type type, std::uint8_t flags, std::uint32_t id, const std::string& payload = {}) {
+        std::string f;
+        http2::append_frame_header(f, payload.size(), type, flags, id);
+        write(f + payload);
+    }
+
+    void request(std::uint32_t id, const char* method, const char* path, bool end_stream = true) {
+        std::string block;
+        beauty::hpack::encode(block, ":method", method);
+        beauty::hpack::encode(block, ":scheme", "http");
+        beauty::hpack::encode(block, ":path", path);
+        beauty::hpack::encode(block, ":authority", "127.0.0.1");
+        send(http2::frame_type::headers,
+                http2::flags::end_headers | (end_stream ? http2::flags::end_stream : 0), id, block);
+    }
+
+    frame read() {
+        std::uint8_t header[http2::frame_header_size];
+        read(reinterpret_cast<char*>(header), sizeof(header));
+        frame f{static_cast<http2::frame_type>(header[3]), header[4], http2::read_uint32(header + 5) & 0x7fffffff, {}};
+        f.payload.resize((header[0] << 16) | (header[1] << 8) | header[2]);
+        read(f.payload.data(), f.payload.size());
+        return f;
+    }
+
+    // The response of a stream, as the decoded fields and the body
+    struct response {
+        std::map<std::string, std::string> fields;
+        std::string body;
+    };
+
+    response read_response(std::uint32_t id) {
+        response res;
+        for (;;) {
+            frame f;
+            if (auto& queued = others[id]; !queued.empty()) {
+                f = std::move(queued.front());
+                queued.erase(queued.begin());
+            } else {
+                f = read();
+            }
+            if (f.id != id) {
+                others[f.id].push_back(std::move(f));
+                continue;
+            }
+            if (f.type == http2::frame_type::headers) {
+                std::vector<beauty::hpack::field> fields;
+                REQUIRE(decoder.decode(reinterpret_cast<const std::uint8_t*>(f.payload.data()), f.payload.size(), fields));
+                for (auto& field : fields) {
+                    res.fields[field.name] = field.value;
+                }
+            }
+            if (f.type == http2::frame_type::data) {
+                res.body += f.payload;
+            }
+            REQUIRE(f.type != http2::frame_type::rst_stream);
+            if (f.flags & http2::flags::end_stream) {
+                return res;
+            }
+        }
+    }
+    // The error code of the GOAWAY closing the connection
+    http2::error_code read_goaway() {
+        for (;;) {
+            auto f = read();
+            if (f.type == http2::frame_type::goaway) {
+                return static_cast<http2::error_code>(
+                        http2::read_uint32(reinterpret_cast<const std::uint8_t*>(f.payload.data()) + 4));
+            }
+        }
+    }
+};
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 with prior knowledge")
+{
+    beauty::server server;
+    server.add_route("/hello/:name").get([](const auto& req, auto& res) {
+        res.set(beauty::content_type::text_plain);
+        res.body() = "Hello " + req.a("name").as_string() + " HTTP/" + std::to_string(req.version());
+    });
+    server.add_route("/echo").post([](const auto& req, auto& res) {
+        res.body() = req.body();
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port());
+
+    // Server preface first
+    auto settings = c.read();
+    CHECK_EQ(settings.type, http2::frame_type::settings);
+    CHECK_EQ(settings.flags, 0);
+
+    SUBCASE("Streams") {
+        c.request(1, "GET", "/hello/world");
+        c.request(3, "GET", "/not/found");
+
+        auto res = c.read_response(1);
+        CHECK_EQ(res.fields[":status"], "200");
+        CHECK_EQ(res.fields["content-type"], "text/plain");
+        CHECK_EQ(res.body, "Hello world HTTP/20");
+
+        res = c.read_response(3);
+        CHECK_EQ(res.fields[":status"], "404");
+    }
+
+    SUBCASE("Request body larger than a frame") {
+        const std::string body(100000, 'b');
+        c.request(1, "POST", "/echo", false);
+        for (std::size_t offset = 0; offset < body.size(); offset += 16384) {
+            auto chunk = body.substr(offset, 16384);
+            c.send(http2::frame_type::data,
+                    (offset + chunk.size() == body.size() ? http2::flags::end_stream : 0), 1, chunk);
+        }
+
+        auto res = c.read_response(1);
+        CHECK_EQ(res.fields[":status"], "200");
+        CHECK_EQ(res.body, body);
+    }
+
+    SUBCASE("Ping") {
+        c.send(http2::frame_type::ping, 0, 0, "12345678");
+        for (;;) {
+            auto f = c.read();
+            if (f.type == http2::frame_type::ping) {
+                CHECK_EQ(f.flags, http2::flags::ack);
+                CHECK_EQ(f.payload, "12345678");
+                break;
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 flow control")
+{
+    beauty::server server;
+    server.add_route("/big").get([](const auto& req, auto& res) {
+        res.body() = std::string(200000, 'x');
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port(), true, false);
+    c.request(1, "GET", "/big");
+
+    // Only the default window of 65535 bytes is sent until the client gives more
+    std::size_t received = 0;
+    while (received < 65535) {
+        auto f = c.read();
+        if (f.type == http2::frame_type::data) {
+            CHECK_LE(f.payload.size(), 16384);
+            received += f.payload.size();
+        }
+    }
+    CHECK_EQ(received, 65535);
+
+    std::string increment;
+    http2::append_uint32(increment, 200000);
+    c.send(http2::frame_type::window_update, 0, 0, increment);
+    c.send(http2::frame_type::window_update, 0, 1, increment);
+
+    auto res = c.read_response(1);
+    CHECK_EQ(received + res.body.size(), 200000);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 max concurrent streams")
+{
+    beauty::server_settings settings;
+    settings.http2_max_concurrent_streams = 1;
+
+    beauty::server server;
+    server.settings(settings);
+    server.add_route("/echo").post([](const auto& req, auto& res) {
+        res.body() = req.body();
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port());
+
+    // The stream 1 is still open, waiting for its body
+    c.request(1, "POST", "/echo", false);
+    c.request(3, "POST", "/echo");
+
+    for (;;) {
+        auto f = c.read();
+        if (f.type == http2::frame_type::rst_stream) {
+            CHECK_EQ(f.id, 3);
+            CHECK_EQ(http2::read_uint32(reinterpret_cast<const std::uint8_t*>(f.payload.data())),
+                    static_cast<std::uint32_t>(http2::error_code::refused_stream));
+            break;
+        }
+    }
+
+    c.send(http2::frame_type::data, http2::flags::end_stream, 1, "done");
+    CHECK_EQ(c.read_response(1).body, "done");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 header block errors")
+{
+    beauty::server server;
+    server.add_route("/hello").get([](const auto& req, auto& res) {
+        res.body() = "Hello";
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port());
+
+    SUBCASE("Header list larger than the settings") {
+        // A dynamic table entry of 4Ko, then references to it
+        std::string block = {0x40, 0x01, 'x', 0x7f, char(0xa1), 0x1e};
+        block += std::string(4000, 'a');
+        block += std::string(12000, char(0xbe));
+        c.send(http2::frame_type::headers, http2::flags::end_headers | http2::flags::end_stream, 1, block);
+
+        CHECK_EQ(c.read_goaway(), http2::error_code::compression_error);
+    }
+
+    SUBCASE("Stream identifier not increasing") {
+        c.request(3, "GET", "/hello");
+        CHECK_EQ(c.read_response(3).body, "Hello");
+
+        c.request(1, "GET", "/hello");
+        CHECK_EQ(c.read_goaway(), http2::error_code::protocol_error);
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 header and body timeouts")
+{
+    using namespace std::chrono_literals;
+
+    beauty::server_settings settings;
+    settings.header_timeout = 200ms;
+    settings.body_timeout = 200ms;
+
+    beauty::server server;
+    server.settings(settings);
+    server.add_route("/echo").post([](const auto& req, auto& res) {
+        res.body() = req.body();
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port());
+
+    SUBCASE("Header block never ended") {
+        std::string block;
+        beauty::hpack::encode(block, ":method", "POST");
+        c.send(http2::frame_type::headers, 0, 1, block);
+
+        CHECK_EQ(c.read_goaway(), http2::error_code::cancel);
+    }
+
+    SUBCASE("Body never ended") {
+        c.request(1, "POST", "/echo", false);
+        c.send(http2::frame_type::data, 0, 1, "partial");
+
+        for (;;) {
+            auto f = c.read();
+            if (f.type == http2::frame_type::rst_stream) {
+                CHECK_EQ(f.id, 1);
+                CHECK_EQ(http2::read_uint32(reinterpret_cast<const std::uint8_t*>(f.payload.data())),
+                        static_cast<std::uint32_t>(http2::error_code::cancel));
+                break;
+            }
+        }
+
+        // Only the stalled stream is reset
+        c.request(3, "POST", "/echo", false);
+        c.send(http2::frame_type::data, http2::flags::end_stream, 3, "done");
+        CHECK_EQ(c.read_response(3).body, "done");
+    }
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/1.1 upgrade to h2c")
+{
+    beauty::server server;
+    server.add_route("/hello").get([](const auto& req, auto& res) {
+        res.body() = "Hello HTTP/" + std::to_string(req.version());
+    });
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port(), false);
+    c.write("GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+            "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAAP__\r\n\r\n");
+
+    boost::asio::streambuf buffer;
+    auto size = boost::asio::read_until(c.socket, buffer, "\r\n\r\n");
+    std::string status(static_cast<const char*>(buffer.data().data()), size);
+    CHECK_EQ(status.substr(0, status.find("\r\n")), "HTTP/1.1 101 Switching Protocols");
+
+    // The server preface and the response follow without waiting for the client preface
+    c.leftover.assign(static_cast<const char*>(buffer.data().data()) + size, buffer.size() - size);
+    c.start();
+
+    // The upgraded request is the stream 1
+    auto res = c.read_response(1);
+    CHECK_EQ(res.fields[":status"], "200");
+    CHECK_EQ(res.body, "Hello HTTP/20");
+
+    c.request(3, "GET", "/hello");
+    CHECK_EQ(c.read_response(3).body, "Hello HTTP/20");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("HTTP/2 disabled")
+{
+    beauty::server_settings settings;
+    settings.http2 = false;
+
+    beauty::server server;
+    server.settings(settings);
+    server.listen(0, "127.0.0.1");
+
+    client c((unsigned short)server.port(), false);
+    c.write(std::string(http2::client_preface));
+
+    // Not a HTTP/1 request, the connection is closed without any server preface
+    std::string data(64, '\0');
+    boost::system::error_code ec;
+    auto size = boost::asio::read(c.socket, boost::asio::buffer(data), ec);
+    CHECK_EQ(ec, boost::asio::error::eof);
+    CHECK_EQ(size, 0);
+}
@@ -64,3 +64,65 @@ TEST_CASE("Slow and Fast queries")
     CHECK(done);
     CHECK_EQ(fast_api_response_time, doctest::Approx(105).epsilon(0.1)); // 10% of error
 }
+
+// -----------------------------------------------------------------------------
+TEST_CASE("Offloaded slow handler on a single I/O thread")
+{
+    beauty::application app;
+    app.set_compute_threads(2);
+
+    beauty::server server(app);
+
+    server.add_route("/slow-response")
+        .policy(beauty::execution_policy::offload)
+        .get([](const auto& req, auto& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            res.body() = "SLOW";
+        });
+    server.add_route("/failure")
+        .policy(beauty::execution_policy::offload)
+        .get([](const auto& req, auto& res) {
+            throw std::runtime_error("Offloaded failure");
+        });
+    server.add_route("/fast-response")
+        .get([](const auto& req, auto& res) {
+            res.body() = "FAST";
+        });
+    server.concurrency(1);
+    server.listen(0, "127.0.0.1");
+
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port());
+
+    std::atomic_bool slow_done = false;
+    beauty::client client1;
+    client1.get(url + "/slow-response", [&](boost::system::error_code ec, beauty::response&& response){
+        CHECK_FALSE(ec);
+        CHECK_EQ(response.body(), "SLOW");
+        slow_done = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // The I/O thread is not blocked by the slow handler
+    auto start_at = std::chrono::steady_clock::now();
+
+    beauty::client client2;
+    auto [ec, response] = client2.get(url + "/fast-response");
+    CHECK_FALSE(ec);
+    CHECK_EQ(response.body(), "FAST");
+
+    auto fast_response_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_at).count();
+    CHECK_LT(fast_response_time, 250);
+    CHECK_FALSE(slow_done.load());
+
+    // Exceptions are still turned into a response
+    auto [ec_failure, failure] = client2.get(url + "/failure");
+    CHECK_FALSE(ec_failure);
+    CHECK_EQ(failure.status(), beauty::http::status::internal_server_error);
+
+    while (!slow_done.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    server.stop();
+}
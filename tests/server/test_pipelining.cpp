@@ -0,0 +1,115 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/timer.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+// --------------------------------------------------------------------------
+struct PipeliningFixture
+{
+    PipeliningFixture()
+    {
+        server.add_route("/slow")
+            .get([this](const auto& req, auto& res) {
+                handled("slow");
+                res.postpone();
+                beauty::after(0.2, [&res] {
+                    res.body() = "SLOW";
+                    res.done();
+                });
+            });
+
+        server.add_route("/fast/:id")
+            .get([this](const auto& req, auto& res) {
+                handled("fast");
+                res.body() = "FAST " + req.a("id").as_string();
+            });
+
+        server.listen();
+    }
+
+    ~PipeliningFixture() {
+        server.stop();
+    }
+
+    void handled(const std::string& name) {
+        std::lock_guard guard{mtx};
+        handlers.push_back(name);
+    }
+
+    beauty::server server;
+
+    std::mutex mtx;
+    std::vector<std::string> handlers;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(PipeliningFixture, "Pipelined requests are answered in order")
+{
+    boost::asio::io_context ioc;
+    boost::beast::tcp_stream stream(ioc);
+    stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+
+    // All the requests in one write
+    std::string requests;
+    for (const char* target : {"/slow", "/fast/1", "/fast/2"}) {
+        requests += std::string("GET ") + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    }
+    requests += "GET /fast/3 HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    boost::asio::write(stream, boost::asio::buffer(requests));
+
+    boost::beast::flat_buffer buffer;
+    std::vector<std::string> bodies;
+    for (int i = 0; i < 4; ++i) {
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        CHECK_EQ(res.result(), http::status::ok);
+        bodies.push_back(res.body());
+    }
+
+    CHECK_EQ(bodies, std::vector<std::string>{"SLOW", "FAST 1", "FAST 2", "FAST 3"});
+
+    // The fast handlers did not wait for the postponed response
+    std::lock_guard guard{mtx};
+    CHECK_EQ(handlers, std::vector<std::string>{"slow", "fast", "fast", "fast"});
+
+    // The last request asked for the connection to be closed
+    boost::system::error_code ec;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res, ec);
+    CHECK_EQ(ec, http::error::end_of_stream);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(PipeliningFixture, "Pipelined requests beyond the limit")
+{
+    boost::asio::io_context ioc;
+    boost::beast::tcp_stream stream(ioc);
+    stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+
+    const int count = 100;
+    std::string requests = "GET /slow HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    for (int i = 0; i < count; ++i) {
+        requests += "GET /fast/" + std::to_string(i) + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    }
+    boost::asio::write(stream, boost::asio::buffer(requests));
+
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    CHECK_EQ(res.body(), "SLOW");
+
+    for (int i = 0; i < count; ++i) {
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        CHECK_EQ(res.body(), "FAST " + std::to_string(i));
+    }
+}
@@ -4,6 +4,13 @@
 #include <beauty/server.hpp>
 #include <beauty/version.hpp>
 
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
 // --------------------------------------------------------------------------
 TEST_CASE("Start and stop")
 {
@@ -30,6 +37,59 @@ TEST_CASE("Start and stop - multiple threads")
     server.stop();
 }
 
+// --------------------------------------------------------------------------
+TEST_CASE("Sharded server")
+{
+    beauty::application app;
+    beauty::server server(app);
+
+    server.add_route("/thread").get([](const auto& req, auto& res) {
+        res.body() = std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    });
+
+    server
+        .sharded(true)
+        .concurrency(4)
+        .listen(0, "127.0.0.1");
+
+    CHECK(app.is_sharded());
+    CHECK_EQ(app.shard_count(), 4);
+    CHECK_NE(server.endpoint().port(), 0);
+
+    // A connection stays on one thread
+    std::vector<std::thread> clients;
+    std::atomic<int> success{0};
+    for (int i = 0; i < 8; ++i) {
+        clients.emplace_back([&] {
+            namespace http = boost::beast::http;
+            boost::asio::io_context ioc;
+            boost::beast::tcp_stream stream(ioc);
+            stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+
+            std::string thread;
+            for (int r = 0; r < 10; ++r) {
+                http::request<http::empty_body> req{http::verb::get, "/thread", 11};
+                http::write(stream, req);
+
+                boost::beast::flat_buffer buffer;
+                http::response<http::string_body> res;
+                http::read(stream, buffer, res);
+
+                if (r == 0) thread = res.body();
+                if (res.body() != thread) return;
+            }
+            ++success;
+        });
+    }
+    for (auto& c : clients) {
+        c.join();
+    }
+
+    CHECK_EQ(success, 8);
+
+    server.stop();
+}
+
 // --------------------------------------------------------------------------
 TEST_CASE("Server swagger info")
 {
@@ -0,0 +1,172 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+#include <beauty/utils.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+namespace http = boost::beast::http;
+
+// --------------------------------------------------------------------------
+struct StaticFilesFixture
+{
+    StaticFilesFixture()
+    {
+        root = std::filesystem::temp_directory_path() / ("beauty_static_" + beauty::make_uuid());
+        std::filesystem::create_directories(root / "sub");
+
+        content.resize(100 * 1024);
+        for (std::size_t i = 0; i < content.size(); ++i) {
+            content[i] = static_cast<char>('a' + i % 26);
+        }
+        std::ofstream(root / "file.txt", std::ios::binary) << content;
+        std::ofstream(root / "sub" / "index.html", std::ios::binary) << "<html/>";
+
+        server.add_route("/assets/api").get([](const auto& req, auto& res) { res.body() = "ROUTE"; });
+        server.add_static("/assets", root.string());
+
+        server.listen();
+    }
+
+    ~StaticFilesFixture() {
+        server.stop();
+        std::filesystem::remove_all(root);
+    }
+
+    http::response<http::string_body>
+    send(http::verb verb, const std::string& target, const std::vector<std::pair<http::field, std::string>>& fields = {})
+    {
+        boost::asio::io_context ioc;
+        boost::beast::tcp_stream stream(ioc);
+        stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+
+        http::request<http::empty_body> req{verb, target, 11};
+        req.set(http::field::host, "127.0.0.1");
+        for (const auto& [field, value] : fields) {
+            req.set(field, value);
+        }
+        http::write(stream, req);
+
+        boost::beast::flat_buffer buffer;
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(1024 * 1024);
+        parser.skip(verb == http::verb::head);
+        http::read(stream, buffer, parser);
+
+        return parser.release();
+    }
+
+    beauty::server server;
+    std::filesystem::path root;
+    std::string content;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file full content")
+{
+    auto res = send(http::verb::get, "/assets/file.txt");
+
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res.body(), content);
+    CHECK_EQ(res[http::field::content_type], "text/plain");
+    CHECK_EQ(res[http::field::accept_ranges], "bytes");
+    CHECK_FALSE(res[http::field::etag].empty());
+    CHECK_FALSE(res[http::field::last_modified].empty());
+
+    // Twice, from the cache
+    res = send(http::verb::get, "/assets/file.txt?version=2");
+    CHECK_EQ(res.body(), content);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file head")
+{
+    auto res = send(http::verb::head, "/assets/file.txt");
+
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res[http::field::content_length], std::to_string(content.size()));
+    CHECK(res.body().empty());
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file directory index")
+{
+    auto res = send(http::verb::get, "/assets/sub");
+
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res.body(), "<html/>");
+    CHECK_EQ(res[http::field::content_type], "text/html");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file range")
+{
+    auto res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=10-19"}});
+    CHECK_EQ(res.result(), http::status::partial_content);
+    CHECK_EQ(res.body(), content.substr(10, 10));
+    CHECK_EQ(res[http::field::content_range], "bytes 10-19/" + std::to_string(content.size()));
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=-5"}});
+    CHECK_EQ(res.result(), http::status::partial_content);
+    CHECK_EQ(res.body(), content.substr(content.size() - 5));
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=102300-"}});
+    CHECK_EQ(res.result(), http::status::partial_content);
+    CHECK_EQ(res.body(), content.substr(102300));
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=200000-"}});
+    CHECK_EQ(res.result(), http::status::range_not_satisfiable);
+    CHECK_EQ(res[http::field::content_range], "bytes */" + std::to_string(content.size()));
+
+    // Multiple ranges are not supported, the full content is sent
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=0-1,5-6"}});
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res.body(), content);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file conditional requests")
+{
+    auto res = send(http::verb::get, "/assets/file.txt");
+    auto etag = std::string(res[http::field::etag]);
+    auto last_modified = std::string(res[http::field::last_modified]);
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::if_none_match, etag}});
+    CHECK_EQ(res.result(), http::status::not_modified);
+    CHECK(res.body().empty());
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::if_none_match, "\"other\""}});
+    CHECK_EQ(res.result(), http::status::ok);
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::if_modified_since, last_modified}});
+    CHECK_EQ(res.result(), http::status::not_modified);
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::if_modified_since, "Sun, 06 Nov 1994 08:49:37 GMT"}});
+    CHECK_EQ(res.result(), http::status::ok);
+
+    // The range is ignored if the representation has changed
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=0-9"}, {http::field::if_range, etag}});
+    CHECK_EQ(res.result(), http::status::partial_content);
+
+    res = send(http::verb::get, "/assets/file.txt", {{http::field::range, "bytes=0-9"}, {http::field::if_range, "\"other\""}});
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res.body(), content);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(StaticFilesFixture, "Static file not found")
+{
+    CHECK_EQ(send(http::verb::get, "/assets/unknown.txt").result(), http::status::not_found);
+    CHECK_EQ(send(http::verb::get, "/assets/../file.txt").result(), http::status::not_found);
+    CHECK_EQ(send(http::verb::get, "/assets/sub/%2e%2e/%2e%2e/file.txt").result(), http::status::not_found);
+    CHECK_EQ(send(http::verb::get, "/other/file.txt").result(), http::status::not_found);
+
+    // Routes have the precedence
+    auto res = send(http::verb::get, "/assets/api");
+    CHECK_EQ(res.result(), http::status::ok);
+    CHECK_EQ(res.body(), "ROUTE");
+}
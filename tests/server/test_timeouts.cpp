@@ -0,0 +1,114 @@
+#include <doctest/doctest.h>
+
+#include <beauty/server.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <chrono>
+
+namespace http = boost::beast::http;
+using namespace std::chrono_literals;
+
+// --------------------------------------------------------------------------
+struct TimeoutsFixture
+{
+    TimeoutsFixture()
+    {
+        beauty::server_settings settings;
+        settings.idle_timeout = 300ms;
+        settings.header_timeout = 200ms;
+        settings.body_timeout = 200ms;
+        settings.max_requests_per_connection = 3;
+
+        server.settings(settings);
+        server.add_route("/hello").get([](const auto& req, auto& res) { res.body() = "Hello"; });
+        server.add_route("/upload").post([](const auto& req, auto& res) { res.body() = req.body(); });
+        server.listen();
+
+        stream.connect({boost::asio::ip::make_address("127.0.0.1"), (unsigned short)server.port()});
+    }
+
+    ~TimeoutsFixture() {
+        server.stop();
+    }
+
+    // Time for the server to close the connection, the stream is expected to be closed
+    std::chrono::milliseconds
+    wait_for_close()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        stream.expires_after(5s);
+        char data[64];
+        boost::system::error_code ec;
+        while (!ec) {
+            stream.read_some(boost::asio::buffer(data), ec);
+        }
+        CHECK_NE(ec, boost::beast::error::timeout);
+
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    http::response<http::string_body>
+    get()
+    {
+        http::request<http::empty_body> req{http::verb::get, "/hello", 11};
+        req.set(http::field::host, "127.0.0.1");
+        http::write(stream, req);
+
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        return res;
+    }
+
+    beauty::server server;
+
+    boost::asio::io_context ioc;
+    boost::beast::tcp_stream stream{ioc};
+    boost::beast::flat_buffer buffer;
+};
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(TimeoutsFixture, "Idle connection timeout")
+{
+    CHECK_EQ(get().body(), "Hello");
+
+    auto elapsed = wait_for_close();
+    CHECK_GE(elapsed.count(), 250);
+    CHECK_LT(elapsed.count(), 2000);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(TimeoutsFixture, "Header timeout on a slow client")
+{
+    boost::asio::write(stream, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\nHost: ")));
+
+    auto elapsed = wait_for_close();
+    CHECK_GE(elapsed.count(), 150);
+    CHECK_LT(elapsed.count(), 1000);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(TimeoutsFixture, "Body timeout on a slow client")
+{
+    boost::asio::write(stream, boost::asio::buffer(std::string(
+            "POST /upload HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 100\r\n\r\nonly a part")));
+
+    auto elapsed = wait_for_close();
+    CHECK_GE(elapsed.count(), 150);
+    CHECK_LT(elapsed.count(), 1000);
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE_FIXTURE(TimeoutsFixture, "Max requests per connection")
+{
+    CHECK(get().keep_alive());
+    CHECK(get().keep_alive());
+
+    auto res = get();
+    CHECK_EQ(res.body(), "Hello");
+    CHECK_FALSE(res.keep_alive());
+
+    CHECK_LT(wait_for_close().count(), 100);
+}
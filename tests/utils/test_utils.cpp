@@ -23,3 +23,47 @@ TEST_CASE("Unescape")
 
     CHECK_EQ(beauty::unescape("%252ftmp%252fsrv"), "%2ftmp%2fsrv");
 }
+
+// --------------------------------------------------------------------------
+TEST_CASE("Unescape urlencoded and invalid sequences")
+{
+    CHECK_EQ(beauty::unescape("a+b%2Bc"), "a b+c");
+    CHECK_EQ(beauty::unescape("%zz%2"), "%zz%2");
+    CHECK_EQ(beauty::unescape("100%"), "100%");
+    CHECK_EQ(beauty::unescape("%%41"), "%A");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Escape and unescape in a buffer")
+{
+    std::string out(3 * 9, '\0');
+    out.resize(beauty::escape("a/b c~d.e", out.data()));
+    CHECK_EQ(out, "a%2Fb%20c~d.e");
+
+    // In place
+    std::string s = "long+enough+to+be+done+by+blocks%3A%20%C3%A9%2f";
+    s.resize(beauty::unescape(s, s.data()));
+    CHECK_EQ(s, "long enough to be done by blocks: \xc3\xa9/");
+}
+
+// --------------------------------------------------------------------------
+TEST_CASE("Escape all the characters")
+{
+    std::string all;
+    for (int c = 0; c < 256; ++c) {
+        all += static_cast<char>(c);
+    }
+    // Several times, for the runs across the blocks
+    all += all + all;
+
+    auto escaped = beauty::escape(all);
+    for (std::size_t i = 0; i < escaped.size(); ++i) {
+        if (escaped[i] == '%') {
+            i += 2;
+        } else {
+            CHECK(std::string_view("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~")
+                    .find(escaped[i]) != std::string_view::npos);
+        }
+    }
+    CHECK_EQ(beauty::unescape(escaped), all);
+}